@@ -126,3 +126,373 @@ int stress_set_cpu_affinity(const char *arg)
 	_exit(EXIT_FAILURE);
 }
 #endif
+
+/* --pin instance placement policies */
+typedef enum {
+	STRESS_PIN_NONE = 0,	/* leave placement to the scheduler */
+	STRESS_PIN_COMPACT,	/* fill SMT siblings, cores, LLCs, packages */
+	STRESS_PIN_SCATTER,	/* spread over packages, LLCs, cores then SMT */
+	STRESS_PIN_LLC,		/* pack onto the CPUs of one LLC domain */
+	STRESS_PIN_NUMA,	/* spread over the CPUs of one NUMA node */
+	STRESS_PIN_NOSMT,	/* one CPU per core, no SMT siblings */
+} stress_pin_policy_t;
+
+typedef struct {
+	const char *name;		/* --pin policy name */
+	const stress_pin_policy_t policy; /* policy */
+} stress_pin_method_t;
+
+static const stress_pin_method_t pin_methods[] = {
+	{ "compact",	STRESS_PIN_COMPACT },
+	{ "scatter",	STRESS_PIN_SCATTER },
+	{ "llc",	STRESS_PIN_LLC },
+	{ "numa",	STRESS_PIN_NUMA },
+	{ "nosmt",	STRESS_PIN_NOSMT },
+};
+
+static stress_pin_policy_t pin_policy = STRESS_PIN_NONE;
+static const char *pin_name = NULL;
+static int32_t *pin_cpus = NULL;	/* CPUs in placement order */
+static size_t pin_cpus_count = 0;
+
+/*
+ *  stress_set_pin()
+ *	set the --pin instance placement policy
+ */
+int stress_set_pin(const char *arg)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(pin_methods); i++) {
+		if (!strcmp(pin_methods[i].name, arg)) {
+			pin_policy = pin_methods[i].policy;
+			pin_name = pin_methods[i].name;
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "pin must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(pin_methods); i++)
+		(void)fprintf(stderr, " %s", pin_methods[i].name);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
+
+#if defined(HAVE_AFFINITY) &&	\
+    defined(__linux__)
+
+/* Topology of a CPU the instances may be placed on */
+typedef struct {
+	int32_t cpu;		/* CPU number */
+	int32_t package;	/* physical package id */
+	int32_t core;		/* core id in package */
+	int32_t llc;		/* LLC domain (first CPU sharing it) */
+	int32_t node;		/* NUMA node */
+	int32_t smt;		/* SMT sibling rank in core, 0 = first */
+	int32_t core_rank;	/* core rank in LLC domain */
+	int32_t llc_rank;	/* LLC domain rank in package */
+	int32_t node_rank;	/* scatter order rank in NUMA node */
+} stress_pin_cpu_t;
+
+/*
+ *  stress_pin_cmp_compact()
+ *	order by node, package, LLC, core then SMT sibling
+ */
+static int stress_pin_cmp_compact(const void *p1, const void *p2)
+{
+	const stress_pin_cpu_t *c1 = (const stress_pin_cpu_t *)p1;
+	const stress_pin_cpu_t *c2 = (const stress_pin_cpu_t *)p2;
+
+	if (c1->node != c2->node)
+		return c1->node - c2->node;
+	if (c1->package != c2->package)
+		return c1->package - c2->package;
+	if (c1->llc != c2->llc)
+		return c1->llc - c2->llc;
+	if (c1->core != c2->core)
+		return c1->core - c2->core;
+	return c1->cpu - c2->cpu;
+}
+
+/*
+ *  stress_pin_cmp_scatter()
+ *	order by SMT sibling, core, LLC then package so that
+ *	consecutive instances land on different packages, LLCs
+ *	and cores before SMT siblings are used
+ */
+static int stress_pin_cmp_scatter(const void *p1, const void *p2)
+{
+	const stress_pin_cpu_t *c1 = (const stress_pin_cpu_t *)p1;
+	const stress_pin_cpu_t *c2 = (const stress_pin_cpu_t *)p2;
+
+	if (c1->smt != c2->smt)
+		return c1->smt - c2->smt;
+	if (c1->core_rank != c2->core_rank)
+		return c1->core_rank - c2->core_rank;
+	if (c1->llc_rank != c2->llc_rank)
+		return c1->llc_rank - c2->llc_rank;
+	if (c1->package != c2->package)
+		return c1->package - c2->package;
+	return c1->cpu - c2->cpu;
+}
+
+/*
+ *  stress_pin_cmp_numa()
+ *	order by scatter rank in the NUMA node then node so that
+ *	consecutive instances round-robin across the NUMA nodes
+ */
+static int stress_pin_cmp_numa(const void *p1, const void *p2)
+{
+	const stress_pin_cpu_t *c1 = (const stress_pin_cpu_t *)p1;
+	const stress_pin_cpu_t *c2 = (const stress_pin_cpu_t *)p2;
+
+	if (c1->node_rank != c2->node_rank)
+		return c1->node_rank - c2->node_rank;
+	return c1->node - c2->node;
+}
+
+/*
+ *  stress_pin_rank()
+ *	compute the SMT sibling, core and LLC ranks of the
+ *	CPUs, the list is in CPU number order
+ */
+static void stress_pin_rank(stress_pin_cpu_t *cpus, const size_t n)
+{
+	size_t i, j;
+	bool *llc_first;
+
+	llc_first = calloc(n, sizeof(*llc_first));
+
+	for (i = 0; i < n; i++) {
+		cpus[i].smt = 0;
+		cpus[i].core_rank = 0;
+		cpus[i].llc_rank = 0;
+		if (llc_first)
+			llc_first[i] = true;
+
+		for (j = 0; j < i; j++) {
+			if (cpus[j].package != cpus[i].package)
+				continue;
+			if (cpus[j].llc == cpus[i].llc) {
+				if (llc_first)
+					llc_first[i] = false;
+				if ((cpus[i].core >= 0) && (cpus[j].core == cpus[i].core)) {
+					if (cpus[i].smt == 0)
+						cpus[i].core_rank = cpus[j].core_rank;
+					cpus[i].smt++;
+				}
+			}
+		}
+		if (cpus[i].smt)
+			continue;
+		for (j = 0; j < i; j++) {
+			if ((cpus[j].package == cpus[i].package) &&
+			    (cpus[j].llc == cpus[i].llc) &&
+			    (cpus[j].smt == 0))
+				cpus[i].core_rank++;
+		}
+	}
+
+	if (!llc_first)
+		return;
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			if (llc_first[j] &&
+			    (cpus[j].package == cpus[i].package) &&
+			    (cpus[j].llc < cpus[i].llc))
+				cpus[i].llc_rank++;
+		}
+	}
+	free(llc_first);
+}
+
+/*
+ *  stress_pin_init()
+ *	build the list of CPUs in --pin placement order from the
+ *	sysfs topology, restricted to the CPUs this process is
+ *	allowed to run on (e.g. with --taskset)
+ */
+int stress_pin_init(void)
+{
+	stress_cpus_t *cpus;
+	stress_pin_cpu_t *pins;
+	cpu_set_t mask;
+	size_t i, n = 0, count = 0;
+	char buf[128];
+	int len = 0;
+
+	if (pin_policy == STRESS_PIN_NONE)
+		return 0;
+
+	CPU_ZERO(&mask);
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_err("pin: cannot get CPU affinity, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return -1;
+	}
+	cpus = stress_get_all_cpu_cache_details();
+	if (!cpus) {
+		pr_err("pin: cannot determine CPU topology\n");
+		return -1;
+	}
+	pins = calloc((size_t)cpus->count, sizeof(*pins));
+	if (!pins) {
+		pr_err("pin: cannot allocate CPU topology list\n");
+		stress_free_cpu_caches(cpus);
+		return -1;
+	}
+	for (i = 0; i < cpus->count; i++) {
+		const stress_cpu_t *cpu = &cpus->cpus[i];
+
+		if (!cpu->online || !CPU_ISSET((int)cpu->num, &mask))
+			continue;
+		pins[n].cpu = (int32_t)cpu->num;
+		pins[n].package = cpu->package;
+		pins[n].core = cpu->core;
+		pins[n].llc = cpu->llc;
+		pins[n].node = cpu->node;
+		n++;
+	}
+	stress_free_cpu_caches(cpus);
+	if (n == 0) {
+		pr_err("pin: no online CPUs available for placement\n");
+		free(pins);
+		return -1;
+	}
+	stress_pin_rank(pins, n);
+
+	pin_cpus = calloc(n, sizeof(*pin_cpus));
+	if (!pin_cpus) {
+		pr_err("pin: cannot allocate CPU placement list\n");
+		free(pins);
+		return -1;
+	}
+
+	switch (pin_policy) {
+	case STRESS_PIN_SCATTER:
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_scatter);
+		break;
+	case STRESS_PIN_LLC:
+		/* CPUs of the LLC domain of the lowest allowed CPU, cores first */
+		for (i = 0; i < n; i++) {
+			if (pins[i].llc == pins[0].llc)
+				pins[count++] = pins[i];
+		}
+		n = count;
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_scatter);
+		break;
+	case STRESS_PIN_NUMA:
+		/* scatter within each node, round-robin across the nodes */
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_scatter);
+		for (i = 0; i < n; i++) {
+			size_t j;
+
+			pins[i].node_rank = 0;
+			for (j = 0; j < i; j++) {
+				if (pins[j].node == pins[i].node)
+					pins[i].node_rank++;
+			}
+		}
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_numa);
+		break;
+	case STRESS_PIN_NOSMT:
+		for (i = 0; i < n; i++) {
+			if (pins[i].smt == 0)
+				pins[count++] = pins[i];
+		}
+		n = count;
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_compact);
+		break;
+	case STRESS_PIN_COMPACT:
+	default:
+		qsort(pins, n, sizeof(*pins), stress_pin_cmp_compact);
+		break;
+	}
+
+	*buf = '\0';
+	for (i = 0; i < n; i++) {
+		pin_cpus[i] = pins[i].cpu;
+		if (len < (int)sizeof(buf) - 16)
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s%" PRId32,
+				i ? "," : "", pins[i].cpu);
+		else if (len < (int)sizeof(buf) - 4)
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, ",..");
+	}
+	pin_cpus_count = n;
+	free(pins);
+
+	pr_inf("pin: %s placement over %zu CPU%s: %s\n", pin_name, n,
+		n == 1 ? "" : "s", buf);
+	return 0;
+}
+
+/*
+ *  stress_pin_cpu()
+ *	return the CPU for the nth started instance, instances
+ *	wrap around the placement list, -1 if not pinning
+ */
+int32_t stress_pin_cpu(const int32_t instance)
+{
+	if (!pin_cpus || (pin_cpus_count == 0) || (instance < 0))
+		return -1;
+	return pin_cpus[(size_t)instance % pin_cpus_count];
+}
+
+/*
+ *  stress_pin_apply()
+ *	pin the calling process or thread to the given CPU
+ */
+void stress_pin_apply(const char *name, const int32_t cpu)
+{
+	cpu_set_t set;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET((int)cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+		pr_dbg("%s: cannot pin to CPU %" PRId32 ", errno=%d (%s)\n",
+			name, cpu, errno, strerror(errno));
+		return;
+	}
+	pr_dbg("%s: pinned to CPU %" PRId32 "\n", name, cpu);
+}
+
+/*
+ *  stress_pin_free()
+ *	free the placement list
+ */
+void stress_pin_free(void)
+{
+	free(pin_cpus);
+	pin_cpus = NULL;
+	pin_cpus_count = 0;
+}
+
+#else
+int stress_pin_init(void)
+{
+	if (pin_policy == STRESS_PIN_NONE)
+		return 0;
+
+	pr_inf("pin: CPU topology placement not supported, ignoring --pin %s\n",
+		pin_name);
+	return 0;
+}
+
+int32_t stress_pin_cpu(const int32_t instance)
+{
+	(void)instance;
+
+	return -1;
+}
+
+void stress_pin_apply(const char *name, const int32_t cpu)
+{
+	(void)name;
+	(void)cpu;
+}
+
+void stress_pin_free(void)
+{
+}
+#endif
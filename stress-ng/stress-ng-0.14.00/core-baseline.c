@@ -0,0 +1,322 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-baseline.h"
+
+#define DEFAULT_BASELINE_THRESHOLD	(5.0)	/* percent */
+
+/* A per stressor metric value */
+typedef struct stress_baseline_metric {
+	struct stress_baseline_metric *next;	/* next metric in list */
+	char *stressor;				/* munged stressor name */
+	char *metric;				/* YAML metric key */
+	double value;				/* metric value */
+} stress_baseline_metric_t;
+
+/*
+ *  Metrics where a drop beyond the threshold is a regression,
+ *  other metrics are just flagged as changed
+ */
+static const char * const baseline_gating[] = {
+	"bogo-ops-per-second-real-time",
+	"bogo-ops-per-second-usr-sys-time",
+};
+
+static double baseline_threshold = DEFAULT_BASELINE_THRESHOLD;
+static stress_baseline_metric_t *baseline_head;	/* loaded from file */
+static stress_baseline_metric_t *current_head;	/* this run */
+static stress_baseline_metric_t **current_tail = &current_head;
+static const char *baseline_filename;
+
+/*
+ *  stress_set_baseline_threshold()
+ *	set percentage change beyond which a metric is flagged
+ */
+int stress_set_baseline_threshold(const char *opt)
+{
+	char *end;
+
+	errno = 0;
+	baseline_threshold = strtod(opt, &end);
+	if ((errno != 0) || (end == opt) || (*end != '\0')) {
+		(void)fprintf(stderr, "Invalid number %s for baseline-threshold\n", opt);
+		longjmp(g_error_env, 1);
+	}
+	if (baseline_threshold < 0.0) {
+		(void)fprintf(stderr, "baseline-threshold must be a "
+			"percentage of 0 or more\n");
+		longjmp(g_error_env, 1);
+	}
+	return 0;
+}
+
+/*
+ *  stress_baseline_metric_add()
+ *	add a stressor metric to the end of a list
+ */
+static int stress_baseline_metric_add(
+	stress_baseline_metric_t ***tail,
+	const char *stressor,
+	const char *metric,
+	const double value)
+{
+	stress_baseline_metric_t *m;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return -1;
+	m->stressor = strdup(stressor);
+	m->metric = strdup(metric);
+	if (!m->stressor || !m->metric) {
+		free(m->stressor);
+		free(m->metric);
+		free(m);
+		return -1;
+	}
+	m->value = value;
+	**tail = m;
+	*tail = &m->next;
+	return 0;
+}
+
+/*
+ *  stress_baseline_metric_find()
+ *	find a stressor metric in a list
+ */
+static const stress_baseline_metric_t *stress_baseline_metric_find(
+	const stress_baseline_metric_t *head,
+	const char *stressor,
+	const char *metric)
+{
+	const stress_baseline_metric_t *m;
+
+	for (m = head; m; m = m->next) {
+		if (!strcmp(m->stressor, stressor) && !strcmp(m->metric, metric))
+			return m;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_baseline_metrics_free()
+ *	free a list of metrics
+ */
+static void stress_baseline_metrics_free(stress_baseline_metric_t *head)
+{
+	while (head) {
+		stress_baseline_metric_t *next = head->next;
+
+		free(head->stressor);
+		free(head->metric);
+		free(head);
+		head = next;
+	}
+}
+
+/*
+ *  stress_baseline_load()
+ *	load the metrics and perfstats sections of a YAML file
+ *	written by a previous run with --yaml, returns -1 on error
+ */
+int stress_baseline_load(void)
+{
+	FILE *fp;
+	char buf[256];
+	char stressor[128];
+	stress_baseline_metric_t **tail = &baseline_head;
+	bool in_section = false;
+	size_t n = 0;
+
+	baseline_filename = NULL;
+	if (!stress_get_setting("baseline", &baseline_filename) || !baseline_filename)
+		return 0;
+
+	fp = fopen(baseline_filename, "r");
+	if (!fp) {
+		pr_err("baseline: cannot open %s, errno=%d (%s)\n",
+			baseline_filename, errno, strerror(errno));
+		return -1;
+	}
+
+	*stressor = '\0';
+	while (fgets(buf, sizeof(buf), fp)) {
+		char key[128];
+		double value;
+
+		/* Top level key, start of a new section */
+		if (isalpha((int)buf[0])) {
+			in_section = !strncmp(buf, "metrics:", 8) ||
+				     !strncmp(buf, "perfstats:", 10);
+			*stressor = '\0';
+			continue;
+		}
+		if (!in_section)
+			continue;
+		if (sscanf(buf, "    - stressor: %127s", stressor) == 1)
+			continue;
+		if (!*stressor)
+			continue;
+		/* Only per stressor scalar values, skip nested blocks */
+		if (strncmp(buf, "      ", 6) || (buf[6] == ' '))
+			continue;
+		if (sscanf(buf + 6, "%127[^:]: %lf", key, &value) != 2)
+			continue;
+		if (stress_baseline_metric_add(&tail, stressor, key, value) < 0) {
+			pr_err("baseline: out of memory loading %s\n", baseline_filename);
+			(void)fclose(fp);
+			stress_baseline_free();
+			return -1;
+		}
+		n++;
+	}
+	(void)fclose(fp);
+
+	if (!n) {
+		pr_err("baseline: no metrics found in %s, it should be the "
+			"--yaml output of a --metrics run\n", baseline_filename);
+		return -1;
+	}
+	pr_dbg("baseline: loaded %zu metrics from %s\n", n, baseline_filename);
+	return 0;
+}
+
+/*
+ *  stress_baseline_record()
+ *	record a metric of this run for comparison with the baseline
+ */
+void stress_baseline_record(
+	const char *stressor,
+	const char *metric,
+	const double value)
+{
+	if (!baseline_head)
+		return;
+	if (stress_baseline_metric_add(&current_tail, stressor, metric, value) < 0)
+		pr_dbg("baseline: cannot record %s %s, out of memory\n",
+			stressor, metric);
+}
+
+/*
+ *  stress_baseline_gating()
+ *	return true if a drop of the metric is a regression
+ */
+static bool stress_baseline_gating(const char *metric)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(baseline_gating); i++) {
+		if (!strcmp(metric, baseline_gating[i]))
+			return true;
+	}
+	return false;
+}
+
+/*
+ *  stress_baseline_compare()
+ *	report the change of each metric of this run against the
+ *	baseline, returns false if any throughput metric dropped by
+ *	more than the threshold
+ */
+bool stress_baseline_compare(FILE *yaml)
+{
+	const stress_baseline_metric_t *m;
+	const char *prev = "";
+	uint32_t regressions = 0, changes = 0;
+
+	if (!baseline_head)
+		return true;
+
+	pr_inf("baseline: comparing against %s, changes beyond %.2f%% are flagged\n",
+		baseline_filename, baseline_threshold);
+	pr_inf("%-13s %-36s %14s %14s %9s\n",
+		"stressor", "metric", "baseline", "current", "delta (%)");
+	pr_yaml(yaml, "baseline:\n");
+	pr_yaml(yaml, "      file: %s\n", baseline_filename);
+	pr_yaml(yaml, "      threshold-percent: %f\n", baseline_threshold);
+	pr_yaml(yaml, "      comparisons:\n");
+
+	for (m = current_head; m; m = m->next) {
+		const stress_baseline_metric_t *b =
+			stress_baseline_metric_find(baseline_head, m->stressor, m->metric);
+		const char *status = "";
+		double delta;
+
+		if (!b) {
+			if (strcmp(prev, m->stressor))
+				pr_inf("%-13s not in baseline\n", m->stressor);
+			prev = m->stressor;
+			continue;
+		}
+		prev = m->stressor;
+
+		/* Skip counters that are zero in both runs */
+		if ((b->value == 0.0) && (m->value == 0.0))
+			continue;
+
+		delta = (b->value != 0.0) ?
+			100.0 * (m->value - b->value) / fabs(b->value) : 100.0;
+		if (fabs(delta) > baseline_threshold) {
+			if (stress_baseline_gating(m->metric)) {
+				if (delta < 0.0) {
+					status = " REGRESSION";
+					regressions++;
+				} else {
+					status = " improved";
+				}
+			} else {
+				status = " changed";
+			}
+			changes++;
+		}
+		pr_inf("%-13s %-36.36s %14.2f %14.2f %+9.2f%s\n",
+			m->stressor, m->metric, b->value, m->value, delta, status);
+
+		pr_yaml(yaml, "        - stressor: %s\n", m->stressor);
+		pr_yaml(yaml, "          metric: %s\n", m->metric);
+		pr_yaml(yaml, "          baseline: %f\n", b->value);
+		pr_yaml(yaml, "          current: %f\n", m->value);
+		pr_yaml(yaml, "          delta-percent: %f\n", delta);
+		pr_yaml(yaml, "          status: %s\n", *status ? status + 1 : "same");
+	}
+	pr_yaml(yaml, "      regressions: %" PRIu32 "\n", regressions);
+	pr_yaml(yaml, "\n");
+
+	if (regressions)
+		pr_inf("baseline: %" PRIu32 " metric%s regressed by more than %.2f%%\n",
+			regressions, regressions == 1 ? "" : "s", baseline_threshold);
+	else
+		pr_inf("baseline: no regressions, %" PRIu32 " metric%s changed "
+			"by more than %.2f%%\n",
+			changes, changes == 1 ? "" : "s", baseline_threshold);
+
+	return regressions == 0;
+}
+
+/*
+ *  stress_baseline_free()
+ *	free baseline and recorded metrics
+ */
+void stress_baseline_free(void)
+{
+	stress_baseline_metrics_free(baseline_head);
+	stress_baseline_metrics_free(current_head);
+	baseline_head = NULL;
+	current_head = NULL;
+	current_tail = &current_head;
+}
@@ -686,6 +686,73 @@ list_free:
 	return n;
 }
 
+/*
+ *  stress_get_cpu_topology_id()
+ *	read an integer topology value from cpu_path/name,
+ *	returns -1 if it is not available
+ */
+static int32_t stress_get_cpu_topology_id(const char *cpu_path, const char *name)
+{
+	char path[PATH_MAX];
+	char tmp[64];
+	int32_t val;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", cpu_path, name);
+	if (stress_get_string_from_file(path, tmp, sizeof(tmp)) < 0)
+		return -1;
+	if (sscanf(tmp, "%" SCNd32, &val) != 1)
+		return -1;
+	return val;
+}
+
+/*
+ *  node_filter()
+ *	return 1 when filename is node followed by a digit
+ */
+static int node_filter(const struct dirent *d)
+{
+	return ((strncmp(d->d_name, "node", 4) == 0) && isdigit(d->d_name[4]));
+}
+
+/*
+ *  stress_get_cpu_topology()
+ *	fill in the package, core, last level cache domain and
+ *	NUMA node of a cpu from /sys/devices/system/cpu/cpu*,
+ *	the LLC domain is identified by the lowest numbered CPU
+ *	in the shared_cpu_list of the highest level cache
+ */
+static void stress_get_cpu_topology(stress_cpu_t *cpu, const char *cpu_path)
+{
+	struct dirent **namelist = NULL;
+	int i, n, level_max = 0;
+
+	cpu->package = stress_get_cpu_topology_id(cpu_path, "topology/physical_package_id");
+	cpu->core = stress_get_cpu_topology_id(cpu_path, "topology/core_id");
+
+	for (i = 0; i < 32; i++) {
+		char name[64];
+		int32_t level, first;
+
+		(void)snprintf(name, sizeof(name), "%s/index%d/level", SYS_CPU_CACHE_DIR, i);
+		level = stress_get_cpu_topology_id(cpu_path, name);
+		if (level < 0)
+			break;
+		if (level < level_max)
+			continue;
+		(void)snprintf(name, sizeof(name), "%s/index%d/shared_cpu_list", SYS_CPU_CACHE_DIR, i);
+		first = stress_get_cpu_topology_id(cpu_path, name);
+		if (first < 0)
+			continue;
+		level_max = level;
+		cpu->llc = first;
+	}
+
+	n = scandir(cpu_path, &namelist, node_filter, NULL);
+	if (n > 0)
+		cpu->node = atoi(&namelist[0]->d_name[4]);
+	stress_dirent_list_free(namelist, n);
+}
+
 /*
  * stress_get_cpu_cache_details()
  * @cpu: cpu to fill in.
@@ -765,6 +832,10 @@ stress_cpus_t *stress_get_all_cpu_cache_details(void)
 		(void)memset(fullpath, 0, sizeof(fullpath));
 		(void)stress_mk_filename(fullpath, sizeof(fullpath), SYS_CPU_PREFIX, name);
 		cpu->num = (uint32_t)i;
+		cpu->package = -1;
+		cpu->core = -1;
+		cpu->llc = -1;
+		cpu->node = -1;
 		if (cpu->num == 0) {
 			/* 1st CPU cannot be taken offline */
 			cpu->online = 1;
@@ -781,8 +852,10 @@ stress_cpus_t *stress_get_all_cpu_cache_details(void)
 				cpu->online = atoi(tmp);
 			}
 		}
-		if (cpu->online)
+		if (cpu->online) {
 			stress_get_cpu_cache_details(&cpus->cpus[i], fullpath);
+			stress_get_cpu_topology(&cpus->cpus[i], fullpath);
+		}
 	}
 
 out:
@@ -0,0 +1,522 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-exporter.h"
+#include "core-perf.h"
+
+#if defined(HAVE_SYS_UN_H)
+#include <sys/un.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#include <netinet/in.h>
+
+#define EXPORTER_REQUEST_MAX	(4096)	/* request bytes read */
+#define EXPORTER_BACKLOG	(8)	/* listen backlog */
+
+/* Growable text buffer for the exposition */
+typedef struct {
+	char *buf;			/* text */
+	size_t len;			/* text length */
+	size_t size;			/* allocated size */
+} stress_exporter_buf_t;
+
+static pid_t exporter_pid = 0;
+static char *exporter_unix_path = NULL;
+
+/*
+ *  stress_exporter_printf()
+ *	append formatted text to the exposition buffer
+ */
+static void FORMAT(printf, 2, 3) stress_exporter_printf(
+	stress_exporter_buf_t *eb,
+	const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (!eb->buf)
+		return;
+	for (;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(eb->buf + eb->len, eb->size - eb->len, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			return;
+		if (eb->len + (size_t)n < eb->size) {
+			eb->len += (size_t)n;
+			return;
+		} else {
+			const size_t size = (eb->size * 2) + (size_t)n;
+			char *buf = realloc(eb->buf, size);
+
+			if (!buf) {
+				free(eb->buf);
+				eb->buf = NULL;
+				return;
+			}
+			eb->buf = buf;
+			eb->size = size;
+		}
+	}
+}
+
+/*
+ *  stress_exporter_labels()
+ *	append the stressor and instance labels, plus an optional
+ *	extra label with its value escaped for OpenMetrics
+ */
+static void stress_exporter_labels(
+	stress_exporter_buf_t *eb,
+	const stress_stressor_t *ss,
+	const int32_t instance,
+	const char *label,
+	const char *value)
+{
+	stress_exporter_printf(eb, "{stressor=\"%s\",instance=\"%" PRId32 "\"",
+		stress_munge_underscore(ss->stressor->name), instance);
+	if (label && value) {
+		const char *ptr;
+
+		stress_exporter_printf(eb, ",%s=\"", label);
+		for (ptr = value; *ptr; ptr++) {
+			switch (*ptr) {
+			case '\\':
+				stress_exporter_printf(eb, "\\\\");
+				break;
+			case '"':
+				stress_exporter_printf(eb, "\\\"");
+				break;
+			case '\n':
+				stress_exporter_printf(eb, "\\n");
+				break;
+			default:
+				stress_exporter_printf(eb, "%c", *ptr);
+				break;
+			}
+		}
+		stress_exporter_printf(eb, "\"");
+	}
+	stress_exporter_printf(eb, "}");
+}
+
+/*
+ *  stress_exporter_finished()
+ *	true if the instance has run and finished, perf
+ *	and thermal zone stats are only valid after this
+ */
+static inline bool stress_exporter_finished(const stress_stats_t *stats)
+{
+	return (stats->pid != 0) && (stats->finish > stats->start);
+}
+
+/*
+ *  stress_exporter_metrics()
+ *	generate the OpenMetrics text exposition of all the
+ *	stressor instances
+ */
+static void stress_exporter_metrics(
+	stress_exporter_buf_t *eb,
+	stress_stressor_t *stressors_list)
+{
+	const double now = stress_time_now();
+	stress_stressor_t *ss;
+	int32_t j;
+
+	stress_exporter_printf(eb,
+		"# TYPE stress_ng_bogo_ops counter\n"
+		"# HELP stress_ng_bogo_ops Bogo operations completed by a stressor instance.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			uint64_t counter;
+
+			if (!stats->pid)
+				continue;
+			if (!stress_stats_counter_read(stats, &counter))
+				continue;
+			stress_exporter_printf(eb, "stress_ng_bogo_ops_total");
+			stress_exporter_labels(eb, ss, j, NULL, NULL);
+			stress_exporter_printf(eb, " %" PRIu64 "\n", counter);
+		}
+	}
+
+	stress_exporter_printf(eb,
+		"# TYPE stress_ng_instance_running gauge\n"
+		"# HELP stress_ng_instance_running 1 if the stressor instance is running.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+
+			if (!stats->pid)
+				continue;
+			stress_exporter_printf(eb, "stress_ng_instance_running");
+			stress_exporter_labels(eb, ss, j, NULL, NULL);
+			stress_exporter_printf(eb, " %d\n",
+				stress_exporter_finished(stats) ? 0 : 1);
+		}
+	}
+
+	stress_exporter_printf(eb,
+		"# TYPE stress_ng_instance_run_seconds gauge\n"
+		"# UNIT stress_ng_instance_run_seconds seconds\n"
+		"# HELP stress_ng_instance_run_seconds Wall clock run time of the stressor instance.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			const double end = stress_exporter_finished(stats) ?
+				stats->finish : now;
+
+			if (!stats->pid)
+				continue;
+			stress_exporter_printf(eb, "stress_ng_instance_run_seconds");
+			stress_exporter_labels(eb, ss, j, NULL, NULL);
+			stress_exporter_printf(eb, " %.6f\n",
+				(end > stats->start) ? end - stats->start : 0.0);
+		}
+	}
+
+	stress_exporter_printf(eb,
+		"# TYPE stress_ng_misc_metric gauge\n"
+		"# HELP stress_ng_misc_metric Stressor specific metric.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			size_t i;
+
+			if (!stats->pid)
+				continue;
+			for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++) {
+				const stress_misc_stats_t *ms = &stats->misc_stats[i];
+				char description[sizeof(ms->description) + 1];
+
+				/* Copy, the stressor may be updating it */
+				(void)shim_strlcpy(description, ms->description, sizeof(description));
+				if (!*description)
+					continue;
+				stress_exporter_printf(eb, "stress_ng_misc_metric");
+				stress_exporter_labels(eb, ss, j, "metric", description);
+				stress_exporter_printf(eb, " %f\n", ms->value);
+			}
+		}
+	}
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		stress_exporter_printf(eb,
+			"# TYPE stress_ng_perf_events counter\n"
+			"# HELP stress_ng_perf_events Perf event count of a finished stressor instance.\n");
+		for (ss = stressors_list; ss; ss = ss->next) {
+			for (j = 0; j < ss->num_instances; j++) {
+				const stress_stats_t *stats = ss->stats[j];
+				size_t p;
+
+				if (!stress_exporter_finished(stats) ||
+				    !stress_perf_stat_succeeded(&stats->sp))
+					continue;
+				for (p = 0; p < STRESS_PERF_MAX; p++) {
+					const char *label = stress_perf_stat_label(p);
+					const uint64_t counter = stats->sp.perf_stat[p].counter;
+
+					if (!label)
+						break;
+					if (counter == STRESS_PERF_INVALID)
+						continue;
+					stress_exporter_printf(eb, "stress_ng_perf_events_total");
+					stress_exporter_labels(eb, ss, j, "event", label);
+					stress_exporter_printf(eb, " %" PRIu64 "\n", counter);
+				}
+			}
+		}
+	}
+#endif
+
+#if defined(STRESS_THERMAL_ZONES)
+	if ((g_opt_flags & OPT_FLAGS_THERMAL_ZONES) && g_shared->tz_info) {
+		stress_exporter_printf(eb,
+			"# TYPE stress_ng_thermal_zone_celsius gauge\n"
+			"# UNIT stress_ng_thermal_zone_celsius celsius\n"
+			"# HELP stress_ng_thermal_zone_celsius Thermal zone temperature at the end of a stressor instance.\n");
+		for (ss = stressors_list; ss; ss = ss->next) {
+			for (j = 0; j < ss->num_instances; j++) {
+				const stress_stats_t *stats = ss->stats[j];
+				const stress_tz_info_t *tz_info;
+
+				if (!stress_exporter_finished(stats))
+					continue;
+				for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+					const uint64_t temp = stats->tz.tz_stat[tz_info->index].temperature;
+					char zone[64];
+
+					if (!temp)
+						continue;
+					(void)snprintf(zone, sizeof(zone), "%s%" PRIu32,
+						tz_info->type, tz_info->type_instance);
+					stress_exporter_printf(eb, "stress_ng_thermal_zone_celsius");
+					stress_exporter_labels(eb, ss, j, "zone", zone);
+					stress_exporter_printf(eb, " %.3f\n", (double)temp / 1000.0);
+				}
+			}
+		}
+	}
+#endif
+	stress_exporter_printf(eb, "# EOF\n");
+}
+
+/*
+ *  stress_exporter_write()
+ *	write all of buf to the connection
+ */
+static void stress_exporter_write(const int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		const ssize_t ret = write(fd, buf, len);
+
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR))
+				continue;
+			return;
+		}
+		buf += ret;
+		len -= (size_t)ret;
+	}
+}
+
+/*
+ *  stress_exporter_serve()
+ *	read the HTTP request and reply with the metrics,
+ *	every request path gets the same metrics
+ */
+static void stress_exporter_serve(const int fd, stress_stressor_t *stressors_list)
+{
+	stress_exporter_buf_t eb;
+	char request[EXPORTER_REQUEST_MAX];
+	char header[256];
+	size_t len = 0;
+	struct timeval tv;
+	int n;
+
+	/* Don't let a stalled client block the exporter */
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	(void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	while (len < sizeof(request) - 1) {
+		const ssize_t ret = read(fd, request + len, sizeof(request) - 1 - len);
+
+		if (ret <= 0)
+			break;
+		len += (size_t)ret;
+		request[len] = '\0';
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+
+	eb.len = 0;
+	eb.size = 16384;
+	eb.buf = malloc(eb.size);
+	stress_exporter_metrics(&eb, stressors_list);
+	if (!eb.buf) {
+		static const char unavailable[] =
+			"HTTP/1.1 503 Service Unavailable\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n\r\n";
+
+		stress_exporter_write(fd, unavailable, sizeof(unavailable) - 1);
+		return;
+	}
+	n = snprintf(header, sizeof(header),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n", eb.len);
+	if (n > 0)
+		stress_exporter_write(fd, header, (size_t)n);
+	stress_exporter_write(fd, eb.buf, eb.len);
+	free(eb.buf);
+}
+
+/*
+ *  stress_exporter_socket()
+ *	create the listening socket, addr is either a unix socket
+ *	path (starting with / or .) or a TCP port on localhost
+ */
+static int stress_exporter_socket(const char *addr)
+{
+	int fd;
+
+	if ((*addr == '/') || (*addr == '.')) {
+#if defined(HAVE_SYS_UN_H)
+		struct sockaddr_un sun;
+		struct stat statbuf;
+
+		if (strlen(addr) >= sizeof(sun.sun_path)) {
+			pr_err("metrics-export: unix socket path %s too long\n", addr);
+			return -1;
+		}
+		/* Only remove a stale socket, never any other file */
+		if ((lstat(addr, &statbuf) == 0) && S_ISSOCK(statbuf.st_mode))
+			(void)unlink(addr);
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			pr_err("metrics-export: socket failed, errno=%d (%s)\n",
+				errno, strerror(errno));
+			return -1;
+		}
+		(void)memset(&sun, 0, sizeof(sun));
+		sun.sun_family = AF_UNIX;
+		(void)shim_strlcpy(sun.sun_path, addr, sizeof(sun.sun_path));
+		if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+			pr_err("metrics-export: cannot bind to %s, errno=%d (%s)\n",
+				addr, errno, strerror(errno));
+			(void)close(fd);
+			return -1;
+		}
+		exporter_unix_path = strdup(addr);
+#else
+		pr_err("metrics-export: unix sockets not supported\n");
+		return -1;
+#endif
+	} else {
+		struct sockaddr_in sin;
+		const int port = atoi(addr);
+		int so_reuseaddr = 1;
+
+		if ((port < 1) || (port > 65535)) {
+			pr_err("metrics-export: %s is not a unix socket path or a "
+				"port in the range 1 to 65535\n", addr);
+			return -1;
+		}
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			pr_err("metrics-export: socket failed, errno=%d (%s)\n",
+				errno, strerror(errno));
+			return -1;
+		}
+		(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+			&so_reuseaddr, sizeof(so_reuseaddr));
+		(void)memset(&sin, 0, sizeof(sin));
+		sin.sin_family = AF_INET;
+		sin.sin_port = htons((uint16_t)port);
+		/* Local access only */
+		sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+			pr_err("metrics-export: cannot bind to localhost port %d, errno=%d (%s)\n",
+				port, errno, strerror(errno));
+			(void)close(fd);
+			return -1;
+		}
+	}
+	if (listen(fd, EXPORTER_BACKLOG) < 0) {
+		pr_err("metrics-export: listen failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		(void)close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ *  stress_exporter_start()
+ *	start the OpenMetrics exporter process
+ */
+void stress_exporter_start(stress_stressor_t *stressors_list)
+{
+	char *addr = NULL;
+	pid_t ppid;
+	int fd;
+
+	(void)stress_get_setting("metrics-export", &addr);
+	if (!addr)
+		return;
+
+	fd = stress_exporter_socket(addr);
+	if (fd < 0)
+		return;
+
+	ppid = getpid();
+	exporter_pid = fork();
+	if (exporter_pid < 0) {
+		pr_inf("metrics-export: cannot fork exporter process, "
+			"errno=%d (%s), disabling exporter\n",
+			errno, strerror(errno));
+		exporter_pid = 0;
+		(void)close(fd);
+		return;
+	} else if (exporter_pid > 0) {
+		pr_dbg("metrics-export: serving OpenMetrics on %s\n", addr);
+		(void)close(fd);
+		return;
+	}
+
+	stress_set_proc_name("stress-ng-exporter");
+	/* SIGALRM is used to stop stressors, not the exporter */
+	if (stress_sighandler("exporter", SIGALRM, SIG_IGN, NULL) < 0)
+		_exit(0);
+	if (stress_sighandler("exporter", SIGPIPE, SIG_IGN, NULL) < 0)
+		_exit(0);
+
+	while (getppid() == ppid) {
+		int cfd;
+#if defined(HAVE_POLL_H)
+		struct pollfd pfd;
+
+		/* Wake up each second to check the parent is still alive */
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 1000) <= 0)
+			continue;
+#endif
+		cfd = accept(fd, NULL, NULL);
+		if (cfd < 0)
+			continue;
+		stress_exporter_serve(cfd, stressors_list);
+		(void)shutdown(cfd, SHUT_RDWR);
+		(void)close(cfd);
+	}
+	(void)close(fd);
+	_exit(0);
+}
+
+/*
+ *  stress_exporter_stop()
+ *	stop the exporter process and remove its unix socket
+ */
+void stress_exporter_stop(void)
+{
+	if (exporter_pid > 0) {
+		int status;
+
+		(void)kill(exporter_pid, SIGKILL);
+		(void)shim_waitpid(exporter_pid, &status, 0);
+		exporter_pid = 0;
+	}
+	if (exporter_unix_path) {
+		(void)unlink(exporter_unix_path);
+		free(exporter_unix_path);
+		exporter_unix_path = NULL;
+	}
+}
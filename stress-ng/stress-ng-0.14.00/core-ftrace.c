@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-capabilities.h"
 #include "core-ftrace.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SYS_TREE_H)
 #include <sys/tree.h>
@@ -33,38 +34,13 @@
 #include <bsd/sys/tree.h>
 #endif
 
-#if defined(HAVE_LIB_BSD) &&	\
-    defined(__linux__)
+#if defined(__linux__)
 
 #define MAX_MOUNTS	(256)
 #if !defined(DEBUGFS_MAGIC)
 #define DEBUGFS_MAGIC	(0x64626720)
 #endif
 
-struct rb_node {
-	RB_ENTRY(rb_node) rb;	/* red/black node entry */
-	char *func_name;	/* ftrace'd kernel function name */
-	int64_t start_count;	/* start number of calls to func */
-	int64_t end_count;	/* end number of calls to func */
-	double	start_time_us;	/* start time used by func in microsecs */
-	double	end_time_us;	/* end time used by func microsecs */
-};
-
-static bool tracing_enabled;
-
-/*
- *  rb_node_cmp()
- *	used for sorting functions by name
- */
-static int rb_node_cmp(struct rb_node *n1, struct rb_node *n2)
-{
-	return strcmp(n1->func_name, n2->func_name);
-}
-
-static RB_HEAD(rb_tree, rb_node) rb_root;
-RB_PROTOTYPE(rb_tree, rb_node, rb, rb_node_cmp);
-RB_GENERATE(rb_tree, rb_node, rb, rb_node_cmp);
-
 /*
  *  stress_ftrace_get_debugfs_path()
  *	find debugfs mount path, returns NULL if not found
@@ -98,6 +74,35 @@ static char *stress_ftrace_get_debugfs_path(void)
 	return NULL;
 }
 
+#endif
+
+#if defined(HAVE_LIB_BSD) &&	\
+    defined(__linux__)
+
+struct rb_node {
+	RB_ENTRY(rb_node) rb;	/* red/black node entry */
+	char *func_name;	/* ftrace'd kernel function name */
+	int64_t start_count;	/* start number of calls to func */
+	int64_t end_count;	/* end number of calls to func */
+	double	start_time_us;	/* start time used by func in microsecs */
+	double	end_time_us;	/* end time used by func microsecs */
+};
+
+static bool tracing_enabled;
+
+/*
+ *  rb_node_cmp()
+ *	used for sorting functions by name
+ */
+static int rb_node_cmp(struct rb_node *n1, struct rb_node *n2)
+{
+	return strcmp(n1->func_name, n2->func_name);
+}
+
+static RB_HEAD(rb_tree, rb_node) rb_root;
+RB_PROTOTYPE(rb_tree, rb_node, rb, rb_node_cmp);
+RB_GENERATE(rb_tree, rb_node, rb, rb_node_cmp);
+
 /*
  *  stress_ftrace_free()
  *	free up rb tree
@@ -437,3 +442,927 @@ void stress_ftrace_stop(void)
 {
 }
 #endif
+
+#if defined(__linux__)
+
+#define FTRACE_SCHED_HASH	(1021)		/* task hash table size */
+#define FTRACE_SCHED_BUF_KB	"4096"		/* per CPU trace buffer size */
+#define FTRACE_SCHED_RESOLVE_NS	(1000000)	/* instance lookup rate limit */
+#define FTRACE_SCHED_TRIGGER	"stacktrace if prev_state & 3"
+
+/* sched events traced, all are in events/sched */
+static const char * const ftrace_sched_events[] = {
+	"sched_switch",
+	"sched_wakeup",
+	"sched_wakeup_new",
+	"sched_process_fork",
+	"sched_process_exit",
+};
+
+/* Per task scheduling state, only used by the trace reader */
+typedef struct stress_sched_task {
+	struct stress_sched_task *next;	/* next in hash chain */
+	pid_t pid;			/* task pid */
+	pid_t ppid;			/* forking parent, 0 = unknown */
+	int32_t instance;		/* stressor instance, -1 = unknown */
+	int32_t reason;			/* function blocked in, -1 = unknown */
+	char state;			/* switched out state, 0 = on CPU */
+	bool need_reason;		/* waiting for the blocking stack */
+	uint64_t in_ns;			/* time switched in */
+	uint64_t out_ns;		/* time switched out */
+	uint64_t wake_ns;		/* time made runnable, 0 = not yet */
+	uint64_t resolve_ns;		/* time of last instance lookup */
+} stress_sched_task_t;
+
+/* Time blocked in a kernel function */
+typedef struct {
+	int32_t reason;			/* interned function name */
+	uint64_t count;			/* times blocked */
+	uint64_t time_ns;		/* total time blocked */
+} stress_sched_hit_t;
+
+typedef struct {
+	stress_stats_t *stats;		/* stats of the instance */
+	stress_sched_hit_t *hits;	/* blocking reasons */
+	size_t n_hits;			/* number of blocking reasons */
+	pid_t pid;			/* instance pid of the current run */
+} stress_sched_instance_t;
+
+static char ftrace_sched_path[PATH_MAX / 2];	/* tracefs path */
+static char ftrace_sched_buf_kb[32];	/* original trace buffer size */
+static char ftrace_sched_clock[32];	/* original trace clock */
+static bool ftrace_sched_trigger;	/* stacktrace trigger set */
+static pid_t ftrace_sched_pid;		/* trace reader pid */
+
+static stress_sched_task_t *sched_tasks[FTRACE_SCHED_HASH];
+static stress_sched_instance_t *sched_instances;
+static int32_t sched_n_instances;
+static char **sched_funcs;
+static size_t sched_n_funcs;
+static volatile bool sched_stop;
+
+/*
+ *  stress_ftrace_sched_write()
+ *	write a value to a tracefs file
+ */
+static int stress_ftrace_sched_write(const char *file, const char *value)
+{
+	char filename[PATH_MAX];
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s", ftrace_sched_path, file);
+	return (system_write(filename, value, strlen(value)) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_ftrace_sched_truncate()
+ *	truncate a tracefs file, clears the trace buffer or
+ *	pid lists, optionally writing a new value
+ */
+static int stress_ftrace_sched_truncate(const char *file, const char *value)
+{
+	char filename[PATH_MAX];
+	int fd, ret = 0;
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s", ftrace_sched_path, file);
+	fd = open(filename, O_WRONLY | O_TRUNC);
+	if (fd < 0)
+		return -1;
+	if (value && (write(fd, value, strlen(value)) < 0))
+		ret = -1;
+	(void)close(fd);
+
+	return ret;
+}
+
+/*
+ *  stress_ftrace_sched_events()
+ *	enable or disable the traced sched events
+ */
+static int stress_ftrace_sched_events(const bool enable)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(ftrace_sched_events); i++) {
+		char file[64];
+
+		(void)snprintf(file, sizeof(file), "events/sched/%s/enable",
+			ftrace_sched_events[i]);
+		if ((stress_ftrace_sched_write(file, enable ? "1" : "0") < 0) && enable)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ftrace_sched_get_path()
+ *	find the tracefs directory, either in debugfs or
+ *	the tracefs mount point
+ */
+static bool stress_ftrace_sched_get_path(void)
+{
+	char *path = stress_ftrace_get_debugfs_path();
+	char filename[PATH_MAX];
+
+	if (path) {
+		(void)snprintf(ftrace_sched_path, sizeof(ftrace_sched_path), "%s/tracing", path);
+		(void)snprintf(filename, sizeof(filename), "%s/trace_pipe", ftrace_sched_path);
+		if (access(filename, R_OK) == 0)
+			return true;
+	}
+	shim_strlcpy(ftrace_sched_path, "/sys/kernel/tracing", sizeof(ftrace_sched_path));
+	(void)snprintf(filename, sizeof(filename), "%s/trace_pipe", ftrace_sched_path);
+
+	return access(filename, R_OK) == 0;
+}
+
+/*
+ *  stress_ftrace_sched_task()
+ *	find a task, optionally creating it if it is not known
+ */
+static stress_sched_task_t *stress_ftrace_sched_task(const pid_t pid, const bool create)
+{
+	const size_t h = (size_t)pid % FTRACE_SCHED_HASH;
+	stress_sched_task_t *task;
+
+	for (task = sched_tasks[h]; task; task = task->next) {
+		if (task->pid == pid)
+			return task;
+	}
+	if (!create)
+		return NULL;
+
+	task = calloc(1, sizeof(*task));
+	if (!task)
+		return NULL;
+	task->pid = pid;
+	task->instance = -1;
+	task->reason = -1;
+	task->next = sched_tasks[h];
+	sched_tasks[h] = task;
+
+	return task;
+}
+
+/*
+ *  stress_ftrace_sched_task_free()
+ *	forget an exited task, its pid may be reused
+ */
+static void stress_ftrace_sched_task_free(const pid_t pid)
+{
+	stress_sched_task_t **prev = &sched_tasks[(size_t)pid % FTRACE_SCHED_HASH];
+	stress_sched_task_t *task;
+
+	for (task = *prev; task; prev = &task->next, task = task->next) {
+		if (task->pid == pid) {
+			*prev = task->next;
+			free(task);
+			return;
+		}
+	}
+}
+
+/*
+ *  stress_ftrace_sched_instance()
+ *	find the stressor instance of a task, either the instance
+ *	process itself or a task forked by it, NULL if not a stressor
+ */
+static stress_sched_instance_t *stress_ftrace_sched_instance(
+	stress_sched_task_t *task,
+	const uint64_t ns)
+{
+	stress_sched_task_t *parent;
+	int32_t i;
+
+	if (task->instance >= 0)
+		return &sched_instances[task->instance];
+
+	/* Instance pids are set after the fork, don't keep looking */
+	if (task->resolve_ns && (ns - task->resolve_ns < FTRACE_SCHED_RESOLVE_NS))
+		return NULL;
+	task->resolve_ns = ns ? ns : 1;
+
+	parent = task->ppid ? stress_ftrace_sched_task(task->ppid, false) : NULL;
+	if (parent && (parent->instance >= 0)) {
+		task->instance = parent->instance;
+		return &sched_instances[task->instance];
+	}
+	for (i = 0; i < sched_n_instances; i++) {
+		if (sched_instances[i].stats->pid == task->pid) {
+			/* A new run (e.g. --repeat) resets the stats, reset the reasons too */
+			if (sched_instances[i].pid != task->pid) {
+				sched_instances[i].pid = task->pid;
+				sched_instances[i].n_hits = 0;
+			}
+			task->instance = i;
+			return &sched_instances[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_ftrace_sched_func()
+ *	intern a kernel function name, returns -1 if out of memory
+ */
+static int32_t stress_ftrace_sched_func(const char *name)
+{
+	char **funcs;
+	size_t i;
+
+	for (i = 0; i < sched_n_funcs; i++) {
+		if (!strcmp(sched_funcs[i], name))
+			return (int32_t)i;
+	}
+	funcs = realloc(sched_funcs, (sched_n_funcs + 1) * sizeof(*funcs));
+	if (!funcs)
+		return -1;
+	sched_funcs = funcs;
+	sched_funcs[sched_n_funcs] = strdup(name);
+	if (!sched_funcs[sched_n_funcs])
+		return -1;
+
+	return (int32_t)sched_n_funcs++;
+}
+
+/*
+ *  stress_ftrace_sched_blocked()
+ *	account time blocked in a kernel function
+ */
+static void stress_ftrace_sched_blocked(
+	stress_sched_instance_t *inst,
+	const int32_t reason,
+	const uint64_t ns)
+{
+	stress_sched_hit_t *hits;
+	size_t i;
+
+	for (i = 0; i < inst->n_hits; i++) {
+		if (inst->hits[i].reason == reason) {
+			inst->hits[i].count++;
+			inst->hits[i].time_ns += ns;
+			return;
+		}
+	}
+	hits = realloc(inst->hits, (inst->n_hits + 1) * sizeof(*hits));
+	if (!hits)
+		return;
+	inst->hits = hits;
+	inst->hits[inst->n_hits].reason = reason;
+	inst->hits[inst->n_hits].count = 1;
+	inst->hits[inst->n_hits].time_ns = ns;
+	inst->n_hits++;
+}
+
+/*
+ *  stress_ftrace_sched_switch_out()
+ *	a task is switched out, R states are preemptions,
+ *	anything else is blocking on something
+ */
+static void stress_ftrace_sched_switch_out(
+	const pid_t pid,
+	const char *state,
+	const uint64_t ns)
+{
+	stress_sched_task_t *task;
+	stress_sched_instance_t *inst;
+
+	/* Exiting tasks are no longer interesting */
+	if ((*state == 'Z') || (*state == 'X'))
+		return;
+	task = stress_ftrace_sched_task(pid, true);
+	if (!task)
+		return;
+	inst = stress_ftrace_sched_instance(task, ns);
+
+	if (inst && task->in_ns && (ns >= task->in_ns))
+		inst->stats->sched.on_cpu_ns += ns - task->in_ns;
+	task->in_ns = 0;
+	task->out_ns = ns;
+	task->reason = -1;
+	if (*state == 'R') {
+		task->state = 'R';
+		task->wake_ns = ns;
+		task->need_reason = false;
+		if (inst)
+			inst->stats->sched.involuntary++;
+	} else {
+		task->state = *state;
+		task->wake_ns = 0;
+		task->need_reason = true;
+		if (inst)
+			inst->stats->sched.voluntary++;
+	}
+}
+
+/*
+ *  stress_ftrace_sched_switch_in()
+ *	a task is switched in, account the time it was off the
+ *	CPU, how long it was blocked and how long it waited to run
+ */
+static void stress_ftrace_sched_switch_in(const pid_t pid, const uint64_t ns)
+{
+	stress_sched_task_t *task;
+	stress_sched_instance_t *inst;
+
+	task = stress_ftrace_sched_task(pid, true);
+	if (!task)
+		return;
+	inst = stress_ftrace_sched_instance(task, ns);
+
+	if (inst && task->out_ns && (ns >= task->out_ns)) {
+		stress_sched_stats_t *sched = &inst->stats->sched;
+
+		sched->off_cpu_ns += ns - task->out_ns;
+		if (task->wake_ns && (ns >= task->wake_ns)) {
+			stress_latency_t *wait = &sched->runq_wait;
+			const uint64_t wait_ns = ns - task->wake_ns;
+
+			wait->bucket[stress_latency_index(wait_ns)]++;
+			if ((wait->count == 0) || (wait_ns < wait->min))
+				wait->min = wait_ns;
+			if (wait_ns > wait->max)
+				wait->max = wait_ns;
+			wait->count++;
+		}
+		if (task->state != 'R') {
+			const uint64_t woken = task->wake_ns ? task->wake_ns : ns;
+			const uint64_t blocked_ns = (woken > task->out_ns) ? woken - task->out_ns : 0;
+
+			if (task->state == 'S')
+				sched->sleep_ns += blocked_ns;
+			else
+				sched->block_ns += blocked_ns;
+			stress_ftrace_sched_blocked(inst, task->reason, blocked_ns);
+		}
+	}
+	task->in_ns = ns;
+	task->out_ns = 0;
+	task->wake_ns = 0;
+	task->state = 0;
+	task->need_reason = false;
+}
+
+/*
+ *  stress_ftrace_sched_field()
+ *	find the value of a name=value field in a trace event
+ */
+static inline char *stress_ftrace_sched_field(char *str, const char *field)
+{
+	char *ptr = strstr(str, field);
+
+	return ptr ? ptr + strlen(field) : NULL;
+}
+
+/*
+ *  stress_ftrace_sched_parse()
+ *	parse a line from trace_pipe, lines are of the form
+ *	"comm-pid [cpu] flags secs.usecs: event: fields" or
+ *	" => func" for the frames of a stack trace
+ */
+static void stress_ftrace_sched_parse(char *line, pid_t *stack_pid)
+{
+	char *event, *ptr, *value;
+	uint64_t ns;
+	double secs;
+
+	if (!strncmp(line, " => ", 4)) {
+		stress_sched_task_t *task;
+		char *func = line + 4;
+
+		if (!*stack_pid)
+			return;
+		/* Skip the tracing and scheduler frames */
+		if (strstr(func, "trace") || strstr(func, "schedule"))
+			return;
+		for (ptr = func; *ptr && (*ptr != '+') && !isspace((int)*ptr); ptr++)
+			;
+		*ptr = '\0';
+		task = stress_ftrace_sched_task(*stack_pid, false);
+		if (task && task->need_reason) {
+			task->reason = stress_ftrace_sched_func(func);
+			task->need_reason = false;
+		}
+		*stack_pid = 0;
+		return;
+	}
+
+	event = strstr(line, ": ");
+	if (!event)
+		return;
+	*stack_pid = 0;
+
+	/* Timestamp precedes the event name */
+	*event = '\0';
+	ptr = strrchr(line, ' ');
+	if (!ptr || (sscanf(ptr + 1, "%lf", &secs) != 1))
+		return;
+	ns = (uint64_t)(secs * (double)STRESS_NANOSECOND);
+	event += 2;
+
+	if (!strncmp(event, "<stack trace>", 13)) {
+		/* pid of the task is after the last - before the [cpu] */
+		ptr = strstr(line, " [");
+		if (!ptr)
+			return;
+		*ptr = '\0';
+		ptr = strrchr(line, '-');
+		if (ptr)
+			*stack_pid = (pid_t)atoi(ptr + 1);
+	} else if (!strncmp(event, "sched_switch: ", 14)) {
+		char *state, *next;
+
+		value = stress_ftrace_sched_field(event, " prev_pid=");
+		state = stress_ftrace_sched_field(event, " prev_state=");
+		next = stress_ftrace_sched_field(event, " next_pid=");
+		if (!value || !state || !next)
+			return;
+		stress_ftrace_sched_switch_out((pid_t)atoi(value), state, ns);
+		stress_ftrace_sched_switch_in((pid_t)atoi(next), ns);
+	} else if (!strncmp(event, "sched_wakeup", 12)) {
+		stress_sched_task_t *task;
+
+		/* sched_wakeup and sched_wakeup_new */
+		value = stress_ftrace_sched_field(event, " pid=");
+		if (!value)
+			return;
+		task = stress_ftrace_sched_task((pid_t)atoi(value), true);
+		if (task && task->out_ns && !task->wake_ns)
+			task->wake_ns = ns;
+	} else if (!strncmp(event, "sched_process_fork: ", 20)) {
+		stress_sched_task_t *task;
+		char *child;
+
+		value = stress_ftrace_sched_field(event, " pid=");
+		child = stress_ftrace_sched_field(event, " child_pid=");
+		if (!value || !child)
+			return;
+		stress_ftrace_sched_task_free((pid_t)atoi(child));
+		task = stress_ftrace_sched_task((pid_t)atoi(child), true);
+		if (task) {
+			stress_sched_task_t *parent;
+
+			task->ppid = (pid_t)atoi(value);
+			parent = stress_ftrace_sched_task(task->ppid, false);
+			if (parent)
+				task->instance = parent->instance;
+		}
+	} else if (!strncmp(event, "sched_process_exit: ", 20)) {
+		value = stress_ftrace_sched_field(event, " pid=");
+		if (value)
+			stress_ftrace_sched_task_free((pid_t)atoi(value));
+	}
+}
+
+/*
+ *  stress_ftrace_sched_hit_cmp()
+ *	sort blocking reasons, longest blocked time first
+ */
+static int stress_ftrace_sched_hit_cmp(const void *p1, const void *p2)
+{
+	const stress_sched_hit_t *h1 = (const stress_sched_hit_t *)p1;
+	const stress_sched_hit_t *h2 = (const stress_sched_hit_t *)p2;
+
+	if (h1->time_ns < h2->time_ns)
+		return 1;
+	if (h1->time_ns > h2->time_ns)
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_sched_sigusr1()
+ *	stop reading trace events
+ */
+static void MLOCKED_TEXT stress_ftrace_sched_sigusr1(int signum)
+{
+	(void)signum;
+
+	sched_stop = true;
+}
+
+/*
+ *  stress_ftrace_sched_reader()
+ *	read and analyze the sched events until told to stop,
+ *	the top blocking reasons are then copied to the stats
+ */
+static void stress_ftrace_sched_reader(const pid_t ppid)
+{
+	static char buf[65536];
+	char filename[PATH_MAX];
+	pid_t stack_pid = 0;
+	size_t len = 0;
+	int32_t i;
+	int fd;
+
+	(void)snprintf(filename, sizeof(filename), "%s/trace_pipe", ftrace_sched_path);
+	fd = open(filename, O_RDONLY | O_NONBLOCK);
+	if (fd < 0) {
+		pr_inf("ftrace-sched: cannot open %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+
+	for (;;) {
+		ssize_t n;
+		char *line, *eol;
+
+		if (!sched_stop && (getppid() != ppid))
+			break;
+		n = read(fd, buf + len, sizeof(buf) - 1 - len);
+		if (n < 0) {
+			if ((errno != EAGAIN) && (errno != EINTR))
+				break;
+			/* Drained all the events after being stopped? */
+			if (sched_stop)
+				break;
+			(void)shim_usleep(20000);
+			continue;
+		}
+		if (n == 0)
+			break;
+		len += (size_t)n;
+		buf[len] = '\0';
+
+		for (line = buf; (eol = strchr(line, '\n')) != NULL; line = eol + 1) {
+			*eol = '\0';
+			stress_ftrace_sched_parse(line, &stack_pid);
+		}
+		len = strlen(line);
+		/* Discard over-long lines */
+		if (len >= sizeof(buf) - 1)
+			len = 0;
+		(void)memmove(buf, line, len);
+	}
+	(void)close(fd);
+
+	for (i = 0; i < sched_n_instances; i++) {
+		stress_sched_instance_t *inst = &sched_instances[i];
+		size_t j;
+
+		qsort(inst->hits, inst->n_hits, sizeof(*inst->hits), stress_ftrace_sched_hit_cmp);
+		for (j = 0; (j < inst->n_hits) && (j < STRESS_SCHED_REASONS); j++) {
+			stress_sched_reason_t *reason = &inst->stats->sched.reason[j];
+			const int32_t idx = inst->hits[j].reason;
+
+			shim_strlcpy(reason->func, (idx >= 0) ? sched_funcs[idx] : "unknown",
+				sizeof(reason->func));
+			reason->count = inst->hits[j].count;
+			reason->time_ns = inst->hits[j].time_ns;
+		}
+	}
+}
+
+/*
+ *  stress_ftrace_sched_restore()
+ *	put the tracing settings back as they were
+ */
+static void stress_ftrace_sched_restore(void)
+{
+	(void)stress_ftrace_sched_events(false);
+	if (ftrace_sched_trigger) {
+		(void)stress_ftrace_sched_write("events/sched/sched_switch/trigger",
+			"!" FTRACE_SCHED_TRIGGER);
+		ftrace_sched_trigger = false;
+	}
+	(void)stress_ftrace_sched_write("options/event-fork", "0");
+	(void)stress_ftrace_sched_truncate("set_event_pid", NULL);
+	if (*ftrace_sched_buf_kb)
+		(void)stress_ftrace_sched_write("buffer_size_kb", ftrace_sched_buf_kb);
+	if (*ftrace_sched_clock)
+		(void)stress_ftrace_sched_write("trace_clock", ftrace_sched_clock);
+}
+
+/*
+ *  stress_ftrace_sched_start()
+ *	start tracing the scheduling events of the stressors,
+ *	a reader process parses the events as they occur
+ */
+void stress_ftrace_sched_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	char pid_str[32], filename[PATH_MAX], buf[256];
+	const pid_t ppid = getpid();
+	int32_t n = 0;
+	int status;
+
+	if (!(g_opt_flags & OPT_FLAGS_FTRACE_SCHED))
+		return;
+
+	if (!stress_check_capability(SHIM_CAP_SYS_ADMIN)) {
+		pr_inf("ftrace-sched: requires CAP_SYS_ADMIN capability for tracing\n");
+		return;
+	}
+	if (!stress_ftrace_sched_get_path()) {
+		pr_inf("ftrace-sched: cannot find a mounted tracefs or debugfs\n");
+		return;
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n += ss->num_instances;
+	sched_instances = calloc((size_t)n, sizeof(*sched_instances));
+	if (!sched_instances) {
+		pr_inf("ftrace-sched: cannot allocate instance information\n");
+		return;
+	}
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->num_instances; j++)
+			sched_instances[sched_n_instances++].stats = ss->stats[j];
+	}
+
+	/* Larger buffer to ride out bursts of context switches */
+	(void)snprintf(filename, sizeof(filename), "%s/buffer_size_kb", ftrace_sched_path);
+	(void)memset(ftrace_sched_buf_kb, 0, sizeof(ftrace_sched_buf_kb));
+	if (system_read(filename, ftrace_sched_buf_kb, sizeof(ftrace_sched_buf_kb) - 1) > 0) {
+		char *ptr;
+
+		/* May be followed by "(expanded: N)" */
+		for (ptr = ftrace_sched_buf_kb; isdigit((int)*ptr); ptr++)
+			;
+		*ptr = '\0';
+		(void)stress_ftrace_sched_write("buffer_size_kb", FTRACE_SCHED_BUF_KB);
+	}
+
+	/*
+	 *  The default local clock is not synchronized across CPUs,
+	 *  a task can sleep on one CPU and run on another so use a
+	 *  global clock for the on and off CPU times
+	 */
+	(void)snprintf(filename, sizeof(filename), "%s/trace_clock", ftrace_sched_path);
+	(void)memset(ftrace_sched_clock, 0, sizeof(ftrace_sched_clock));
+	if (system_read(filename, buf, sizeof(buf) - 1) > 0) {
+		char *start, *end;
+
+		/* Current clock is in brackets, e.g. "[local] global counter" */
+		start = strchr(buf, '[');
+		end = start ? strchr(start, ']') : NULL;
+		if (end) {
+			*end = '\0';
+			(void)shim_strlcpy(ftrace_sched_clock, start + 1, sizeof(ftrace_sched_clock));
+		}
+		if ((stress_ftrace_sched_write("trace_clock", "mono") < 0) &&
+		    (stress_ftrace_sched_write("trace_clock", "global") < 0))
+			pr_dbg("ftrace-sched: cannot set a global trace clock, "
+				"times of tasks that migrate may be skewed\n");
+	}
+	(void)stress_ftrace_sched_truncate("trace", NULL);
+
+	/* Reader is forked before the pid filter so it is not traced */
+	ftrace_sched_pid = fork();
+	if (ftrace_sched_pid < 0) {
+		pr_inf("ftrace-sched: cannot fork trace reader process, "
+			"errno=%d (%s)\n", errno, strerror(errno));
+		ftrace_sched_pid = 0;
+		goto err_restore;
+	} else if (ftrace_sched_pid == 0) {
+		stress_set_proc_name("stress-ng-ftrace");
+		/* SIGALRM is used to stop stressors, not the reader */
+		if ((stress_sighandler("ftrace-sched", SIGALRM, SIG_IGN, NULL) < 0) ||
+		    (stress_sighandler("ftrace-sched", SIGUSR1, stress_ftrace_sched_sigusr1, NULL) < 0))
+			_exit(0);
+		stress_ftrace_sched_reader(ppid);
+		_exit(0);
+	}
+
+	(void)snprintf(pid_str, sizeof(pid_str), "%" PRIdMAX, (intmax_t)ppid);
+	if ((stress_ftrace_sched_write("options/event-fork", "1") < 0) ||
+	    (stress_ftrace_sched_truncate("set_event_pid", pid_str) < 0)) {
+		pr_inf("ftrace-sched: cannot set event pid filter, errno=%d (%s)\n",
+			errno, strerror(errno));
+		goto err_reader;
+	}
+	/* Kernel stacks of blocking switches give the blocking reasons */
+	if (stress_ftrace_sched_write("events/sched/sched_switch/trigger", FTRACE_SCHED_TRIGGER) < 0)
+		pr_dbg("ftrace-sched: cannot set sched_switch stacktrace trigger, "
+			"blocking reasons will be unknown\n");
+	else
+		ftrace_sched_trigger = true;
+	if (stress_ftrace_sched_events(true) < 0) {
+		pr_inf("ftrace-sched: cannot enable sched events, errno=%d (%s)\n",
+			errno, strerror(errno));
+		goto err_reader;
+	}
+	(void)stress_ftrace_sched_write("tracing_on", "1");
+	return;
+
+err_reader:
+	(void)kill(ftrace_sched_pid, SIGKILL);
+	(void)shim_waitpid(ftrace_sched_pid, &status, 0);
+	ftrace_sched_pid = 0;
+err_restore:
+	stress_ftrace_sched_restore();
+}
+
+/*
+ *  stress_ftrace_sched_stop()
+ *	stop tracing the sched events, the reader drains the
+ *	remaining events before it exits
+ */
+void stress_ftrace_sched_stop(void)
+{
+	int status;
+
+	if (!ftrace_sched_pid)
+		return;
+
+	(void)stress_ftrace_sched_events(false);
+	(void)kill(ftrace_sched_pid, SIGUSR1);
+	(void)shim_waitpid(ftrace_sched_pid, &status, 0);
+	ftrace_sched_pid = 0;
+	stress_ftrace_sched_restore();
+	free(sched_instances);
+	sched_instances = NULL;
+	sched_n_instances = 0;
+}
+
+/*
+ *  stress_ftrace_sched_reason_merge()
+ *	merge the blocking reasons of a stressor instance
+ */
+static size_t stress_ftrace_sched_reason_merge(
+	stress_sched_reason_t *reasons,
+	size_t n,
+	const size_t max,
+	const stress_sched_reason_t *reason)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (!strcmp(reasons[i].func, reason->func)) {
+			reasons[i].count += reason->count;
+			reasons[i].time_ns += reason->time_ns;
+			return n;
+		}
+	}
+	if (n < max)
+		reasons[n++] = *reason;
+	return n;
+}
+
+/*
+ *  stress_ftrace_sched_reason_cmp()
+ *	sort blocking reasons, longest blocked time first
+ */
+static int stress_ftrace_sched_reason_cmp(const void *p1, const void *p2)
+{
+	const stress_sched_reason_t *r1 = (const stress_sched_reason_t *)p1;
+	const stress_sched_reason_t *r2 = (const stress_sched_reason_t *)p2;
+
+	if (r1->time_ns < r2->time_ns)
+		return 1;
+	if (r1->time_ns > r2->time_ns)
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_sched_dump()
+ *	dump the off-CPU time, run queue wait latencies and the
+ *	top blocking reasons of each stressor
+ */
+void stress_ftrace_sched_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_FTRACE_SCHED))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_sched_stats_t sum;
+		stress_sched_reason_t *reasons;
+		const size_t max = (size_t)ss->started_instances * STRESS_SCHED_REASONS;
+		size_t i, n = 0;
+		double off_cpu, on_cpu, pc;
+		uint64_t blocked_ns;
+		char buf[256];
+		int32_t j;
+		int len = 0;
+
+		if (!ss->stats || (ss->started_instances < 1))
+			continue;
+		reasons = calloc(max, sizeof(*reasons));
+		if (!reasons)
+			continue;
+
+		(void)memset(&sum, 0, sizeof(sum));
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_sched_stats_t *sched = &ss->stats[j]->sched;
+			const stress_latency_t *l = &sched->runq_wait;
+
+			sum.on_cpu_ns += sched->on_cpu_ns;
+			sum.off_cpu_ns += sched->off_cpu_ns;
+			sum.sleep_ns += sched->sleep_ns;
+			sum.block_ns += sched->block_ns;
+			sum.voluntary += sched->voluntary;
+			sum.involuntary += sched->involuntary;
+			if (l->count) {
+				if ((sum.runq_wait.count == 0) || (l->min < sum.runq_wait.min))
+					sum.runq_wait.min = l->min;
+				if (l->max > sum.runq_wait.max)
+					sum.runq_wait.max = l->max;
+				sum.runq_wait.count += l->count;
+				for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+					sum.runq_wait.bucket[i] += l->bucket[i];
+			}
+			for (i = 0; (i < STRESS_SCHED_REASONS) && sched->reason[i].count; i++)
+				n = stress_ftrace_sched_reason_merge(reasons, n, max, &sched->reason[i]);
+		}
+		if (!sum.voluntary && !sum.involuntary) {
+			free(reasons);
+			continue;
+		}
+		qsort(reasons, n, sizeof(*reasons), stress_ftrace_sched_reason_cmp);
+
+		if (!header) {
+			pr_inf("ftrace-sched: off-CPU time and run queue waits of the stressors:\n");
+			pr_yaml(yaml, "ftrace-sched:\n");
+			header = true;
+		}
+		off_cpu = (double)sum.off_cpu_ns / (double)STRESS_NANOSECOND;
+		on_cpu = (double)sum.on_cpu_ns / (double)STRESS_NANOSECOND;
+		pc = (on_cpu + off_cpu > 0.0) ? 100.0 * off_cpu / (on_cpu + off_cpu) : 0.0;
+		pr_inf("%-13s off-CPU %.2fs (%.1f%%), sleeping %.2fs, blocked %.2fs, "
+			"%" PRIu64 " voluntary, %" PRIu64 " involuntary switches\n",
+			munged, off_cpu, pc,
+			(double)sum.sleep_ns / (double)STRESS_NANOSECOND,
+			(double)sum.block_ns / (double)STRESS_NANOSECOND,
+			sum.voluntary, sum.involuntary);
+		if (sum.runq_wait.count) {
+			pr_inf("%-13s run queue wait (ns): p50 %" PRIu64 ", p90 %" PRIu64
+				", p99 %" PRIu64 ", max %" PRIu64 " (%" PRIu64 " waits)\n",
+				munged,
+				stress_latency_percentile(&sum.runq_wait, 50.0),
+				stress_latency_percentile(&sum.runq_wait, 90.0),
+				stress_latency_percentile(&sum.runq_wait, 99.0),
+				sum.runq_wait.max, sum.runq_wait.count);
+		}
+
+		blocked_ns = sum.sleep_ns + sum.block_ns;
+		*buf = '\0';
+		for (i = 0; (i < n) && (i < 4) && blocked_ns; i++) {
+			if (len < (int)sizeof(buf) - 64)
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s %s %.1f%%",
+					i ? "," : "", reasons[i].func,
+					100.0 * (double)reasons[i].time_ns / (double)blocked_ns);
+		}
+		if (*buf)
+			pr_inf("%-13s blocked in:%s\n", munged, buf);
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      on-cpu-seconds: %f\n", on_cpu);
+		pr_yaml(yaml, "      off-cpu-seconds: %f\n", off_cpu);
+		pr_yaml(yaml, "      off-cpu-percent: %f\n", pc);
+		pr_yaml(yaml, "      sleep-seconds: %f\n", (double)sum.sleep_ns / (double)STRESS_NANOSECOND);
+		pr_yaml(yaml, "      blocked-seconds: %f\n", (double)sum.block_ns / (double)STRESS_NANOSECOND);
+		pr_yaml(yaml, "      voluntary-switches: %" PRIu64 "\n", sum.voluntary);
+		pr_yaml(yaml, "      involuntary-switches: %" PRIu64 "\n", sum.involuntary);
+		if (sum.runq_wait.count) {
+			pr_yaml(yaml, "      run-queue-wait-ns:\n");
+			pr_yaml(yaml, "        waits: %" PRIu64 "\n", sum.runq_wait.count);
+			pr_yaml(yaml, "        min: %" PRIu64 "\n", sum.runq_wait.min);
+			pr_yaml(yaml, "        p50: %" PRIu64 "\n", stress_latency_percentile(&sum.runq_wait, 50.0));
+			pr_yaml(yaml, "        p90: %" PRIu64 "\n", stress_latency_percentile(&sum.runq_wait, 90.0));
+			pr_yaml(yaml, "        p99: %" PRIu64 "\n", stress_latency_percentile(&sum.runq_wait, 99.0));
+			pr_yaml(yaml, "        max: %" PRIu64 "\n", sum.runq_wait.max);
+		}
+		if (n && blocked_ns) {
+			pr_yaml(yaml, "      blocking-reasons:\n");
+			for (i = 0; (i < n) && (i < STRESS_SCHED_REASONS); i++) {
+				pr_yaml(yaml, "        - function: %s\n", reasons[i].func);
+				pr_yaml(yaml, "          count: %" PRIu64 "\n", reasons[i].count);
+				pr_yaml(yaml, "          seconds: %f\n",
+					(double)reasons[i].time_ns / (double)STRESS_NANOSECOND);
+				pr_yaml(yaml, "          percent: %f\n",
+					100.0 * (double)reasons[i].time_ns / (double)blocked_ns);
+			}
+		}
+		free(reasons);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+}
+
+#else
+void stress_ftrace_sched_start(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+
+	if (!(g_opt_flags & OPT_FLAGS_FTRACE_SCHED))
+		return;
+	pr_inf("ftrace-sched: this option is not implemented on this system: %s %s\n",
+		stress_get_uname_info(), stress_get_compiler());
+}
+
+void stress_ftrace_sched_stop(void)
+{
+}
+
+void stress_ftrace_sched_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	(void)yaml;
+	(void)stressors_list;
+}
+#endif
@@ -25,4 +25,9 @@ extern void stress_ftrace_stop(void);
 extern void stress_ftrace_free(void);
 extern void stress_ftrace_add_pid(const pid_t pid);
 
+/* ftrace sched event analysis */
+extern void stress_ftrace_sched_start(stress_stressor_t *stressors_list);
+extern void stress_ftrace_sched_stop(void);
+extern void stress_ftrace_sched_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
 #endif
@@ -392,6 +392,123 @@ int32_t stress_get_ticks_per_second(void)
 #endif
 }
 
+/*
+ *  stress_get_thread_times()
+ *	fill in tms with the CPU time used by the calling thread,
+ *	times() can only report on the whole process
+ */
+void stress_get_thread_times(struct tms *tms)
+{
+	const int32_t ticks = stress_get_ticks_per_second();
+#if defined(RUSAGE_THREAD)
+	struct rusage usage;
+#endif
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+#endif
+
+	(void)memset(tms, 0, sizeof(*tms));
+	if (ticks <= 0)
+		return;
+#if defined(RUSAGE_THREAD)
+	if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+		tms->tms_utime = (clock_t)(((int64_t)usage.ru_utime.tv_sec * ticks) +
+			((int64_t)usage.ru_utime.tv_usec * ticks) / 1000000);
+		tms->tms_stime = (clock_t)(((int64_t)usage.ru_stime.tv_sec * ticks) +
+			((int64_t)usage.ru_stime.tv_usec * ticks) / 1000000);
+		return;
+	}
+#endif
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_THREAD_CPUTIME_ID)
+	/* No user/system split, account it all as user time */
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+		tms->tms_utime = (clock_t)(((int64_t)ts.tv_sec * ticks) +
+			((int64_t)ts.tv_nsec * ticks) / STRESS_NANOSECOND);
+		return;
+	}
+#endif
+	pr_dbg("cannot determine per thread CPU times\n");
+}
+
+/*
+ *  stress_get_rusage()
+ *	get the resource usage of the calling process and its
+ *	reaped children, or of the calling thread when threaded,
+ *	the block I/O counts are from /proc/self/io where available
+ */
+void stress_get_rusage(stress_rusage_stats_t *rusage, const bool threaded)
+{
+	struct rusage usage;
+	int i;
+
+	(void)memset(rusage, 0, sizeof(*rusage));
+
+	for (i = 0; i < 2; i++) {
+		int who;
+
+		if (i == 0) {
+#if defined(RUSAGE_THREAD)
+			who = threaded ? RUSAGE_THREAD : RUSAGE_SELF;
+#else
+			who = RUSAGE_SELF;
+#endif
+		} else {
+			/* Threads cannot separate out the children of other threads */
+			if (threaded)
+				break;
+			who = RUSAGE_CHILDREN;
+		}
+		if (getrusage(who, &usage) < 0)
+			return;
+		rusage->value[STRESS_RUSAGE_NVCSW] += (uint64_t)usage.ru_nvcsw;
+		rusage->value[STRESS_RUSAGE_NIVCSW] += (uint64_t)usage.ru_nivcsw;
+		rusage->value[STRESS_RUSAGE_MINFLT] += (uint64_t)usage.ru_minflt;
+		rusage->value[STRESS_RUSAGE_MAJFLT] += (uint64_t)usage.ru_majflt;
+		rusage->value[STRESS_RUSAGE_INBLOCK] += (uint64_t)usage.ru_inblock;
+		rusage->value[STRESS_RUSAGE_OUBLOCK] += (uint64_t)usage.ru_oublock;
+	}
+	rusage->valid = true;
+
+#if defined(__linux__)
+	{
+		char buf[512];
+		char *ptr;
+		static const struct {
+			const char *name;
+			const size_t len;
+			const stress_rusage_index_t index;
+		} io_fields[] = {
+			{ "syscr:",		6,	STRESS_RUSAGE_SYSCR },
+			{ "syscw:",		6,	STRESS_RUSAGE_SYSCW },
+			{ "read_bytes:",	11,	STRESS_RUSAGE_READ_BYTES },
+			{ "write_bytes:",	12,	STRESS_RUSAGE_WRITE_BYTES },
+		};
+
+		/* The I/O counts of reaped children are included by the kernel */
+		if (system_read(threaded ? "/proc/thread-self/io" : "/proc/self/io",
+				buf, sizeof(buf)) <= 0)
+			return;
+		for (ptr = buf; ptr && *ptr; ) {
+			size_t j;
+
+			for (j = 0; j < SIZEOF_ARRAY(io_fields); j++) {
+				if (!strncmp(ptr, io_fields[j].name, io_fields[j].len)) {
+					(void)sscanf(ptr + io_fields[j].len, "%" SCNu64,
+						&rusage->value[io_fields[j].index]);
+					break;
+				}
+			}
+			ptr = strchr(ptr, '\n');
+			if (ptr)
+				ptr++;
+		}
+		rusage->io_valid = true;
+	}
+#endif
+}
+
 /*
  *  stress_get_memlimits()
  *	get SHMALL and memory in system
@@ -2834,3 +2951,37 @@ void stress_clear_warn_once(void)
 		(void)system_write("/sys/kernel/debug/clear_warn_once", "1", 1);
 #endif
 }
+
+/*
+ *  stress_counter_batch_init()
+ *	initialize a batched bogo ops counter, the first
+ *	batch publishes after just one op
+ */
+void stress_counter_batch_init(stress_counter_batch_t *cb)
+{
+	cb->pending = 0;
+	cb->batch = 1;
+	cb->t_publish = stress_time_now();
+}
+
+/*
+ *  stress_counter_batch_publish()
+ *	publish batched bogo ops to the shared counter and adapt
+ *	the batch size so that publishing occurs about every
+ *	STRESS_COUNTER_BATCH_USEC microseconds
+ */
+void stress_counter_batch_publish(const stress_args_t *args, stress_counter_batch_t *cb)
+{
+	const double now = stress_time_now();
+	const double delta = now - cb->t_publish;
+	const double period = (double)STRESS_COUNTER_BATCH_USEC / 1000000.0;
+
+	add_counter(args, cb->pending);
+	cb->pending = 0;
+	cb->t_publish = now;
+
+	if ((delta < period * 0.5) && (cb->batch < STRESS_COUNTER_BATCH_MAX))
+		cb->batch <<= 1;
+	else if ((delta > period * 2.0) && (cb->batch > 1))
+		cb->batch >>= 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-interference.h"
+
+#define INTERFERENCE_SLOWDOWN	(0.90)	/* relative throughput to flag */
+
+/* Throughput of a victim stressor when run with an aggressor */
+typedef struct {
+	uint64_t bogo_ops;		/* bogo ops of all instances */
+	double wall_time;		/* average wall clock time */
+	bool valid;			/* true if the run was made */
+} stress_interference_run_t;
+
+static stress_interference_run_t *interference_runs;	/* [victim][aggressor] */
+static size_t interference_stressors;
+
+/*
+ *  stress_interference_init()
+ *	allocate the victim x aggressor results matrix, the
+ *	diagonal holds the results of each stressor run alone
+ */
+int stress_interference_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!(g_opt_flags & OPT_FLAGS_INTERFERENCE))
+		return 0;
+
+	for (interference_stressors = 0, ss = stressors_list; ss; ss = ss->next)
+		interference_stressors++;
+	if (!interference_stressors)
+		return 0;
+
+	interference_runs = calloc(interference_stressors * interference_stressors,
+		sizeof(*interference_runs));
+	if (!interference_runs) {
+		pr_err("cannot allocate interference results for %zu stressors\n",
+			interference_stressors);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_interference_record()
+ *	record the results of the victim stressor when run with
+ *	the aggressor stressor, victim == aggressor for a solo run
+ */
+void stress_interference_record(
+	const size_t victim,
+	const size_t aggressor,
+	const uint64_t bogo_ops,
+	const double wall_time)
+{
+	stress_interference_run_t *r;
+
+	if (!interference_runs ||
+	    (victim >= interference_stressors) ||
+	    (aggressor >= interference_stressors))
+		return;
+	r = &interference_runs[(victim * interference_stressors) + aggressor];
+	r->bogo_ops = bogo_ops;
+	r->wall_time = wall_time;
+	r->valid = true;
+}
+
+/*
+ *  stress_interference_rate()
+ *	bogo ops per second of a run, 0 if not run
+ */
+static double stress_interference_rate(const stress_interference_run_t *r)
+{
+	return (r->valid && (r->wall_time > 0.0)) ?
+		(double)r->bogo_ops / r->wall_time : 0.0;
+}
+
+/*
+ *  stress_interference_dump()
+ *	report the slowdown matrix, the throughput of each victim
+ *	stressor with each aggressor relative to its solo throughput
+ */
+void stress_interference_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *victim, *aggressor;
+	double worst = 0.0;
+	const char *worst_victim = NULL, *worst_aggressor = NULL;
+	char buf[256];
+	size_t i, j;
+	int len;
+
+	if (!interference_runs)
+		return;
+
+	pr_yaml(yaml, "interference:\n");
+	pr_inf("interference: victim throughput with an aggressor relative to "
+		"its solo throughput\n");
+
+	len = snprintf(buf, sizeof(buf), "%-13s %12s", "victim", "solo ops/s");
+	for (aggressor = stressors_list, j = 0; aggressor && (j < interference_stressors);
+	     aggressor = aggressor->next, j++) {
+		len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %8.8s",
+			stress_munge_underscore(aggressor->stressor->name));
+		if ((size_t)len >= sizeof(buf))
+			break;
+	}
+	pr_inf("%s\n", buf);
+
+	for (i = 0, victim = stressors_list; victim && (i < interference_stressors);
+	     victim = victim->next, i++) {
+		const stress_interference_run_t *runs = &interference_runs[i * interference_stressors];
+		const double solo = stress_interference_rate(&runs[i]);
+		char munged[64];
+
+		(void)shim_strlcpy(munged, stress_munge_underscore(victim->stressor->name),
+			sizeof(munged));
+		if (!runs[i].valid)
+			continue;
+
+		pr_yaml(yaml, "    - victim: %s\n", munged);
+		pr_yaml(yaml, "      solo-bogo-ops-per-second-real-time: %f\n", solo);
+		pr_yaml(yaml, "      aggressors:\n");
+
+		len = snprintf(buf, sizeof(buf), "%-13s %12.2f", munged, solo);
+		for (aggressor = stressors_list, j = 0; aggressor && (j < interference_stressors);
+		     aggressor = aggressor->next, j++) {
+			const double rate = stress_interference_rate(&runs[j]);
+			double relative;
+
+			if ((i == j) || !runs[j].valid || (solo <= 0.0)) {
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %8s", "-");
+				if ((size_t)len >= sizeof(buf))
+					break;
+				continue;
+			}
+			relative = rate / solo;
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %8.2f", relative);
+			if ((size_t)len >= sizeof(buf))
+				break;
+
+			if (!worst_victim || (relative < worst)) {
+				worst = relative;
+				worst_victim = victim->stressor->name;
+				worst_aggressor = aggressor->stressor->name;
+			}
+			pr_yaml(yaml, "        - aggressor: %s\n",
+				stress_munge_underscore(aggressor->stressor->name));
+			pr_yaml(yaml, "          bogo-ops-per-second-real-time: %f\n", rate);
+			pr_yaml(yaml, "          relative-throughput: %f\n", relative);
+		}
+		pr_inf("%s\n", buf);
+		pr_yaml(yaml, "\n");
+	}
+
+	if (worst_victim && (worst < INTERFERENCE_SLOWDOWN)) {
+		char munged[64];
+
+		(void)shim_strlcpy(munged, stress_munge_underscore(worst_victim), sizeof(munged));
+		pr_inf("interference: %s is most sensitive, %.0f%% of its solo throughput "
+			"with %s\n", munged, 100.0 * worst,
+			stress_munge_underscore(worst_aggressor));
+	}
+}
+
+/*
+ *  stress_interference_free()
+ *	free the interference results matrix
+ */
+void stress_interference_free(void)
+{
+	free(interference_runs);
+	interference_runs = NULL;
+	interference_stressors = 0;
+}
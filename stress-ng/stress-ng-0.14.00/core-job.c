@@ -25,6 +25,20 @@
 
 #define ISBLANK(ch)	isblank((int)(ch))
 
+typedef struct {
+	char *line;		/* job line without comments */
+	char *txt;		/* original job line for error messages */
+	uint32_t lineno;	/* job file line number */
+} stress_job_line_t;
+
+static stress_job_line_t *job_lines;	/* lines of the current phase */
+static size_t job_nlines;		/* number of lines in the phase */
+static ssize_t job_sweep = -1;		/* index of the sweep line, -1 if none */
+static uint32_t job_phase;		/* current phase number */
+static char *job_phase_name;		/* current phase name, NULL if none */
+static uint32_t job_lineno;		/* current job file line number */
+static char job_txt[4096];		/* current job file line */
+
 /*
  *  stress_chop()
  *	chop off end of line that matches char ch
@@ -92,6 +106,292 @@ static void stress_parse_error(
 		lineno, line);
 }
 
+/*
+ *  stress_job_keyword()
+ *	return true if the first word of a job line
+ *	is the given job keyword
+ */
+static bool stress_job_keyword(const char *line, const char *keyword)
+{
+	const size_t len = strlen(keyword);
+
+	while (ISBLANK(*line))
+		line++;
+	if (strncmp(line, keyword, len))
+		return false;
+	return !line[len] || ISBLANK(line[len]);
+}
+
+/*
+ *  stress_job_tokenize()
+ *	split a job line into argv style tokens, argv[0]
+ *	is reserved for the program name
+ */
+static int stress_job_tokenize(char *ptr, char **new_argv)
+{
+	int new_argc = 1;
+
+	/* skip leading blanks */
+	while (ISBLANK(*ptr))
+		ptr++;
+
+	while (new_argc < MAX_ARGS && *ptr) {
+		new_argv[new_argc++] = ptr;
+
+		/* eat up chars until eos or blank */
+		while (*ptr && !ISBLANK(*ptr))
+			ptr++;
+
+		if (!*ptr)
+			break;
+		*ptr++ = '\0';
+
+		/* skip over blanks */
+		while (ISBLANK(*ptr))
+			ptr++;
+	}
+	return new_argc;
+}
+
+/*
+ *  stress_parse_job_line()
+ *	turn a job line into a stress-ng option and parse it
+ */
+static int stress_parse_job_line(
+	const char *jobfile,
+	char *argv0,
+	const char *line,
+	uint32_t *flag)
+{
+	char buf[4096];
+	char *new_argv[MAX_ARGS];
+	int new_argc;
+
+	(void)memset(new_argv, 0, sizeof(new_argv));
+	new_argv[0] = argv0;
+	(void)shim_strlcpy(buf, line, sizeof(buf));
+	new_argc = stress_job_tokenize(buf, new_argv);
+
+	/* managed to get any tokens? */
+	if (new_argc > 1) {
+		const size_t len = strlen(new_argv[1]) + 3;
+		char tmp[len];
+		int rc;
+
+		/* Must check for --job -h option! */
+		if (!strcmp(new_argv[1], "job") ||
+		    !strcmp(new_argv[1], "j")) {
+			(void)fprintf(stderr, "Cannot read job file in from a job script!\n");
+			return -1;
+		}
+
+		/* Check for job run option */
+		rc = stress_parse_run(jobfile, new_argc, new_argv, flag);
+		if (rc < 0) {
+			stress_parse_error(job_lineno, job_txt);
+			return -1;
+		} else if (rc == 1) {
+			return 0;
+		}
+
+		/* prepend -- to command to make them into stress-ng options */
+		(void)snprintf(tmp, len, "--%s", new_argv[1]);
+		new_argv[1] = tmp;
+		if (stress_parse_opts(new_argc, new_argv, true) != EXIT_SUCCESS) {
+			stress_parse_error(job_lineno, job_txt);
+			return -1;
+		}
+		new_argv[1] = NULL;
+	}
+	return 0;
+}
+
+/*
+ *  stress_job_phase_free()
+ *	free the lines buffered for the current phase
+ */
+static void stress_job_phase_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < job_nlines; i++) {
+		free(job_lines[i].line);
+		free(job_lines[i].txt);
+	}
+	free(job_lines);
+	job_lines = NULL;
+	job_nlines = 0;
+	job_sweep = -1;
+}
+
+/*
+ *  stress_job_phase_add()
+ *	buffer a job line until the end of the current phase
+ */
+static int stress_job_phase_add(const char *line, const char *txt)
+{
+	stress_job_line_t *lines;
+
+	lines = realloc(job_lines, (job_nlines + 1) * sizeof(*lines));
+	if (!lines) {
+		(void)fprintf(stderr, "Cannot allocate job file phase lines\n");
+		return -1;
+	}
+	job_lines = lines;
+	job_lines[job_nlines].line = strdup(line);
+	job_lines[job_nlines].txt = strdup(txt);
+	job_lines[job_nlines].lineno = job_lineno;
+	if (!job_lines[job_nlines].line || !job_lines[job_nlines].txt) {
+		free(job_lines[job_nlines].line);
+		free(job_lines[job_nlines].txt);
+		(void)fprintf(stderr, "Cannot allocate job file phase lines\n");
+		return -1;
+	}
+	job_nlines++;
+	return 0;
+}
+
+/*
+ *  stress_job_phase_parse()
+ *	parse all the buffered lines of a phase, the sweep
+ *	line (if any) is replaced by the given option and value
+ */
+static int stress_job_phase_parse(
+	const char *jobfile,
+	char *argv0,
+	uint32_t *flag,
+	const char *sweep_opt,
+	const char *sweep_val)
+{
+	const stress_stressor_t *current = g_stressor_current;
+	char sweep[256];
+	size_t i;
+
+	if (sweep_opt)
+		(void)snprintf(sweep, sizeof(sweep), "%s=%s", sweep_opt, sweep_val);
+	stress_set_job_phase(job_phase, job_phase_name, sweep_opt ? sweep : NULL);
+
+	for (i = 0; i < job_nlines; i++) {
+		job_lineno = job_lines[i].lineno;
+		(void)shim_strlcpy(job_txt, job_lines[i].txt, sizeof(job_txt));
+
+		if ((ssize_t)i == job_sweep) {
+			char line[512];
+
+			(void)snprintf(line, sizeof(line), "%s %s", sweep_opt, sweep_val);
+			if (stress_parse_job_line(jobfile, argv0, line, flag) < 0)
+				return -1;
+		} else {
+			if (stress_parse_job_line(jobfile, argv0, job_lines[i].line, flag) < 0)
+				return -1;
+		}
+	}
+	/* Only phases that added stressors use up a phase number */
+	if (g_stressor_current != current)
+		job_phase++;
+	return 0;
+}
+
+/*
+ *  stress_job_phase_flush()
+ *	parse the stressors of the current phase, a sweep
+ *	turns the phase into one phase per sweep value
+ */
+static int stress_job_phase_flush(
+	const char *jobfile,
+	char *argv0,
+	uint32_t *flag)
+{
+	char buf[4096];
+	char *new_argv[MAX_ARGS];
+	int new_argc, i;
+	int ret = 0;
+
+	if (job_sweep < 0) {
+		ret = stress_job_phase_parse(jobfile, argv0, flag, NULL, NULL);
+		stress_job_phase_free();
+		return ret;
+	}
+
+	(void)memset(new_argv, 0, sizeof(new_argv));
+	(void)shim_strlcpy(buf, job_lines[job_sweep].line, sizeof(buf));
+	new_argc = stress_job_tokenize(buf, new_argv);
+
+	/* new_argv[1] is the sweep keyword, new_argv[2] the option */
+	for (i = 3; i < new_argc; i++) {
+		ret = stress_job_phase_parse(jobfile, argv0, flag,
+			new_argv[2], new_argv[i]);
+		if (ret < 0)
+			break;
+	}
+	stress_job_phase_free();
+	return ret;
+}
+
+/*
+ *  stress_parse_phase()
+ *	parse the special job file "phase", "barrier" and
+ *	"sweep" commands, returns 1 if the line was one of them
+ */
+static int stress_parse_phase(
+	const char *jobfile,
+	char *argv0,
+	const char *line,
+	uint32_t *flag)
+{
+	char buf[4096];
+	char *new_argv[MAX_ARGS];
+	int new_argc;
+
+	if (stress_job_keyword(line, "sweep")) {
+		(void)memset(new_argv, 0, sizeof(new_argv));
+		(void)shim_strlcpy(buf, line, sizeof(buf));
+		new_argc = stress_job_tokenize(buf, new_argv);
+		if (new_argc < 4) {
+			(void)fprintf(stderr, "sweep requires an option and "
+				"one or more values in jobfile %s\n", jobfile);
+			stress_parse_error(job_lineno, job_txt);
+			return -1;
+		}
+		if (job_sweep >= 0) {
+			(void)fprintf(stderr, "Cannot have more than one sweep "
+				"per phase in jobfile %s\n", jobfile);
+			stress_parse_error(job_lineno, job_txt);
+			return -1;
+		}
+		job_sweep = (ssize_t)job_nlines;
+		return (stress_job_phase_add(line, job_txt) < 0) ? -1 : 1;
+	}
+
+	if (stress_job_keyword(line, "barrier")) {
+		if (stress_job_phase_flush(jobfile, argv0, flag) < 0)
+			return -1;
+		free(job_phase_name);
+		job_phase_name = NULL;
+		return 1;
+	}
+
+	if (stress_job_keyword(line, "phase")) {
+		if (stress_job_phase_flush(jobfile, argv0, flag) < 0)
+			return -1;
+		free(job_phase_name);
+		job_phase_name = NULL;
+
+		(void)memset(new_argv, 0, sizeof(new_argv));
+		(void)shim_strlcpy(buf, line, sizeof(buf));
+		new_argc = stress_job_tokenize(buf, new_argv);
+		if (new_argc > 2) {
+			job_phase_name = strdup(new_argv[2]);
+			if (!job_phase_name) {
+				(void)fprintf(stderr, "Cannot allocate job file phase name\n");
+				return -1;
+			}
+		}
+		return 1;
+	}
+	return 0;
+}
+
 /*
  *  stress_parse_jobfile()
  *	parse a jobfile, turn job commands into
@@ -104,12 +404,8 @@ int stress_parse_jobfile(
 {
 	NOCLOBBER FILE *fp;
 	char buf[4096];
-	char *new_argv[MAX_ARGS];
-	char txt[sizeof(buf)];
 	int ret;
 	uint32_t flag;
-	static uint32_t lineno;
-
 
 	if (!jobfile) {
 		if (optind >= argc)
@@ -127,7 +423,7 @@ int stress_parse_jobfile(
 	}
 
 	if (setjmp(g_error_env) == 1) {
-		stress_parse_error(lineno, txt);
+		stress_parse_error(job_lineno, job_txt);
 		ret = -1;
 		goto err;
 	}
@@ -137,79 +433,43 @@ int stress_parse_jobfile(
 
 	while (fgets(buf, sizeof(buf), fp)) {
 		char *ptr = buf;
-		int new_argc = 1;
+		int rc;
 
-		(void)memset(new_argv, 0, sizeof(new_argv));
-		new_argv[0] = argv[0];
-		lineno++;
+		job_lineno++;
 
 		/* remove \n */
 		stress_chop(buf, '\n');
-		(void)shim_strlcpy(txt, buf, sizeof(txt) - 1);
+		(void)shim_strlcpy(job_txt, buf, sizeof(job_txt) - 1);
 
 		/* remove comments */
 		stress_chop(buf, '#');
 
-		if (!*ptr)
-			continue;
-
 		/* skip leading blanks */
 		while (ISBLANK(*ptr))
 			ptr++;
+		if (!*ptr)
+			continue;
 
-		while (new_argc < MAX_ARGS && *ptr) {
-			new_argv[new_argc++] = ptr;
-
-			/* eat up chars until eos or blank */
-			while (*ptr && !ISBLANK(*ptr))
-				ptr++;
-
-			if (!*ptr)
-				break;
-			*ptr++ = '\0';
-
-			/* skip over blanks */
-			while (ISBLANK(*ptr))
-				ptr++;
-		}
-
-		/* managed to get any tokens? */
-		if (new_argc > 1) {
-			const size_t len = strlen(new_argv[1]) + 3;
-			char tmp[len];
-			int rc;
-
-			/* Must check for --job -h option! */
-			if (!strcmp(new_argv[1], "job") ||
-			    !strcmp(new_argv[1], "j")) {
-				(void)fprintf(stderr, "Cannot read job file in from a job script!\n");
-				goto err;
-			}
-
-			/* Check for job run option */
-			rc = stress_parse_run(jobfile, new_argc, new_argv, &flag);
-			if (rc < 0) {
-				ret = -1;
-				stress_parse_error(lineno, txt);
-				goto err;
-			} else if (rc == 1) {
-				continue;
-			}
+		/* Check for job phase, barrier and sweep commands */
+		rc = stress_parse_phase(jobfile, argv[0], ptr, &flag);
+		if (rc < 0)
+			goto err;
+		else if (rc == 1)
+			continue;
 
-			/* prepend -- to command to make them into stress-ng options */
-			(void)snprintf(tmp, len, "--%s", new_argv[1]);
-			new_argv[1] = tmp;
-			if (stress_parse_opts(new_argc, new_argv, true) != EXIT_SUCCESS) {
-				stress_parse_error(lineno, txt);
-				ret = -1;
-				goto err;
-			}
-			new_argv[1] = NULL;
-		}
+		/* stressors are parsed at the end of each phase */
+		if (stress_job_phase_add(ptr, job_txt) < 0)
+			goto err;
 	}
+	if (stress_job_phase_flush(jobfile, argv[0], &flag) < 0)
+		goto err;
 	ret = 0;
 err:
 	(void)fclose(fp);
+	stress_job_phase_free();
+	free(job_phase_name);
+	job_phase_name = NULL;
+	stress_set_job_phase(0, NULL, NULL);
 
 	return ret;
 }
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+typedef struct {
+	const double percentile;	/* percentile to report */
+	const char *name;		/* text and YAML name */
+} stress_latency_percentile_t;
+
+static const stress_latency_percentile_t percentiles[] = {
+	{ 50.0,	"p50" },
+	{ 90.0,	"p90" },
+	{ 99.0,	"p99" },
+	{ 99.9,	"p99.9" },
+};
+
+/*
+ *  stress_latency_bucket_value()
+ *	return the mid-point latency of a histogram bucket
+ */
+static uint64_t stress_latency_bucket_value(const uint32_t idx)
+{
+	uint32_t octave, shift;
+	uint64_t low;
+
+	if (idx < STRESS_LATENCY_SUB)
+		return (uint64_t)idx;
+
+	octave = idx >> STRESS_LATENCY_SUB_BITS;
+	shift = octave - 1;
+	low = (uint64_t)(STRESS_LATENCY_SUB + (idx & (STRESS_LATENCY_SUB - 1))) << shift;
+
+	return low + ((1ULL << shift) >> 1);
+}
+
+/*
+ *  stress_latency_merge()
+ *	merge the latency histograms of all the instances of
+ *	a stressor, returns true if any latencies were recorded
+ */
+bool stress_latency_merge(const stress_stressor_t *ss, stress_latency_t *latency)
+{
+	int32_t j;
+
+	(void)memset(latency, 0, sizeof(*latency));
+
+	for (j = 0; j < ss->started_instances; j++) {
+		const stress_latency_t *l = &ss->stats[j]->latency;
+		size_t i;
+
+		if (!l->count)
+			continue;
+		if ((latency->count == 0) || (l->min < latency->min))
+			latency->min = l->min;
+		if (l->max > latency->max)
+			latency->max = l->max;
+		latency->count += l->count;
+		for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+			latency->bucket[i] += l->bucket[i];
+	}
+	return latency->count > 0;
+}
+
+/*
+ *  stress_latency_percentile()
+ *	return the latency in nanoseconds of a given percentile
+ */
+uint64_t stress_latency_percentile(const stress_latency_t *latency, const double percentile)
+{
+	uint64_t target, sum = 0, value;
+	uint32_t i;
+
+	if (!latency->count)
+		return 0;
+
+	target = (uint64_t)ceil(((double)latency->count * percentile) / 100.0);
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		sum += latency->bucket[i];
+		if (sum >= target)
+			break;
+	}
+	value = stress_latency_bucket_value(i < STRESS_LATENCY_BUCKETS ? i : STRESS_LATENCY_BUCKETS - 1);
+
+	/* Bucket mid-points may lie outside the recorded range */
+	if (value < latency->min)
+		value = latency->min;
+	if (value > latency->max)
+		value = latency->max;
+	return value;
+}
+
+/*
+ *  stress_latency_dump()
+ *	dump latency percentiles of a stressor
+ */
+void stress_latency_dump(const char *munged, const stress_latency_t *latency)
+{
+	char buf[256], *ptr = buf;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		(void)snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), "%s %" PRIu64 ", ",
+			percentiles[i].name,
+			stress_latency_percentile(latency, percentiles[i].percentile));
+		ptr += strlen(ptr);
+	}
+	pr_inf("%-13s latency (ns): %smax %" PRIu64 " (%" PRIu64 " samples)\n",
+		munged, buf, latency->max, latency->count);
+}
+
+/*
+ *  stress_latency_dump_yaml()
+ *	dump latency percentiles of a stressor to the YAML file
+ */
+void stress_latency_dump_yaml(FILE *yaml, const stress_latency_t *latency)
+{
+	size_t i;
+
+	pr_yaml(yaml, "      latency-ns:\n");
+	pr_yaml(yaml, "        samples: %" PRIu64 "\n", latency->count);
+	pr_yaml(yaml, "        min: %" PRIu64 "\n", latency->min);
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		pr_yaml(yaml, "        %s: %" PRIu64 "\n", percentiles[i].name,
+			stress_latency_percentile(latency, percentiles[i].percentile));
+	}
+	pr_yaml(yaml, "        max: %" PRIu64 "\n", latency->max);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_LATENCY_H
+#define CORE_LATENCY_H
+
+#include "core-rate.h"
+#include "core-time.h"
+
+/*
+ *  stress_latency_index()
+ *	map a latency in nanoseconds to a histogram bucket
+ */
+static inline uint32_t ALWAYS_INLINE stress_latency_index(const uint64_t ns)
+{
+	uint32_t msb, idx;
+
+	if (ns < STRESS_LATENCY_SUB)
+		return (uint32_t)ns;
+#if defined(HAVE_BUILTIN_CLZLL)
+	msb = 63 - (uint32_t)__builtin_clzll(ns);
+#else
+	{
+		register uint64_t v = ns;
+
+		for (msb = 0; v >>= 1; msb++)
+			;
+	}
+#endif
+	idx = ((msb - STRESS_LATENCY_SUB_BITS + 1) << STRESS_LATENCY_SUB_BITS) +
+	      (uint32_t)((ns >> (msb - STRESS_LATENCY_SUB_BITS)) & (STRESS_LATENCY_SUB - 1));
+
+	return (idx < STRESS_LATENCY_BUCKETS) ? idx : STRESS_LATENCY_BUCKETS - 1;
+}
+
+/*
+ *  stress_latency_record_ns()
+ *	record a per op latency in nanoseconds, this is not
+ *	atomic so only one process or thread of a stressor
+ *	instance should record latencies
+ */
+static inline void ALWAYS_INLINE stress_latency_record_ns(
+	const stress_args_t *args,
+	const uint64_t ns)
+{
+	stress_latency_t *latency = args->latency;
+
+	if (UNLIKELY(!latency))
+		return;
+	latency->bucket[stress_latency_index(ns)]++;
+	if (UNLIKELY(latency->count == 0) || (ns < latency->min))
+		latency->min = ns;
+	if (ns > latency->max)
+		latency->max = ns;
+	latency->count++;
+}
+
+/*
+ *  stress_latency_now()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_now(void)
+{
+	return stress_time_now_ns();
+}
+
+/*
+ *  stress_latency_start()
+ *	start timing an op, only reads the clock
+ *	if latencies are being recorded. With --rate
+ *	the op is timed from when it was scheduled to
+ *	start so queueing behind slow ops is included
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_start(const stress_args_t *args)
+{
+	if (!args->latency)
+		return 0;
+	if (args->rate) {
+		const uint64_t scheduled = stress_rate_scheduled_ns();
+
+		if (scheduled)
+			return scheduled;
+	}
+	return stress_latency_now();
+}
+
+/*
+ *  stress_latency_end()
+ *	record the latency of an op timed with
+ *	stress_latency_start()
+ */
+static inline void ALWAYS_INLINE stress_latency_end(
+	const stress_args_t *args,
+	const uint64_t t_start)
+{
+	uint64_t t_end;
+
+	if (!args->latency)
+		return;
+	t_end = stress_latency_now();
+	stress_latency_record_ns(args, (t_end > t_start) ? t_end - t_start : 0);
+}
+
+extern bool stress_latency_merge(const stress_stressor_t *ss,
+	stress_latency_t *latency);
+extern uint64_t stress_latency_percentile(const stress_latency_t *latency,
+	const double percentile);
+extern void stress_latency_dump(const char *munged,
+	const stress_latency_t *latency);
+extern void stress_latency_dump_yaml(FILE *yaml,
+	const stress_latency_t *latency);
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-load-profile.h"
+
+#define MAX_LOAD_STEPS		(64)
+#define MAX_LOAD_TRACE		(7 * 24 * 3600)	/* one week of seconds */
+
+typedef enum {
+	LOAD_PROFILE_NONE = 0,		/* no profile, fixed load */
+	LOAD_PROFILE_RAMP,		/* linear ramp from -> to */
+	LOAD_PROFILE_STEP,		/* repeating step schedule */
+	LOAD_PROFILE_SINE,		/* sine wave between min and max */
+	LOAD_PROFILE_TRACE,		/* per second utilization trace */
+} stress_load_profile_type_t;
+
+typedef struct {
+	stress_load_profile_type_t type;
+	double from;			/* ramp start, sine minimum % */
+	double to;			/* ramp end, sine maximum % */
+	double period;			/* ramp, step and sine period in secs */
+	double steps[MAX_LOAD_STEPS];	/* step schedule % */
+	size_t steps_n;			/* number of steps */
+	double *trace;			/* trace % per second */
+	size_t trace_n;			/* number of trace seconds */
+} stress_load_profile_t;
+
+static stress_load_profile_t load_profile;
+static FILE *load_profile_fp;		/* trace file being loaded */
+static const char *load_profile_filename; /* name of trace file being loaded */
+static size_t load_profile_lineno;	/* current line of trace file */
+
+/*
+ *  stress_load_profile_error()
+ *	report a load profile error and abort option parsing,
+ *	the partially loaded profile is discarded, trace file
+ *	errors report the file name and line
+ */
+static void NORETURN stress_load_profile_error(const char *opt, const char *msg)
+{
+	stress_load_profile_free();
+	(void)memset(&load_profile, 0, sizeof(load_profile));
+
+	if (load_profile_fp) {
+		(void)fclose(load_profile_fp);
+		load_profile_fp = NULL;
+		(void)fprintf(stderr, "load-profile: trace file '%s' line %zu: %s\n",
+			load_profile_filename, load_profile_lineno, msg);
+	} else {
+		(void)fprintf(stderr, "load-profile '%s': %s, expecting ramp:FROM:TO[:SECS], "
+			"step:SECS:P1,P2,..., sine:MIN:MAX:PERIOD or trace:FILE\n", opt, msg);
+	}
+	longjmp(g_error_env, 1);
+}
+
+/*
+ *  stress_load_profile_percent()
+ *	parse a load percentage in the range 0..100
+ */
+static double stress_load_profile_percent(const char *opt, const char *str)
+{
+	char *end;
+	double val;
+
+	if (!str)
+		stress_load_profile_error(opt, "missing load percentage");
+	errno = 0;
+	val = strtod(str, &end);
+	if (errno || (end == str) || (*end && !isspace((int)*end)) ||
+	    (val < 0.0) || (val > 100.0))
+		stress_load_profile_error(opt, "load must be a percentage 0..100");
+	return val;
+}
+
+/*
+ *  stress_load_profile_secs()
+ *	parse a time period, must be at least one second
+ */
+static double stress_load_profile_secs(const char *opt, const char *str)
+{
+	double secs;
+
+	if (!str)
+		stress_load_profile_error(opt, "missing time period");
+	secs = (double)stress_get_uint64_time(str);
+	if (secs < 1.0)
+		stress_load_profile_error(opt, "time period must be 1 second or more");
+	return secs;
+}
+
+/*
+ *  stress_load_profile_trace()
+ *	load a trace of utilization per second, one sample
+ *	per line, the last comma separated field is used so
+ *	that time,utilization CSV files can be used as is
+ */
+static void stress_load_profile_trace(const char *opt, const char *filename)
+{
+	FILE *fp;
+	char buf[256];
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		(void)fprintf(stderr, "load-profile: cannot open trace file '%s', "
+			"errno=%d (%s)\n", filename, errno, strerror(errno));
+		longjmp(g_error_env, 1);
+	}
+	/* Closed by stress_load_profile_error() on a parse error */
+	load_profile_fp = fp;
+	load_profile_filename = filename;
+	load_profile_lineno = 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *ptr = strrchr(buf, ',');
+		double *trace;
+
+		load_profile_lineno++;
+		ptr = ptr ? ptr + 1 : buf;
+		while (isspace((int)*ptr))
+			ptr++;
+		/* skip blank lines, comments and a CSV header */
+		if (!*ptr || (*ptr == '#') || isalpha((int)*ptr))
+			continue;
+		if (load_profile.trace_n >= MAX_LOAD_TRACE)
+			break;
+
+		trace = realloc(load_profile.trace,
+			(load_profile.trace_n + 1) * sizeof(*trace));
+		if (!trace)
+			stress_load_profile_error(opt, "out of memory loading trace");
+		load_profile.trace = trace;
+		load_profile.trace[load_profile.trace_n++] =
+			stress_load_profile_percent(opt, ptr);
+	}
+	load_profile_fp = NULL;
+	(void)fclose(fp);
+
+	if (!load_profile.trace_n)
+		stress_load_profile_error(opt, "trace file has no utilization samples");
+}
+
+/*
+ *  stress_set_load_profile()
+ *	parse a load profile specification
+ */
+int stress_set_load_profile(const char *opt)
+{
+	/*
+	 *  Parsed in a copy on the stack, the parse errors longjmp
+	 *  out of here (as do the time parsing helpers) so there is
+	 *  nothing to free on the way out
+	 */
+	char str[PATH_MAX + 64];
+	char *type, *saveptr = NULL;
+
+	stress_load_profile_free();
+	(void)memset(&load_profile, 0, sizeof(load_profile));
+
+	if (shim_strlcpy(str, opt, sizeof(str)) >= sizeof(str))
+		stress_load_profile_error(opt, "profile specification too long");
+	type = strtok_r(str, ":", &saveptr);
+	if (!type)
+		stress_load_profile_error(opt, "missing profile type");
+
+	if (!strcmp(type, "ramp")) {
+		const char *secs;
+
+		load_profile.type = LOAD_PROFILE_RAMP;
+		load_profile.from = stress_load_profile_percent(opt, strtok_r(NULL, ":", &saveptr));
+		load_profile.to = stress_load_profile_percent(opt, strtok_r(NULL, ":", &saveptr));
+		secs = strtok_r(NULL, ":", &saveptr);
+		/* 0 = ramp over the entire run */
+		load_profile.period = secs ? stress_load_profile_secs(opt, secs) : 0.0;
+	} else if (!strcmp(type, "step")) {
+		char *steps, *token, *ptr, *stepptr = NULL;
+
+		load_profile.type = LOAD_PROFILE_STEP;
+		load_profile.period = stress_load_profile_secs(opt, strtok_r(NULL, ":", &saveptr));
+		steps = strtok_r(NULL, ":", &saveptr);
+		if (!steps)
+			stress_load_profile_error(opt, "missing step loads");
+		for (ptr = steps; (token = strtok_r(ptr, ",", &stepptr)) != NULL; ptr = NULL) {
+			if (load_profile.steps_n >= MAX_LOAD_STEPS)
+				stress_load_profile_error(opt, "too many steps");
+			load_profile.steps[load_profile.steps_n++] =
+				stress_load_profile_percent(opt, token);
+		}
+	} else if (!strcmp(type, "sine")) {
+		load_profile.type = LOAD_PROFILE_SINE;
+		load_profile.from = stress_load_profile_percent(opt, strtok_r(NULL, ":", &saveptr));
+		load_profile.to = stress_load_profile_percent(opt, strtok_r(NULL, ":", &saveptr));
+		load_profile.period = stress_load_profile_secs(opt, strtok_r(NULL, ":", &saveptr));
+	} else if (!strcmp(type, "trace")) {
+		/* filename is the remainder, it may contain a : */
+		const char *filename = opt + strlen(type) + 1;
+
+		load_profile.type = LOAD_PROFILE_TRACE;
+		if (!*filename)
+			stress_load_profile_error(opt, "missing trace file name");
+		stress_load_profile_trace(opt, filename);
+	} else {
+		stress_load_profile_error(opt, "unknown profile type");
+	}
+	return 0;
+}
+
+/*
+ *  stress_load_profile_enabled()
+ *	return true if --load-profile is enabled
+ */
+bool stress_load_profile_enabled(void)
+{
+	return load_profile.type != LOAD_PROFILE_NONE;
+}
+
+/*
+ *  stress_load_profile()
+ *	return the target load % of the profile at the current
+ *	time, t_start is the start time of the stressor. This is
+ *	cheap enough to be called once per stressor iteration
+ */
+double stress_load_profile(const double t_start)
+{
+	const double t = stress_time_now() - t_start;
+	double period;
+	size_t i;
+
+	switch (load_profile.type) {
+	case LOAD_PROFILE_RAMP:
+		period = load_profile.period;
+		if ((period <= 0.0) && (g_opt_timeout != TIMEOUT_NOT_SET))
+			period = (double)g_opt_timeout;
+		if ((period <= 0.0) || (t >= period))
+			return load_profile.to;
+		return load_profile.from +
+			((load_profile.to - load_profile.from) * t / period);
+	case LOAD_PROFILE_STEP:
+		i = (size_t)(t / load_profile.period) % load_profile.steps_n;
+		return load_profile.steps[i];
+	case LOAD_PROFILE_SINE:
+		return load_profile.from + ((load_profile.to - load_profile.from) *
+			(1.0 - cos(2.0 * M_PI * t / load_profile.period)) * 0.5);
+	case LOAD_PROFILE_TRACE:
+		i = (size_t)t % load_profile.trace_n;
+		return load_profile.trace[i];
+	default:
+		break;
+	}
+	return 100.0;
+}
+
+/*
+ *  stress_load_profile_free()
+ *	free the load profile trace
+ */
+void stress_load_profile_free(void)
+{
+	free(load_profile.trace);
+	load_profile.trace = NULL;
+	load_profile.trace_n = 0;
+}
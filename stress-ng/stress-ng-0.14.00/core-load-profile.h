@@ -0,0 +1,28 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_LOAD_PROFILE_H
+#define CORE_LOAD_PROFILE_H
+
+/* Time varying load profiles for duty cycled stressors */
+extern int stress_set_load_profile(const char *opt);
+extern bool stress_load_profile_enabled(void);
+extern double stress_load_profile(const double t_start);
+extern void stress_load_profile_free(void);
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-mempolicy.h"
+
+#if !defined(MPOL_PREFERRED)
+#define MPOL_PREFERRED		(1)
+#endif
+#if !defined(MPOL_BIND)
+#define MPOL_BIND		(2)
+#endif
+#if !defined(MPOL_INTERLEAVE)
+#define MPOL_INTERLEAVE		(3)
+#endif
+
+#define MEMPOLICY_NODES_MAX	(1024)
+#define MEMPOLICY_LONG_BITS	(sizeof(unsigned long) * 8)
+#define MEMPOLICY_SAMPLE_SECS	(1.0)
+
+#define SYS_NODE_PREFIX		"/sys/devices/system/node"
+
+/* Global --mbind, --interleave, --preferred or --localalloc policy */
+static int mempolicy_mode = -1;
+static const char *mempolicy_name = NULL;
+static unsigned long mempolicy_mask[MEMPOLICY_NODES_MAX / MEMPOLICY_LONG_BITS];
+static bool mempolicy_mask_set = false;
+
+/*
+ *  stress_mempolicy_set_mode()
+ *	set the memory policy, only one policy option is allowed
+ */
+static void stress_mempolicy_set_mode(const int mode, const char *name)
+{
+	if ((mempolicy_mode != -1) && (mempolicy_mode != mode)) {
+		(void)fprintf(stderr, "%s: cannot be used with --%s, only one "
+			"memory policy option is allowed\n", name, mempolicy_name);
+		_exit(EXIT_FAILURE);
+	}
+	mempolicy_mode = mode;
+	mempolicy_name = name;
+}
+
+/*
+ *  stress_mempolicy_node_check()
+ *	check NUMA node exists, exit on an invalid node
+ */
+static void stress_mempolicy_node_check(const char *name, const int node)
+{
+	char path[PATH_MAX];
+	struct stat statbuf;
+
+	if ((node < 0) || (node >= MEMPOLICY_NODES_MAX)) {
+		(void)fprintf(stderr, "%s: invalid NUMA node %d, allowed "
+			"range: 0 to %d\n", name, node, MEMPOLICY_NODES_MAX - 1);
+		_exit(EXIT_FAILURE);
+	}
+	(void)snprintf(path, sizeof(path), "%s/node%d", SYS_NODE_PREFIX, node);
+	if (stat(path, &statbuf) < 0) {
+		(void)fprintf(stderr, "%s: NUMA node %d does not exist\n",
+			name, node);
+		_exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ *  stress_mempolicy_parse_nodes()
+ *	parse a node list, e.g. 0,2-3 or all, into the node mask
+ */
+static void stress_mempolicy_parse_nodes(const char *name, const char *opt)
+{
+	char buf[4096];
+	char *str, *ptr, *token;
+
+	if (!strcmp(opt, "all")) {
+		if (system_read(SYS_NODE_PREFIX "/online", buf, sizeof(buf)) < 0) {
+			(void)fprintf(stderr, "%s: cannot read online NUMA nodes "
+				"from %s/online\n", name, SYS_NODE_PREFIX);
+			_exit(EXIT_FAILURE);
+		}
+		opt = buf;
+	}
+
+	str = stress_const_optdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "out of memory duplicating argument '%s'\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+
+	(void)memset(mempolicy_mask, 0, sizeof(mempolicy_mask));
+	for (ptr = str; (token = strtok(ptr, ",\n")) != NULL; ptr = NULL) {
+		int node, lo, hi;
+
+		if (sscanf(token, "%d-%d", &lo, &hi) == 2) {
+			if (hi < lo) {
+				(void)fprintf(stderr, "%s: invalid range in '%s' "
+					"(end value must be larger than "
+					"start value)\n", name, token);
+				free(str);
+				_exit(EXIT_FAILURE);
+			}
+		} else if (sscanf(token, "%d", &lo) == 1) {
+			hi = lo;
+		} else {
+			(void)fprintf(stderr, "%s: invalid NUMA node '%s'\n",
+				name, token);
+			free(str);
+			_exit(EXIT_FAILURE);
+		}
+		for (node = lo; node <= hi; node++) {
+			stress_mempolicy_node_check(name, node);
+			mempolicy_mask[node / MEMPOLICY_LONG_BITS] |=
+				1UL << (node % MEMPOLICY_LONG_BITS);
+		}
+	}
+	free(str);
+	mempolicy_mask_set = true;
+}
+
+/*
+ *  stress_set_mbind()
+ *	bind all stressor memory allocations to a node list
+ */
+int stress_set_mbind(const char *opt)
+{
+	stress_mempolicy_set_mode(MPOL_BIND, "mbind");
+	stress_mempolicy_parse_nodes("mbind", opt);
+	return 0;
+}
+
+/*
+ *  stress_set_interleave()
+ *	interleave all stressor memory allocations over a node list
+ */
+int stress_set_interleave(const char *opt)
+{
+	stress_mempolicy_set_mode(MPOL_INTERLEAVE, "interleave");
+	stress_mempolicy_parse_nodes("interleave", opt);
+	return 0;
+}
+
+/*
+ *  stress_set_preferred()
+ *	prefer allocating stressor memory on one node
+ */
+int stress_set_preferred(const char *opt)
+{
+	int node;
+
+	stress_mempolicy_set_mode(MPOL_PREFERRED, "preferred");
+	if (sscanf(opt, "%d", &node) != 1) {
+		(void)fprintf(stderr, "preferred: invalid NUMA node '%s'\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+	stress_mempolicy_node_check("preferred", node);
+	(void)memset(mempolicy_mask, 0, sizeof(mempolicy_mask));
+	mempolicy_mask[node / MEMPOLICY_LONG_BITS] = 1UL << (node % MEMPOLICY_LONG_BITS);
+	mempolicy_mask_set = true;
+	return 0;
+}
+
+/*
+ *  stress_set_localalloc()
+ *	allocate stressor memory on the node of the CPU it
+ *	runs on, a preferred policy with an empty node mask
+ */
+int stress_set_localalloc(void)
+{
+	stress_mempolicy_set_mode(MPOL_PREFERRED, "localalloc");
+	(void)memset(mempolicy_mask, 0, sizeof(mempolicy_mask));
+	mempolicy_mask_set = false;
+	return 0;
+}
+
+/*
+ *  stress_mempolicy_enabled()
+ *	return true if a memory policy has been set
+ */
+bool stress_mempolicy_enabled(void)
+{
+	return mempolicy_mode != -1;
+}
+
+/*
+ *  stress_mempolicy_apply()
+ *	set the memory policy of a newly forked stressor process,
+ *	the policy is inherited by its threads and child processes
+ */
+int stress_mempolicy_apply(const char *name)
+{
+	if (mempolicy_mode == -1)
+		return EXIT_SUCCESS;
+
+	if (shim_set_mempolicy(mempolicy_mode,
+			mempolicy_mask_set ? mempolicy_mask : NULL,
+			mempolicy_mask_set ? MEMPOLICY_NODES_MAX : 0) < 0) {
+		pr_inf("%s: cannot set --%s memory policy, errno=%d (%s), "
+			"skipping stressor\n", name, mempolicy_name,
+			errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_mempolicy_numa_maps()
+ *	read the per node resident memory of this process from
+ *	/proc/self/numa_maps, returns -1 if not available
+ */
+static int stress_mempolicy_numa_maps(stress_numa_pages_t *numa_pages)
+{
+	FILE *fp;
+	char buffer[4096];
+
+	(void)memset(numa_pages, 0, sizeof(*numa_pages));
+	fp = fopen("/proc/self/numa_maps", "r");
+	if (!fp)
+		return -1;
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr, *token, *saveptr = NULL;
+		uint64_t page_kb = 4;
+
+		ptr = strstr(buffer, "kernelpagesize_kB=");
+		if (ptr)
+			(void)sscanf(ptr + 18, "%" SCNu64, &page_kb);
+
+		for (ptr = buffer; (token = strtok_r(ptr, " \n", &saveptr)) != NULL; ptr = NULL) {
+			int node;
+			uint64_t pages;
+
+			if ((token[0] != 'N') || !isdigit((int)token[1]))
+				continue;
+			if (sscanf(token + 1, "%d=%" SCNu64, &node, &pages) != 2)
+				continue;
+			if (node >= STRESS_NUMA_NODES_MAX)
+				node = STRESS_NUMA_NODES_MAX - 1;
+			numa_pages->kb[node] += pages * page_kb;
+			numa_pages->total += pages * page_kb;
+		}
+	}
+	(void)fclose(fp);
+
+	return 0;
+}
+
+/*
+ *  stress_mempolicy_numa_pages()
+ *	called by memory stressors before freeing their buffers,
+ *	keep the largest per node memory snapshot, snapshots are
+ *	taken at most once per second
+ */
+void stress_mempolicy_numa_pages(const stress_args_t *args)
+{
+	static double last = 0.0;
+	stress_numa_pages_t numa_pages;
+	const double now = stress_time_now();
+
+	if (!args->numa_pages)
+		return;
+	if ((last > 0.0) && (now - last < MEMPOLICY_SAMPLE_SECS))
+		return;
+	last = now;
+
+	if (stress_mempolicy_numa_maps(&numa_pages) < 0)
+		return;
+	if (numa_pages.total > args->numa_pages->total)
+		*args->numa_pages = numa_pages;
+}
+
+/*
+ *  stress_mempolicy_numa_pages_stats()
+ *	snapshot per node memory when a stressor has returned
+ *	for stressors that do not take their own snapshots
+ */
+void stress_mempolicy_numa_pages_stats(stress_stats_t *stats)
+{
+	stress_numa_pages_t numa_pages;
+
+	if (mempolicy_mode == -1)
+		return;
+	if (stress_mempolicy_numa_maps(&numa_pages) < 0)
+		return;
+	if (numa_pages.total > stats->numa_pages.total)
+		stats->numa_pages = numa_pages;
+}
+
+/*
+ *  stress_mempolicy_dump()
+ *	dump the per node memory distribution of each stressor
+ */
+void stress_mempolicy_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (mempolicy_mode == -1)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_numa_pages_t sum;
+		char buf[256];
+		int32_t j;
+		int len = 0, node;
+
+		if (!ss->stats)
+			continue;
+		(void)memset(&sum, 0, sizeof(sum));
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_numa_pages_t *numa_pages = &ss->stats[j]->numa_pages;
+
+			for (node = 0; node < STRESS_NUMA_NODES_MAX; node++)
+				sum.kb[node] += numa_pages->kb[node];
+			sum.total += numa_pages->total;
+		}
+		if (sum.total == 0)
+			continue;
+
+		if (!header) {
+			pr_inf("%s memory policy, per node memory of the stressors:\n",
+				mempolicy_name);
+			pr_yaml(yaml, "numa-pages:\n");
+			header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      policy: %s\n", mempolicy_name);
+		pr_yaml(yaml, "      total-kb: %" PRIu64 "\n", sum.total);
+
+		*buf = '\0';
+		for (node = 0; node < STRESS_NUMA_NODES_MAX; node++) {
+			const double pc = 100.0 * (double)sum.kb[node] / (double)sum.total;
+
+			if (!sum.kb[node])
+				continue;
+			if (len < (int)sizeof(buf) - 48)
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+					" node%d %.2f MB (%.1f%%)", node,
+					(double)sum.kb[node] / 1024.0, pc);
+			pr_yaml(yaml, "      node%d-kb: %" PRIu64 "\n", node, sum.kb[node]);
+			pr_yaml(yaml, "      node%d-percent: %f\n", node, pc);
+		}
+		pr_inf("%-13s%s\n", munged, buf);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+}
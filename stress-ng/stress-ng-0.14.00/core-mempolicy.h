@@ -0,0 +1,33 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_MEMPOLICY_H
+#define CORE_MEMPOLICY_H
+
+/* Global NUMA memory policy applied to all the stressors */
+extern int stress_set_mbind(const char *opt);
+extern int stress_set_interleave(const char *opt);
+extern int stress_set_preferred(const char *opt);
+extern int stress_set_localalloc(void);
+extern bool stress_mempolicy_enabled(void);
+extern int stress_mempolicy_apply(const char *name);
+extern void stress_mempolicy_numa_pages(const stress_args_t *args);
+extern void stress_mempolicy_numa_pages_stats(stress_stats_t *stats);
+extern void stress_mempolicy_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
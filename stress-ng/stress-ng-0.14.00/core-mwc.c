@@ -37,12 +37,16 @@ typedef struct {
 	uint32_t z;
 } stress_mwc_t;
 
-static stress_mwc_t mwc = {
+/*
+ *  Generator state is per thread so that stressor instances
+ *  run as threads do not share (and bounce) the same state
+ */
+static THREAD_LOCAL stress_mwc_t mwc = {
 	STRESS_MWC_SEED_W,
 	STRESS_MWC_SEED_Z
 };
 
-static uint8_t mwc_n1, mwc_n8, mwc_n16;
+static THREAD_LOCAL uint8_t mwc_n1, mwc_n8, mwc_n16;
 
 static inline void mwc_flush(void)
 {
@@ -197,7 +201,7 @@ HOT OPTIMIZE3 uint64_t stress_mwc64(void)
  */
 HOT OPTIMIZE3 uint16_t stress_mwc16(void)
 {
-	static uint32_t mwc_saved;
+	static THREAD_LOCAL uint32_t mwc_saved;
 
 	if (LIKELY(mwc_n16)) {
 		mwc_n16--;
@@ -215,7 +219,7 @@ HOT OPTIMIZE3 uint16_t stress_mwc16(void)
  */
 HOT OPTIMIZE3 uint8_t stress_mwc8(void)
 {
-	static uint32_t mwc_saved;
+	static THREAD_LOCAL uint32_t mwc_saved;
 
 	if (LIKELY(mwc_n8)) {
 		mwc_n8--;
@@ -233,7 +237,7 @@ HOT OPTIMIZE3 uint8_t stress_mwc8(void)
  */
 HOT OPTIMIZE3 uint8_t stress_mwc1(void)
 {
-	static uint32_t mwc_saved;
+	static THREAD_LOCAL uint32_t mwc_saved;
 
 	if (LIKELY(mwc_n1)) {
 		mwc_n1--;
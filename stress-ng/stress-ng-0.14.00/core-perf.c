@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-baseline.h"
 #include "core-perf.h"
 #include "core-perf-event.h"
 
@@ -29,6 +30,10 @@
 #include <locale.h>
 #endif
 
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 /* perf enabled systems */
@@ -503,6 +508,29 @@ int stress_perf_disable(stress_perf_t *sp)
 	return 0;
 }
 
+/*
+ *  stress_perf_reset()
+ *	zero the perf counters, only uses ioctl() so it
+ *	is safe to call from a signal handler
+ */
+int stress_perf_reset(stress_perf_t *sp)
+{
+	size_t i;
+
+	if (!sp)
+		return -1;
+	if (!sp->perf_opened)
+		return 0;
+
+	for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++) {
+		const int fd = sp->perf_stat[i].fd;
+
+		if (fd > -1)
+			(void)ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	}
+	return 0;
+}
+
 /*
  *  stress_perf_close()
  *	read counters and close
@@ -561,6 +589,15 @@ bool stress_perf_stat_succeeded(const stress_perf_t *sp)
 	return sp->perf_opened > 0;
 }
 
+/*
+ *  stress_perf_stat_label()
+ *	return label of the p'th perf counter, NULL if out of range
+ */
+const char *stress_perf_stat_label(const size_t p)
+{
+	return (p < STRESS_PERF_MAX) ? perf_info[p].label : NULL;
+}
+
 /*
  *  stress_perf_stat_scale()
  *	scale a counter by duration seconds
@@ -591,6 +628,232 @@ static const char *stress_perf_stat_scale(const uint64_t counter, const double d
 	return buffer;
 }
 
+/*
+ *  stress_perf_stat_totals()
+ *	sum the perf counters of all the instances of a stressor,
+ *	returns true if any counter is non-zero
+ */
+static bool stress_perf_stat_totals(
+	const stress_stressor_t *ss,
+	uint64_t counter_totals[STRESS_PERF_MAX])
+{
+	bool got_data = false;
+	int p;
+
+	(void)memset(counter_totals, 0, sizeof(uint64_t) * STRESS_PERF_MAX);
+
+	for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_perf_t *sp = &ss->stats[j]->sp;
+			uint64_t counter;
+
+			if (!stress_perf_stat_succeeded(sp))
+				continue;
+			counter = sp->perf_stat[p].counter;
+			if (counter == STRESS_PERF_INVALID) {
+				counter_totals[p] = STRESS_PERF_INVALID;
+				break;
+			}
+			counter_totals[p] += counter;
+			got_data |= (counter > 0);
+		}
+	}
+	return got_data;
+}
+
+/*
+ *  stress_perf_stat_total()
+ *	return the total of a perf counter type and config,
+ *	STRESS_PERF_INVALID if it is not available
+ */
+static uint64_t stress_perf_stat_total(
+	const uint64_t counter_totals[STRESS_PERF_MAX],
+	const unsigned int type,
+	const unsigned long config)
+{
+	int p;
+
+	for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++) {
+		if ((perf_info[p].type == type) && (perf_info[p].config == config))
+			return counter_totals[p];
+	}
+	return STRESS_PERF_INVALID;
+}
+
+/* Derived per bogo-op metrics, negative values are not available */
+typedef struct {
+	double ipc;			/* instructions per cycle */
+	double cycles_per_op;		/* CPU cycles per bogo-op */
+	double instr_per_op;		/* instructions per bogo-op */
+	double llc_misses_per_op;	/* last level cache misses per bogo-op */
+	double branch_miss_ratio;	/* branch misses per branch, % */
+	double frontend_stall;		/* front end stalled cycles, % */
+	double backend_stall;		/* back end stalled cycles, % */
+} stress_perf_derived_t;
+
+/*
+ *  stress_perf_ratio()
+ *	n / d * scale, -1.0 if either counter is not available
+ */
+static double stress_perf_ratio(const uint64_t n, const uint64_t d, const double scale)
+{
+	if ((n == STRESS_PERF_INVALID) || (d == STRESS_PERF_INVALID) || (d == 0))
+		return -1.0;
+	return scale * (double)n / (double)d;
+}
+
+/*
+ *  stress_perf_stat_derived()
+ *	compute the derived metrics of a stressor, the bogo-ops
+ *	exclude the --warmup period as the counters are reset
+ *	at the end of the warm-up
+ */
+static void stress_perf_stat_derived(
+	const stress_stressor_t *ss,
+	const uint64_t counter_totals[STRESS_PERF_MAX],
+	stress_perf_derived_t *derived)
+{
+	uint64_t bogo_ops = 0, llc_misses;
+	int32_t j;
+	const uint64_t cycles = stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	const uint64_t instr = stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	const uint64_t branches = stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+	const uint64_t branch_misses = stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+	for (j = 0; j < ss->started_instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		if (stats->warmup.done && (stats->counter >= stats->warmup.counter))
+			bogo_ops += stats->counter - stats->warmup.counter;
+		else
+			bogo_ops += stats->counter;
+	}
+
+	/* The generic cache misses event is the last level cache misses */
+	llc_misses = stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#if STRESS_PERF_DEFINED(HW_CACHE_LL)
+	if ((llc_misses == STRESS_PERF_INVALID) || (llc_misses == 0)) {
+		const uint64_t rd = stress_perf_stat_total(counter_totals, PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		const uint64_t wr = stress_perf_stat_total(counter_totals, PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+		if (rd != STRESS_PERF_INVALID)
+			llc_misses = rd + ((wr != STRESS_PERF_INVALID) ? wr : 0);
+	}
+#endif
+
+	derived->ipc = stress_perf_ratio(instr, cycles, 1.0);
+	derived->cycles_per_op = stress_perf_ratio(cycles, bogo_ops, 1.0);
+	derived->instr_per_op = stress_perf_ratio(instr, bogo_ops, 1.0);
+	derived->llc_misses_per_op = stress_perf_ratio(llc_misses, bogo_ops, 1.0);
+	derived->branch_miss_ratio = stress_perf_ratio(branch_misses, branches, 100.0);
+	derived->frontend_stall = -1.0;
+	derived->backend_stall = -1.0;
+#if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_FRONTEND)
+	derived->frontend_stall = stress_perf_ratio(stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND), cycles, 100.0);
+#endif
+#if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_BACKEND)
+	derived->backend_stall = stress_perf_ratio(stress_perf_stat_total(counter_totals,
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND), cycles, 100.0);
+#endif
+}
+
+/*
+ *  stress_perf_derived_str()
+ *	format a derived metric, n/a if not available
+ */
+static char *stress_perf_derived_str(char *buf, const size_t len, const double value)
+{
+	if (value < 0.0)
+		(void)shim_strlcpy(buf, "n/a", len);
+	else
+		(void)snprintf(buf, len, "%.3f", value);
+	return buf;
+}
+
+/*
+ *  stress_perf_derived_dump()
+ *	output a compact table of the derived per bogo-op metrics
+ */
+static void stress_perf_derived_dump(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t counter_totals[STRESS_PERF_MAX];
+		stress_perf_derived_t d;
+		char b[7][16];
+
+		if (!stress_perf_stat_totals(ss, counter_totals))
+			continue;
+		stress_perf_stat_derived(ss, counter_totals, &d);
+		/* Software only counters, no hardware derived metrics */
+		if ((d.ipc < 0.0) && (d.cycles_per_op < 0.0) &&
+		    (d.instr_per_op < 0.0) && (d.llc_misses_per_op < 0.0) &&
+		    (d.branch_miss_ratio < 0.0))
+			continue;
+		if (!header) {
+			pr_inf("%-13s %7s %10s %10s %10s %9s %9s %9s\n",
+				"stressor", "IPC", "cycles", "instr.", "LLC misses",
+				"branch", "frontend", "backend");
+			pr_inf("%-13s %7s %10s %10s %10s %9s %9s %9s\n",
+				"", "", "per op", "per op", "per op",
+				"miss (%)", "stall (%)", "stall (%)");
+			header = true;
+		}
+		pr_inf("%-13s %7s %10s %10s %10s %9s %9s %9s\n",
+			stress_munge_underscore(ss->stressor->name),
+			stress_perf_derived_str(b[0], sizeof(b[0]), d.ipc),
+			stress_perf_derived_str(b[1], sizeof(b[1]), d.cycles_per_op),
+			stress_perf_derived_str(b[2], sizeof(b[2]), d.instr_per_op),
+			stress_perf_derived_str(b[3], sizeof(b[3]), d.llc_misses_per_op),
+			stress_perf_derived_str(b[4], sizeof(b[4]), d.branch_miss_ratio),
+			stress_perf_derived_str(b[5], sizeof(b[5]), d.frontend_stall),
+			stress_perf_derived_str(b[6], sizeof(b[6]), d.backend_stall));
+	}
+}
+
+/*
+ *  stress_perf_derived_yaml()
+ *	add the available derived metrics to the YAML output
+ */
+static void stress_perf_derived_yaml(FILE *yaml, const char *munged, const stress_perf_derived_t *d)
+{
+	size_t i;
+	const struct {
+		const char *name;
+		const double value;
+	} metrics[] = {
+		{ "instructions_per_cycle",	d->ipc },
+		{ "cpu_cycles_per_bogo_op",	d->cycles_per_op },
+		{ "instructions_per_bogo_op",	d->instr_per_op },
+		{ "llc_misses_per_bogo_op",	d->llc_misses_per_op },
+		{ "branch_miss_percent",	d->branch_miss_ratio },
+		{ "frontend_stall_percent",	d->frontend_stall },
+		{ "backend_stall_percent",	d->backend_stall },
+	};
+
+	for (i = 0; i < SIZEOF_ARRAY(metrics); i++) {
+		if (metrics[i].value < 0.0)
+			continue;
+		pr_yaml(yaml, "      %s: %f\n", metrics[i].name, metrics[i].value);
+	}
+	if (d->ipc >= 0.0)
+		stress_baseline_record(munged, "instructions_per_cycle", d->ipc);
+}
+
 void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const double duration)
 {
 	bool no_perf_stats = true;
@@ -605,46 +868,25 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int p;
 		uint64_t counter_totals[STRESS_PERF_MAX];
-		uint64_t total_cpu_cycles = 0;
-		uint64_t total_cache_refs = 0;
-		uint64_t total_branches = 0;
-		bool got_data = false;
+		uint64_t total_cpu_cycles, total_cache_refs, total_branches;
+		stress_perf_derived_t derived;
 		char *munged;
 
-		(void)memset(counter_totals, 0, sizeof(counter_totals));
-
 		/* Sum totals across all instances of the stressor */
-		for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++) {
-			int32_t j;
-			stress_perf_t *sp = &ss->stats[0]->sp;
-
-			if (!stress_perf_stat_succeeded(sp))
-				continue;
-
-			for (j = 0; j < ss->started_instances; j++) {
-				const uint64_t counter = sp->perf_stat[p].counter;
-
-				if (counter == STRESS_PERF_INVALID) {
-					counter_totals[p] = STRESS_PERF_INVALID;
-					break;
-				}
-				counter_totals[p] += counter;
-				got_data |= (counter > 0);
-			}
-			if (perf_info[p].type == PERF_TYPE_HARDWARE) {
-				unsigned long config = perf_info[p].config;
-
-				if (config == PERF_COUNT_HW_CPU_CYCLES)
-					total_cpu_cycles = counter_totals[p];
-				else if (config == PERF_COUNT_HW_CACHE_REFERENCES)
-					total_cache_refs = counter_totals[p];
-				else if (config == PERF_COUNT_HW_BRANCH_INSTRUCTIONS)
-					total_branches = counter_totals[p];
-			}
-		}
-
-		if (!got_data)
+		if (!stress_perf_stat_totals(ss, counter_totals))
 			continue;
+		total_cpu_cycles = stress_perf_stat_total(counter_totals,
+			PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		total_cache_refs = stress_perf_stat_total(counter_totals,
+			PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+		total_branches = stress_perf_stat_total(counter_totals,
+			PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+		if (total_cpu_cycles == STRESS_PERF_INVALID)
+			total_cpu_cycles = 0;
+		if (total_cache_refs == STRESS_PERF_INVALID)
+			total_cache_refs = 0;
+		if (total_branches == STRESS_PERF_INVALID)
+			total_branches = 0;
 
 		munged = stress_munge_underscore(ss->stressor->name);
 		pr_inf("%s:\n", munged);
@@ -658,6 +900,7 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 			if (l && (ct != STRESS_PERF_INVALID)) {
 				char extra[32];
 				char yaml_label[128];
+				char baseline_label[160];
 				*extra = '\0';
 
 				no_perf_stats = false;
@@ -691,10 +934,18 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					"\n", yaml_label, ct);
 				pr_yaml(yaml, "      %s_per_second: %f\n",
 					yaml_label, (double)ct / duration);
+				(void)snprintf(baseline_label, sizeof(baseline_label),
+					"%s_per_second", yaml_label);
+				stress_baseline_record(munged, baseline_label,
+					(double)ct / duration);
 			}
 		}
+		stress_perf_stat_derived(ss, counter_totals, &derived);
+		stress_perf_derived_yaml(yaml, munged, &derived);
 		pr_yaml(yaml, "\n");
 	}
+	if (!no_perf_stats)
+		stress_perf_derived_dump(stressors_list);
 	if (no_perf_stats) {
 		if (geteuid() != 0) {
 			char buffer[64];
@@ -720,4 +971,825 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		}
 	}
 }
+
+#if defined(_SNG_PERF_SAMPLE_IP) &&	\
+    defined(_SNG_PERF_RECORD_SAMPLE) &&	\
+    defined(HAVE_LINK_H) &&		\
+    defined(__linux__)
+
+#define PERF_SAMPLE_FREQ	(99)	/* samples per second */
+#define PERF_SAMPLE_PAGES_MAX	(256)	/* ring buffer data pages */
+#define PERF_SAMPLE_PAGES_MIN	(8)
+#define PERF_SAMPLE_SHOW	(10)	/* top symbols shown per stressor */
+#define PERF_SAMPLE_HITS	(4096)	/* symbol hash table size, power of 2 */
+#define PERF_SAMPLE_RECORD_MAX	(64)	/* largest record parsed */
+
+/* sample symbol index of samples that cannot be resolved */
+#define PERF_SYM_UNKNOWN_USER	(0xfffffffeU)
+#define PERF_SYM_UNKNOWN_KERNEL	(0xffffffffU)
+
+/* address range of a function or of an executable mapping */
+typedef struct {
+	uint64_t start;			/* start address */
+	uint64_t end;			/* end address, exclusive */
+	char *name;			/* symbol or mapping name */
+} stress_perf_sym_t;
+
+/*
+ *  Symbols are loaded by the parent before the stressors are
+ *  forked, the table is in 3 sorted segments: functions of the
+ *  stress-ng executable, executable mappings (shared libraries)
+ *  and kernel functions from /proc/kallsyms
+ */
+static stress_perf_sym_t *perf_syms;
+static uint32_t perf_syms_n;
+static uint32_t perf_syms_max;
+static uint32_t perf_syms_maps;		/* start of mappings segment */
+static uint32_t perf_syms_kernel;	/* start of kernel segment */
+
+/*
+ *  Samples drained from the ring buffer so far, this is mmap'd
+ *  shared so that the samples drained by a forked child running
+ *  the work loop (e.g. the oomable stressors) are not lost
+ */
+typedef struct {
+	int lock;			/* drain lock, 1 = draining */
+	uint64_t samples;		/* total number of samples */
+	uint64_t kernel;		/* samples in the kernel */
+	uint64_t lost;			/* samples lost, ring buffer full */
+	uint64_t dropped;		/* samples not added, hits table full */
+	stress_perf_sample_hit_t hits[PERF_SAMPLE_HITS]; /* hashed by symbol */
+} stress_perf_sample_acc_t;
+
+/* Per instance, or per thread, sampling state */
+static THREAD_LOCAL int *perf_sample_fds;	/* per CPU events, [0] is mmap'd */
+static THREAD_LOCAL int perf_sample_nfds;
+static THREAD_LOCAL void *perf_sample_buf = MAP_FAILED;
+static THREAD_LOCAL size_t perf_sample_buf_size;
+static THREAD_LOCAL stress_perf_sample_acc_t *perf_sample_acc = MAP_FAILED;
+
+/*
+ *  stress_perf_sym_add()
+ *	add a symbol to the symbol table
+ */
+static int stress_perf_sym_add(const uint64_t start, const uint64_t end, const char *name)
+{
+	if (perf_syms_n >= perf_syms_max) {
+		const uint32_t max = perf_syms_max ? perf_syms_max * 2 : 4096;
+		stress_perf_sym_t *syms;
+
+		syms = realloc(perf_syms, (size_t)max * sizeof(*syms));
+		if (!syms)
+			return -1;
+		perf_syms = syms;
+		perf_syms_max = max;
+	}
+	perf_syms[perf_syms_n].name = strdup(name);
+	if (!perf_syms[perf_syms_n].name)
+		return -1;
+	perf_syms[perf_syms_n].start = start;
+	perf_syms[perf_syms_n].end = end;
+	perf_syms_n++;
+	return 0;
+}
+
+/*
+ *  stress_perf_sym_cmp()
+ *	sort symbols by start address
+ */
+static int stress_perf_sym_cmp(const void *p1, const void *p2)
+{
+	const stress_perf_sym_t *s1 = (const stress_perf_sym_t *)p1;
+	const stress_perf_sym_t *s2 = (const stress_perf_sym_t *)p2;
+
+	if (s1->start < s2->start)
+		return -1;
+	if (s1->start > s2->start)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_perf_sym_sort()
+ *	sort a segment of the symbol table, symbols without a
+ *	size end at the start of the next symbol
+ */
+static void stress_perf_sym_sort(const uint32_t from, const uint32_t to)
+{
+	uint32_t i;
+
+	if (to <= from)
+		return;
+	qsort(&perf_syms[from], (size_t)(to - from),
+		sizeof(*perf_syms), stress_perf_sym_cmp);
+	for (i = from; i < to; i++) {
+		if (perf_syms[i].end > perf_syms[i].start)
+			continue;
+		perf_syms[i].end = (i + 1 < to) ?
+			perf_syms[i + 1].start : perf_syms[i].start + 1;
+	}
+}
+
+/*
+ *  stress_perf_sym_find()
+ *	binary search a symbol table segment for addr,
+ *	returns the symbol index or -1 if not found
+ */
+static int64_t stress_perf_sym_find(const uint32_t from, const uint32_t to, const uint64_t addr)
+{
+	int64_t lo = (int64_t)from, hi = (int64_t)to - 1, found = -1;
+
+	while (lo <= hi) {
+		const int64_t mid = lo + ((hi - lo) >> 1);
+
+		if (perf_syms[mid].start <= addr) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	if ((found >= 0) && (addr < perf_syms[found].end))
+		return found;
+	return -1;
+}
+
+/*
+ *  stress_perf_sym_load_exe()
+ *	load the function symbols of the stress-ng executable,
+ *	position independent executables are relocated by base
+ */
+static void stress_perf_sym_load_exe(const char *path, const uint64_t base)
+{
+	struct stat statbuf;
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Shdr) *shdr;
+	const ElfW(Shdr) *symtab = NULL;
+	uint8_t *data;
+	uint64_t reloc;
+	size_t i;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	if ((fstat(fd, &statbuf) < 0) || (statbuf.st_size < (off_t)sizeof(*ehdr))) {
+		(void)close(fd);
+		return;
+	}
+	data = mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (data == MAP_FAILED)
+		return;
+
+	ehdr = (const ElfW(Ehdr) *)data;
+	if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+	    (ehdr->e_shoff == 0) ||
+	    (ehdr->e_shoff + ((uint64_t)ehdr->e_shnum * sizeof(*shdr)) > (uint64_t)statbuf.st_size))
+		goto unmap;
+	reloc = (ehdr->e_type == ET_DYN) ? base : 0;
+	shdr = (const ElfW(Shdr) *)(data + ehdr->e_shoff);
+
+	/* Prefer the full symbol table, fall back to dynamic symbols */
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		if (shdr[i].sh_type == SHT_SYMTAB) {
+			symtab = &shdr[i];
+			break;
+		}
+		if (shdr[i].sh_type == SHT_DYNSYM)
+			symtab = &shdr[i];
+	}
+	if (!symtab || (symtab->sh_link >= ehdr->e_shnum) ||
+	    (symtab->sh_offset + symtab->sh_size > (uint64_t)statbuf.st_size))
+		goto unmap;
+
+	{
+		const ElfW(Shdr) *strtab = &shdr[symtab->sh_link];
+		const ElfW(Sym) *sym = (const ElfW(Sym) *)(data + symtab->sh_offset);
+		const size_t n = symtab->sh_size / sizeof(*sym);
+		const char *str = (const char *)(data + strtab->sh_offset);
+
+		if (strtab->sh_offset + strtab->sh_size > (uint64_t)statbuf.st_size)
+			goto unmap;
+
+		for (i = 0; i < n; i++) {
+			if ((ELF64_ST_TYPE(sym[i].st_info) != STT_FUNC) ||
+			    (sym[i].st_value == 0) ||
+			    (sym[i].st_name >= strtab->sh_size))
+				continue;
+			if (stress_perf_sym_add(sym[i].st_value + reloc,
+					sym[i].st_value + reloc + sym[i].st_size,
+					str + sym[i].st_name) < 0)
+				break;
+		}
+	}
+unmap:
+	(void)munmap((void *)data, (size_t)statbuf.st_size);
+}
+
+/*
+ *  stress_perf_sym_load_maps()
+ *	load the function symbols of the stress-ng executable and
+ *	then the other executable mappings by name so that time
+ *	in shared libraries is attributed to the library
+ */
+static void stress_perf_sym_load_maps(void)
+{
+	FILE *fp;
+	char exe[PATH_MAX], buffer[PATH_MAX + 256];
+	ssize_t len;
+	int pass;
+
+	len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (len < 0)
+		return;
+	exe[len] = '\0';
+
+	fp = fopen("/proc/self/maps", "r");
+	if (!fp)
+		return;
+
+	for (pass = 0; pass < 2; pass++) {
+		bool exe_loaded = false;
+
+		rewind(fp);
+		while (fgets(buffer, sizeof(buffer), fp)) {
+			uint64_t start, end, offset;
+			char perms[8], path[PATH_MAX], name[PATH_MAX + 2];
+			const char *base;
+
+			*path = '\0';
+			if (sscanf(buffer, "%" SCNx64 "-%" SCNx64 " %7s %" SCNx64 " %*s %*s %4095s",
+				   &start, &end, perms, &offset, path) < 4)
+				continue;
+			if (pass == 0) {
+				if (!exe_loaded && (offset == 0) && !strcmp(path, exe)) {
+					stress_perf_sym_load_exe(exe, start);
+					exe_loaded = true;
+				}
+				continue;
+			}
+			if ((perms[2] != 'x') || (*path == '\0'))
+				continue;
+			base = strrchr(path, '/');
+			(void)snprintf(name, sizeof(name), "[%s]", base ? base + 1 : path);
+			(void)stress_perf_sym_add(start, end, name);
+		}
+		if (pass == 0)
+			perf_syms_maps = perf_syms_n;
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_perf_sym_load_kallsyms()
+ *	load the kernel text symbols, these are only available
+ *	if /proc/kallsyms is readable and addresses are not hidden
+ */
+static void stress_perf_sym_load_kallsyms(void)
+{
+	FILE *fp;
+	char buffer[512];
+
+	fp = fopen("/proc/kallsyms", "r");
+	if (!fp)
+		return;
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		uint64_t addr;
+		char type, name[256];
+
+		if (sscanf(buffer, "%" SCNx64 " %c %255s", &addr, &type, name) != 3)
+			continue;
+		if (addr == 0)
+			break;
+		if ((type != 't') && (type != 'T'))
+			continue;
+		if (stress_perf_sym_add(addr, 0, name) < 0)
+			break;
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_perf_sample_init()
+ *	load the user and kernel symbols to resolve samples
+ */
+void stress_perf_sample_init(void)
+{
+	if (!(g_opt_flags & OPT_FLAGS_PERF_SAMPLE))
+		return;
+
+	stress_perf_sym_load_maps();
+	stress_perf_sym_sort(0, perf_syms_maps);
+	stress_perf_sym_sort(perf_syms_maps, perf_syms_n);
+
+	perf_syms_kernel = perf_syms_n;
+	stress_perf_sym_load_kallsyms();
+	stress_perf_sym_sort(perf_syms_kernel, perf_syms_n);
+
+	pr_dbg("perf-sample: %" PRIu32 " executable, %" PRIu32 " mapping and %"
+		PRIu32 " kernel symbols loaded\n", perf_syms_maps,
+		perf_syms_kernel - perf_syms_maps, perf_syms_n - perf_syms_kernel);
+	if (perf_syms_n == perf_syms_kernel)
+		pr_inf("perf-sample: kernel symbols not readable from /proc/kallsyms, "
+			"kernel samples are not resolved\n");
+}
+
+/*
+ *  stress_perf_sample_start()
+ *	start sampling the instruction pointer of the calling
+ *	process (and its children) or thread, returns true if
+ *	the samples need draining with stress_perf_sample_poll()
+ */
+bool stress_perf_sample_start(const bool threaded)
+{
+	struct perf_event_attr attr;
+	const size_t page_size = stress_get_page_size();
+	const int32_t cpus = stress_get_processors_configured();
+	size_t pages;
+	int32_t cpu;
+	int i;
+
+	if (!(g_opt_flags & OPT_FLAGS_PERF_SAMPLE))
+		return false;
+
+	(void)memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.config = PERF_COUNT_SW_CPU_CLOCK;
+	attr.freq = 1;
+	attr.sample_freq = PERF_SAMPLE_FREQ;
+	attr.sample_type = PERF_SAMPLE_IP;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+
+	/*
+	 *  Inherited events cannot be mmap'd for any CPU, so processes
+	 *  sample their children with an event per CPU all writing to
+	 *  the ring buffer of the first, threads just sample themselves
+	 */
+	perf_sample_fds = calloc((size_t)((cpus > 0) ? cpus : 1), sizeof(*perf_sample_fds));
+	if (!perf_sample_fds)
+		return false;
+	perf_sample_nfds = 0;
+
+	if (!threaded && (cpus > 0)) {
+		attr.inherit = 1;
+		for (cpu = 0; cpu < cpus; cpu++) {
+			int fd;
+
+			/* Retry without kernel samples if not allowed */
+			for (i = 0; i < 2; i++) {
+				fd = stress_sys_perf_event_open(&attr, 0, (int)cpu, -1, 0);
+				if ((fd >= 0) || (errno != EACCES))
+					break;
+				attr.exclude_kernel = 1;
+			}
+			if (fd >= 0)
+				perf_sample_fds[perf_sample_nfds++] = fd;
+		}
+	}
+	if (perf_sample_nfds == 0) {
+		attr.inherit = 0;
+		for (i = 0; i < 2; i++) {
+			const int fd = stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+
+			if (fd >= 0) {
+				perf_sample_fds[perf_sample_nfds++] = fd;
+				break;
+			}
+			attr.exclude_kernel = 1;
+		}
+	}
+	if (perf_sample_nfds == 0) {
+		pr_dbg("perf-sample: perf_event_open failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		goto err_free;
+	}
+
+	/* 1 header page + 2^n data pages, smaller if locked memory is limited */
+	for (pages = PERF_SAMPLE_PAGES_MAX; pages >= PERF_SAMPLE_PAGES_MIN; pages >>= 1) {
+		perf_sample_buf_size = (pages + 1) * page_size;
+		perf_sample_buf = mmap(NULL, perf_sample_buf_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED, perf_sample_fds[0], 0);
+		if (perf_sample_buf != MAP_FAILED)
+			break;
+	}
+	if (perf_sample_buf == MAP_FAILED) {
+		pr_dbg("perf-sample: cannot mmap sample buffer, errno=%d (%s)\n",
+			errno, strerror(errno));
+		goto err_close;
+	}
+	perf_sample_acc = (stress_perf_sample_acc_t *)mmap(NULL, sizeof(*perf_sample_acc),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (perf_sample_acc == MAP_FAILED) {
+		pr_dbg("perf-sample: cannot mmap sample hits table, errno=%d (%s)\n",
+			errno, strerror(errno));
+		goto err_unmap;
+	}
+	for (i = 1; i < perf_sample_nfds; i++)
+		(void)ioctl(perf_sample_fds[i], PERF_EVENT_IOC_SET_OUTPUT, perf_sample_fds[0]);
+	for (i = 0; i < perf_sample_nfds; i++)
+		(void)ioctl(perf_sample_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	return true;
+
+err_unmap:
+	(void)munmap(perf_sample_buf, perf_sample_buf_size);
+	perf_sample_buf = MAP_FAILED;
+err_close:
+	for (i = 0; i < perf_sample_nfds; i++)
+		(void)close(perf_sample_fds[i]);
+err_free:
+	free(perf_sample_fds);
+	perf_sample_fds = NULL;
+	perf_sample_nfds = 0;
+	return false;
+}
+
+/*
+ *  stress_perf_hit_cmp()
+ *	sort hits by symbol index
+ */
+static int stress_perf_hit_cmp(const void *p1, const void *p2)
+{
+	const uint32_t s1 = ((const stress_perf_sample_hit_t *)p1)->sym;
+	const uint32_t s2 = ((const stress_perf_sample_hit_t *)p2)->sym;
+
+	return (s1 > s2) - (s1 < s2);
+}
+
+/*
+ *  stress_perf_hit_count_cmp()
+ *	sort hits by descending number of samples
+ */
+static int stress_perf_hit_count_cmp(const void *p1, const void *p2)
+{
+	const uint32_t c1 = ((const stress_perf_sample_hit_t *)p1)->count;
+	const uint32_t c2 = ((const stress_perf_sample_hit_t *)p2)->count;
+
+	return (c1 < c2) - (c1 > c2);
+}
+
+/*
+ *  stress_perf_hits_merge()
+ *	sum the counts of hits with the same symbol, the hits
+ *	are returned in descending count order, returns the
+ *	number of unique hits
+ */
+static size_t stress_perf_hits_merge(stress_perf_sample_hit_t *hits, const size_t n)
+{
+	size_t i, j = 0;
+
+	if (n == 0)
+		return 0;
+	qsort(hits, n, sizeof(*hits), stress_perf_hit_cmp);
+	for (i = 1; i < n; i++) {
+		if (hits[i].sym == hits[j].sym) {
+			hits[j].count += hits[i].count;
+		} else {
+			hits[++j] = hits[i];
+		}
+	}
+	j++;
+	qsort(hits, j, sizeof(*hits), stress_perf_hit_count_cmp);
+	return j;
+}
+
+/*
+ *  stress_perf_sample_resolve()
+ *	map a sample address to a symbol index
+ */
+static uint32_t stress_perf_sample_resolve(const uint64_t ip, const bool kernel)
+{
+	int64_t idx;
+
+	if (kernel) {
+		idx = stress_perf_sym_find(perf_syms_kernel, perf_syms_n, ip);
+		return (idx < 0) ? PERF_SYM_UNKNOWN_KERNEL : (uint32_t)idx;
+	}
+	idx = stress_perf_sym_find(0, perf_syms_maps, ip);
+	if (idx < 0)
+		idx = stress_perf_sym_find(perf_syms_maps, perf_syms_kernel, ip);
+	return (idx < 0) ? PERF_SYM_UNKNOWN_USER : (uint32_t)idx;
+}
+
+/*
+ *  stress_perf_sample_hit()
+ *	count a sample of a symbol in the hits hash table
+ */
+static void stress_perf_sample_hit(stress_perf_sample_acc_t *acc, const uint32_t sym)
+{
+	uint32_t h = (sym * 2654435761U) & (PERF_SAMPLE_HITS - 1);
+	size_t i;
+
+	for (i = 0; i < PERF_SAMPLE_HITS; i++) {
+		stress_perf_sample_hit_t *hit = &acc->hits[h];
+
+		if (hit->count == 0)
+			hit->sym = sym;
+		if (hit->sym == sym) {
+			hit->count++;
+			return;
+		}
+		h = (h + 1) & (PERF_SAMPLE_HITS - 1);
+	}
+	acc->dropped++;
+}
+
+/*
+ *  stress_perf_sample_drain()
+ *	consume the records in the ring buffer and advance the tail
+ *	so the kernel can reuse the space, samples are counted if
+ *	keep is true and discarded otherwise
+ */
+static void stress_perf_sample_drain(const bool keep)
+{
+	const size_t page_size = stress_get_page_size();
+	struct perf_event_mmap_page *header;
+	stress_perf_sample_acc_t *acc = perf_sample_acc;
+	const uint8_t *data;
+	uint64_t head, tail, data_size;
+
+	if ((perf_sample_buf == MAP_FAILED) || (acc == MAP_FAILED))
+		return;
+	/* Another process of the instance is draining the ring */
+	if (!__sync_bool_compare_and_swap(&acc->lock, 0, 1))
+		return;
+
+	header = (struct perf_event_mmap_page *)perf_sample_buf;
+	data = (const uint8_t *)perf_sample_buf + page_size;
+	data_size = perf_sample_buf_size - page_size;
+	head = header->data_head;
+	shim_mb();
+	tail = header->data_tail;
+
+	while (keep && (tail + sizeof(struct perf_event_header) <= head)) {
+		uint64_t rec[PERF_SAMPLE_RECORD_MAX / sizeof(uint64_t)];
+		const struct perf_event_header *eh = (const struct perf_event_header *)rec;
+		size_t offset, i;
+
+		/* Records may wrap around the end of the data pages */
+		offset = (size_t)(tail % data_size);
+		for (i = 0; i < sizeof(*eh); i++)
+			((uint8_t *)rec)[i] = data[(offset + i) % data_size];
+		if ((eh->size < sizeof(*eh)) || (tail + eh->size > head))
+			break;
+		if (eh->size <= sizeof(rec)) {
+			for (i = sizeof(*eh); i < eh->size; i++)
+				((uint8_t *)rec)[i] = data[(offset + i) % data_size];
+
+			if (eh->type == PERF_RECORD_SAMPLE) {
+				const uint64_t ip = *(const uint64_t *)(eh + 1);
+				const bool kernel = (eh->misc & PERF_RECORD_MISC_CPUMODE_MASK) ==
+						    PERF_RECORD_MISC_KERNEL;
+
+				acc->samples++;
+				if (kernel)
+					acc->kernel++;
+				stress_perf_sample_hit(acc, stress_perf_sample_resolve(ip, kernel));
+			} else if (eh->type == PERF_RECORD_LOST) {
+				/* u64 id followed by u64 lost */
+				acc->lost += *((const uint64_t *)(eh + 1) + 1);
+			}
+		}
+		tail += eh->size;
+	}
+
+	/* Discarded or unparsable records are skipped */
+	shim_mb();
+	header->data_tail = head;
+	shim_mb();
+	acc->lock = 0;
+}
+
+/*
+ *  stress_perf_sample_poll()
+ *	called from the bogo-op counter updates, drain the ring
+ *	buffer once it is half full so samples are not lost
+ */
+void stress_perf_sample_poll(void)
+{
+	const struct perf_event_mmap_page *header;
+	uint64_t used;
+
+	if (perf_sample_buf == MAP_FAILED)
+		return;
+	header = (const struct perf_event_mmap_page *)perf_sample_buf;
+	used = header->data_head - header->data_tail;
+	if (used >= (perf_sample_buf_size - stress_get_page_size()) / 2)
+		stress_perf_sample_drain(true);
+}
+
+/*
+ *  stress_perf_sample_reset()
+ *	discard the samples taken so far, called at the end of
+ *	the warm-up so only the measurement phase is sampled
+ */
+void stress_perf_sample_reset(void)
+{
+	stress_perf_sample_acc_t *acc = perf_sample_acc;
+
+	if ((perf_sample_buf == MAP_FAILED) || (acc == MAP_FAILED))
+		return;
+	stress_perf_sample_drain(false);
+	while (!__sync_bool_compare_and_swap(&acc->lock, 0, 1))
+		;
+	acc->samples = 0;
+	acc->kernel = 0;
+	acc->lost = 0;
+	acc->dropped = 0;
+	(void)memset(acc->hits, 0, sizeof(acc->hits));
+	shim_mb();
+	acc->lock = 0;
+}
+
+/*
+ *  stress_perf_sample_stop()
+ *	stop sampling, drain the remaining samples from the ring
+ *	buffer and keep the symbols with the most samples
+ */
+void stress_perf_sample_stop(stress_perf_sample_t *sample)
+{
+	stress_perf_sample_acc_t *acc = perf_sample_acc;
+	size_t n = 0, j;
+	int i;
+
+	(void)memset(sample, 0, sizeof(*sample));
+	if (!perf_sample_fds)
+		return;
+
+	for (i = 0; i < perf_sample_nfds; i++)
+		(void)ioctl(perf_sample_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	/* A child killed mid drain may have left the lock held */
+	acc->lock = 0;
+	stress_perf_sample_drain(true);
+
+	sample->samples = acc->samples;
+	sample->kernel = acc->kernel;
+	sample->lost = acc->lost;
+	if (acc->dropped)
+		pr_dbg("perf-sample: %" PRIu64 " samples not attributed, "
+			"more than %d symbols hit\n", acc->dropped, PERF_SAMPLE_HITS);
+
+	/* Compact the hash table and keep the most hit symbols */
+	for (j = 0; j < PERF_SAMPLE_HITS; j++) {
+		if (acc->hits[j].count)
+			acc->hits[n++] = acc->hits[j];
+	}
+	qsort(acc->hits, n, sizeof(*acc->hits), stress_perf_hit_count_cmp);
+	if (n > STRESS_PERF_SAMPLE_TOP)
+		n = STRESS_PERF_SAMPLE_TOP;
+	(void)memcpy(sample->top, acc->hits, n * sizeof(*acc->hits));
+
+	(void)munmap((void *)acc, sizeof(*acc));
+	perf_sample_acc = MAP_FAILED;
+	(void)munmap(perf_sample_buf, perf_sample_buf_size);
+	perf_sample_buf = MAP_FAILED;
+	for (i = 0; i < perf_sample_nfds; i++)
+		(void)close(perf_sample_fds[i]);
+	free(perf_sample_fds);
+	perf_sample_fds = NULL;
+	perf_sample_nfds = 0;
+}
+
+/*
+ *  stress_perf_sym_name()
+ *	return the name of a sample symbol, perf report style
+ *	with kernel symbols prefixed with [k]
+ */
+static void stress_perf_sym_name(char *buf, const size_t len, const uint32_t sym)
+{
+	if (sym == PERF_SYM_UNKNOWN_KERNEL)
+		(void)shim_strlcpy(buf, "[k] [unknown]", len);
+	else if ((sym == PERF_SYM_UNKNOWN_USER) || (sym >= perf_syms_n))
+		(void)shim_strlcpy(buf, "[.] [unknown]", len);
+	else
+		(void)snprintf(buf, len, "%s %s",
+			(sym >= perf_syms_kernel) ? "[k]" : "[.]",
+			perf_syms[sym].name);
+}
+
+/*
+ *  stress_perf_sample_dump()
+ *	show the symbols with the most samples of each stressor
+ */
+void stress_perf_sample_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_PERF_SAMPLE))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_perf_sample_hit_t *hits;
+		uint64_t samples = 0, kernel = 0, lost = 0;
+		size_t i, n = 0;
+		int32_t j;
+
+		if (ss->started_instances < 1)
+			continue;
+		hits = calloc((size_t)ss->started_instances * STRESS_PERF_SAMPLE_TOP, sizeof(*hits));
+		if (!hits)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_perf_sample_t *sample = &ss->stats[j]->perf_sample;
+
+			samples += sample->samples;
+			kernel += sample->kernel;
+			lost += sample->lost;
+			for (i = 0; i < STRESS_PERF_SAMPLE_TOP && sample->top[i].count; i++)
+				hits[n++] = sample->top[i];
+		}
+		if (samples == 0) {
+			free(hits);
+			continue;
+		}
+		n = stress_perf_hits_merge(hits, n);
+
+		if (!header) {
+			pr_yaml(yaml, "perf-samples:\n");
+			header = true;
+		}
+		pr_inf("%s: %" PRIu64 " samples, %.2f%% in the kernel, %" PRIu64 " lost\n",
+			munged, samples, 100.0 * (double)kernel / (double)samples, lost);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      samples: %" PRIu64 "\n", samples);
+		pr_yaml(yaml, "      kernel-percent: %f\n", 100.0 * (double)kernel / (double)samples);
+		pr_yaml(yaml, "      lost: %" PRIu64 "\n", lost);
+		pr_yaml(yaml, "      symbols:\n");
+		for (i = 0; (i < n) && (i < PERF_SAMPLE_SHOW); i++) {
+			char name[128];
+			const double pc = 100.0 * (double)hits[i].count / (double)samples;
+
+			stress_perf_sym_name(name, sizeof(name), hits[i].sym);
+			pr_inf("%13.2f%% %s\n", pc, name);
+			pr_yaml(yaml, "        - symbol: \"%s\"\n", name);
+			pr_yaml(yaml, "          percent: %f\n", pc);
+		}
+		free(hits);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+}
+
+/*
+ *  stress_perf_sample_free()
+ *	free the symbol table
+ */
+void stress_perf_sample_free(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < perf_syms_n; i++)
+		free(perf_syms[i].name);
+	free(perf_syms);
+	perf_syms = NULL;
+	perf_syms_n = 0;
+	perf_syms_max = 0;
+}
+
+#else
+void stress_perf_sample_init(void)
+{
+	if (g_opt_flags & OPT_FLAGS_PERF_SAMPLE)
+		pr_inf("perf-sample: instruction pointer sampling not supported\n");
+}
+
+bool stress_perf_sample_start(const bool threaded)
+{
+	(void)threaded;
+
+	return false;
+}
+
+void stress_perf_sample_poll(void)
+{
+}
+
+void stress_perf_sample_reset(void)
+{
+}
+
+void stress_perf_sample_stop(stress_perf_sample_t *sample)
+{
+	(void)memset(sample, 0, sizeof(*sample));
+}
+
+void stress_perf_sample_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	(void)yaml;
+	(void)stressors_list;
+}
+
+void stress_perf_sample_free(void)
+{
+}
+#endif
+#else
+void stress_perf_sample_poll(void)
+{
+}
 #endif
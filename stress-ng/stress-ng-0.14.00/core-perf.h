@@ -24,11 +24,19 @@
 extern int stress_perf_open(stress_perf_t *sp);
 extern int stress_perf_enable(stress_perf_t *sp);
 extern int stress_perf_disable(stress_perf_t *sp);
+extern int stress_perf_reset(stress_perf_t *sp);
 extern int stress_perf_close(stress_perf_t *sp);
 extern bool stress_perf_stat_succeeded(const stress_perf_t *sp);
+extern const char *stress_perf_stat_label(const size_t p);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
 	const double duration);
 extern void stress_perf_init(void);
+extern void stress_perf_sample_init(void);
+extern bool stress_perf_sample_start(const bool threaded);
+extern void stress_perf_sample_reset(void);
+extern void stress_perf_sample_stop(stress_perf_sample_t *sample);
+extern void stress_perf_sample_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_perf_sample_free(void);
 #endif
 
 #endif
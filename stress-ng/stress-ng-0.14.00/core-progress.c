@@ -0,0 +1,261 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-progress.h"
+
+#define MIN_PROGRESS_DELAY	(1)		/* 1 second */
+#define MAX_PROGRESS_DELAY	(3600)		/* 1 hour */
+
+/* Previous progress tick state of a stressor instance */
+typedef struct {
+	uint64_t counter;		/* bogo-op counter */
+	uint64_t cpu_ticks;		/* user + system clock ticks */
+	pid_t pid;			/* process cpu_ticks belongs to */
+} stress_progress_instance_t;
+
+/* Previous progress tick state of a stressor */
+typedef struct {
+	uint64_t counter;		/* sum of instance bogo-op counters */
+	double rate;			/* bogo-ops per second */
+} stress_progress_stressor_t;
+
+static int32_t progress_delay = 0;		/* delay in seconds */
+static pid_t progress_pid = 0;
+
+/*
+ *  stress_set_progress()
+ *	set progress reporting delay in seconds
+ */
+int stress_set_progress(const char *const opt)
+{
+	progress_delay = stress_get_int32(opt);
+	if ((progress_delay < MIN_PROGRESS_DELAY) ||
+	    (progress_delay > MAX_PROGRESS_DELAY)) {
+		(void)fprintf(stderr, "progress must in the range %d to %d.\n",
+			MIN_PROGRESS_DELAY, MAX_PROGRESS_DELAY);
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_progress_cpu_ticks()
+ *	get user + system clock ticks used by a process,
+ *	returns false if it cannot be determined
+ */
+static bool stress_progress_cpu_ticks(const pid_t pid, uint64_t *ticks)
+{
+#if defined(__linux__)
+	char path[PATH_MAX];
+	char buf[1024];
+	const char *ptr;
+	uint64_t utime, stime;
+	ssize_t n;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	n = read(fd, buf, sizeof(buf) - 1);
+	(void)close(fd);
+	if (n <= 0)
+		return false;
+	buf[n] = '\0';
+
+	/* Skip over pid and (comm), comm may contain spaces */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return false;
+	if (sscanf(ptr + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %"
+		   SCNu64 " %" SCNu64, &utime, &stime) != 2)
+		return false;
+	*ticks = utime + stime;
+	return true;
+#else
+	(void)pid;
+	(void)ticks;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_progress_show()
+ *	show one line of progress per running stressor
+ */
+static void stress_progress_show(
+	stress_stressor_t *stressors_list,
+	stress_progress_stressor_t *prev_stressor,
+	stress_progress_instance_t *prev_instance,
+	const double elapsed,
+	const double dt,
+	const long int clk_tck)
+{
+	static uint32_t progress_count = 0;
+	const uint64_t secs = (uint64_t)elapsed;
+	stress_stressor_t *ss;
+	bool lock = false;
+	char hms[32];
+
+	(void)snprintf(hms, sizeof(hms), "%" PRIu64 ":%2.2" PRIu64 ":%2.2" PRIu64,
+		secs / 3600, (secs / 60) % 60, secs % 60);
+
+	pr_lock(&lock);
+	if ((progress_count++ % 25) == 0)
+		pr_inf("progress %10s %-13s %12s %8s %5s %7s\n",
+			"time", "stressor", "bogo ops/s", "delta",
+			"alive", "cpu%");
+
+	for (ss = stressors_list; ss; ss = ss->next, prev_stressor++) {
+		uint64_t count = 0, cpu_ticks = 0;
+		int32_t j, alive = 0;
+		bool cpu_ok = false;
+		double rate, delta;
+		char cpu[16];
+
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			stress_progress_instance_t *pi =
+				&prev_instance[stats - g_shared->stats];
+			const pid_t pid = stats->pid;
+			uint64_t counter, ticks;
+
+			if (stress_stats_counter_read(stats, &counter))
+				pi->counter = counter;
+			count += pi->counter;
+
+			if (!pid || (stats->reaped > 0.0))
+				continue;
+			alive++;
+			/* Threaded instances share one process */
+			if ((j > 0) && (ss->stats[j - 1]->pid == pid))
+				continue;
+			if (!stress_progress_cpu_ticks(pid, &ticks))
+				continue;
+			/* Need two readings of a process to get a rate */
+			if ((pi->pid == pid) && (ticks >= pi->cpu_ticks)) {
+				cpu_ticks += ticks - pi->cpu_ticks;
+				cpu_ok = true;
+			}
+			pi->pid = pid;
+			pi->cpu_ticks = ticks;
+		}
+		rate = ((dt > 0.0) && (count >= prev_stressor->counter)) ?
+			(double)(count - prev_stressor->counter) / dt : 0.0;
+		delta = (prev_stressor->rate > 0.0) ?
+			100.0 * (rate - prev_stressor->rate) / prev_stressor->rate : 0.0;
+		prev_stressor->counter = count;
+		prev_stressor->rate = rate;
+
+		if (!alive && (rate == 0.0))
+			continue;
+		if (cpu_ok && (clk_tck > 0) && (dt > 0.0))
+			(void)snprintf(cpu, sizeof(cpu), "%7.1f",
+				100.0 * (double)cpu_ticks / ((double)clk_tck * dt));
+		else
+			(void)shim_strlcpy(cpu, "-", sizeof(cpu));
+
+		pr_inf("progress %10s %-13s %12.2f %+7.1f%% %5" PRId32 " %7s\n",
+			hms, stress_munge_underscore(ss->stressor->name),
+			rate, delta, alive, cpu);
+	}
+	pr_unlock(&lock);
+}
+
+/*
+ *  stress_progress_start()
+ *	start the progress reporting process
+ */
+void stress_progress_start(stress_stressor_t *stressors_list, const int32_t instances)
+{
+	stress_progress_stressor_t *prev_stressor;
+	stress_progress_instance_t *prev_instance;
+	stress_stressor_t *ss;
+	size_t n = 0;
+	double start, now, next;
+	pid_t ppid;
+
+	if (!progress_delay || (instances < 1))
+		return;
+
+	ppid = getpid();
+	progress_pid = fork();
+	if (progress_pid < 0) {
+		pr_inf("progress: cannot fork progress process, "
+			"errno=%d (%s), disabling progress reporting\n",
+			errno, strerror(errno));
+		progress_pid = 0;
+		return;
+	} else if (progress_pid > 0) {
+		return;
+	}
+
+	stress_set_proc_name("stress-ng-progress");
+	/* SIGALRM is used to stop stressors, not the reporter */
+	if (stress_sighandler("progress", SIGALRM, SIG_IGN, NULL) < 0)
+		_exit(0);
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	prev_stressor = calloc(n, sizeof(*prev_stressor));
+	prev_instance = calloc((size_t)instances, sizeof(*prev_instance));
+	if (!prev_stressor || !prev_instance) {
+		pr_inf("progress: cannot allocate progress state, "
+			"disabling progress reporting\n");
+		free(prev_instance);
+		free(prev_stressor);
+		_exit(0);
+	}
+
+	start = stress_time_now();
+	now = start;
+	next = start;
+	while (getppid() == ppid) {
+		const double prev = now;
+
+		next += (double)progress_delay;
+		now = stress_time_now();
+		if (next > now)
+			(void)shim_nanosleep_uint64((uint64_t)((next - now) * (double)STRESS_NANOSECOND));
+		else
+			next = now;	/* overran, resync */
+		now = stress_time_now();
+		stress_progress_show(stressors_list, prev_stressor, prev_instance,
+			now - start, now - prev, sysconf(_SC_CLK_TCK));
+	}
+	free(prev_instance);
+	free(prev_stressor);
+	_exit(0);
+}
+
+/*
+ *  stress_progress_stop()
+ *	stop the progress reporting process
+ */
+void stress_progress_stop(void)
+{
+	if (progress_pid > 0) {
+		int status;
+
+		(void)kill(progress_pid, SIGKILL);
+		(void)shim_waitpid(progress_pid, &status, 0);
+		progress_pid = 0;
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-rate.h"
+#include "core-time.h"
+
+#define MIN_RATE		(1)
+#define MAX_RATE		(1000000000ULL)
+#define RATE_BACKLOG_NS		(1000000000ULL)	/* forgive backlog > 1 sec */
+
+/* start time the current op was scheduled for, 0 = none */
+static THREAD_LOCAL uint64_t rate_scheduled_ns;
+
+/*
+ *  stress_set_rate()
+ *	set the --rate bogo ops per second of a stressor
+ */
+int stress_set_rate(const char *opt)
+{
+	uint64_t rate;
+
+	rate = stress_get_uint64(opt);
+	stress_check_range("rate", rate, MIN_RATE, MAX_RATE);
+	return stress_set_setting("rate", TYPE_ID_UINT64, &rate);
+}
+
+/*
+ *  stress_rate_init()
+ *	reset the shared token bucket of the current stressor,
+ *	must be called before the instances are started
+ */
+void stress_rate_init(stress_rate_t *rate)
+{
+	uint64_t ops_per_sec = 0;
+
+	(void)stress_get_setting("rate", &ops_per_sec);
+	rate->interval_ns = ops_per_sec ? STRESS_NANOSECOND / ops_per_sec : 0;
+	if (ops_per_sec && !rate->interval_ns)
+		rate->interval_ns = 1;
+	rate->tat = 0;
+}
+
+/*
+ *  stress_rate_wait()
+ *	account for ops bogo ops and wait until the next op is
+ *	due. The ops of all the instances are scheduled at a
+ *	fixed rate from a shared theoretical arrival time, a
+ *	slow op does not reduce the offered load unless the
+ *	backlog exceeds RATE_BACKLOG_NS
+ */
+void stress_rate_wait(stress_rate_t *rate, const uint64_t ops)
+{
+	const uint64_t now = stress_time_now_ns();
+	uint64_t tat, slot;
+
+	do {
+		tat = rate->tat;
+		slot = (tat + RATE_BACKLOG_NS < now) ? now : tat;
+	} while (!__sync_bool_compare_and_swap(&rate->tat, tat,
+			slot + (rate->interval_ns * ops)));
+
+	rate_scheduled_ns = slot;
+	if (slot > now) {
+		const uint64_t delay = slot - now;
+		struct timespec ts;
+
+		if (!keep_stressing_flag())
+			return;
+		ts.tv_sec = (time_t)(delay / STRESS_NANOSECOND);
+		ts.tv_nsec = (long)(delay % STRESS_NANOSECOND);
+		(void)nanosleep(&ts, NULL);
+	}
+}
+
+/*
+ *  stress_rate_scheduled_ns()
+ *	return and clear the time the current op was scheduled
+ *	to start, 0 if the stressor is not rate limited
+ */
+uint64_t stress_rate_scheduled_ns(void)
+{
+	const uint64_t scheduled = rate_scheduled_ns;
+
+	rate_scheduled_ns = 0;
+	return scheduled;
+}
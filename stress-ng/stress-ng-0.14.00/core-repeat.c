@@ -0,0 +1,237 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-repeat.h"
+
+#define MIN_REPEAT		(1)
+#define MAX_REPEAT		(10000)
+
+/* Per run results of a stressor */
+typedef struct {
+	uint64_t bogo_ops;		/* bogo ops of all instances */
+	double wall_time;		/* average wall clock time */
+	double cpu_time;		/* total usr + sys time */
+} stress_repeat_run_t;
+
+/* Per stressor results of all the runs */
+typedef struct {
+	stress_repeat_run_t *runs;	/* results, one per completed run */
+	int32_t n;			/* number of completed runs */
+} stress_repeat_t;
+
+static int32_t repeat = 1;			/* number of runs */
+static stress_repeat_t *repeats;		/* per stressor results */
+static size_t repeats_stressors;		/* number of stressors */
+
+/*
+ *  Two tailed 95% Student's t critical values for
+ *  1..30 degrees of freedom, beyond 30 use 1.96
+ */
+static const double t_95[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+/*
+ *  stress_set_repeat()
+ *	set number of times to run the stressors
+ */
+int stress_set_repeat(const char *opt)
+{
+	repeat = stress_get_int32(opt);
+	if ((repeat < MIN_REPEAT) || (repeat > MAX_REPEAT)) {
+		(void)fprintf(stderr, "repeat must in the range %d to %d.\n",
+			MIN_REPEAT, MAX_REPEAT);
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_get_repeat()
+ *	get number of times to run the stressors
+ */
+int32_t stress_get_repeat(void)
+{
+	return repeat;
+}
+
+/*
+ *  stress_repeat_init()
+ *	allocate per stressor per run result buffers
+ */
+int stress_repeat_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	if (repeat < 2)
+		return 0;
+
+	for (repeats_stressors = 0, ss = stressors_list; ss; ss = ss->next)
+		repeats_stressors++;
+	if (!repeats_stressors)
+		return 0;
+
+	repeats = calloc(repeats_stressors, sizeof(*repeats));
+	if (!repeats)
+		goto err;
+	for (i = 0; i < repeats_stressors; i++) {
+		repeats[i].runs = calloc((size_t)repeat, sizeof(*repeats[i].runs));
+		if (!repeats[i].runs)
+			goto err;
+	}
+	return 0;
+err:
+	pr_err("cannot allocate repeat results for %" PRId32 " runs\n", repeat);
+	stress_repeat_free();
+	return -1;
+}
+
+/*
+ *  stress_repeat_record()
+ *	record the results of the index'th stressor for a run
+ */
+void stress_repeat_record(
+	const size_t index,
+	const uint64_t bogo_ops,
+	const double wall_time,
+	const double cpu_time)
+{
+	stress_repeat_t *r;
+	stress_repeat_run_t *run;
+
+	if (!repeats || (index >= repeats_stressors))
+		return;
+	r = &repeats[index];
+	if (r->n >= repeat)
+		return;
+	run = &r->runs[r->n++];
+	run->bogo_ops = bogo_ops;
+	run->wall_time = wall_time;
+	run->cpu_time = cpu_time;
+}
+
+/*
+ *  stress_repeat_rate()
+ *	bogo ops per second of real time of a run
+ */
+static inline double stress_repeat_rate(const stress_repeat_run_t *run)
+{
+	return (run->wall_time > 0.0) ? (double)run->bogo_ops / run->wall_time : 0.0;
+}
+
+/*
+ *  stress_repeat_dump()
+ *	report the mean, standard deviation, coefficient of variation
+ *	and 95% confidence interval of the bogo ops per second (real time)
+ *	of each stressor over all the runs
+ */
+void stress_repeat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	if (!repeats)
+		return;
+
+	pr_inf("%-13s %5s %12s %12s %8s %27s\n",
+		"stressor", "runs", "bogo ops/s", "bogo ops/s", "CV", "bogo ops/s");
+	pr_inf("%-13s %5s %12s %12s %8s %27s\n",
+		"", "", "(mean)", "(std.dev.)", "(%)", "(95% confidence interval)");
+	pr_yaml(yaml, "repeat:\n");
+
+	for (i = 0, ss = stressors_list; ss && (i < repeats_stressors); ss = ss->next, i++) {
+		const stress_repeat_t *r = &repeats[i];
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		double sum = 0.0, sum_sq = 0.0, mean, stddev = 0.0, cv, ci = 0.0;
+		char buf[64];
+		int32_t j;
+
+		if (!r->n)
+			continue;
+
+		for (j = 0; j < r->n; j++)
+			sum += stress_repeat_rate(&r->runs[j]);
+		mean = sum / (double)r->n;
+		for (j = 0; j < r->n; j++) {
+			const double d = stress_repeat_rate(&r->runs[j]) - mean;
+
+			sum_sq += d * d;
+		}
+		if (r->n > 1) {
+			const int32_t df = r->n - 1;
+			const double t = (df <= (int32_t)SIZEOF_ARRAY(t_95)) ?
+				t_95[df - 1] : 1.96;
+
+			/* Sample standard deviation */
+			stddev = sqrt(sum_sq / (double)df);
+			ci = t * stddev / sqrt((double)r->n);
+			(void)snprintf(buf, sizeof(buf), "%.2f - %.2f",
+				mean - ci, mean + ci);
+		} else {
+			(void)shim_strlcpy(buf, "-", sizeof(buf));
+		}
+		cv = (mean > 0.0) ? 100.0 * stddev / mean : 0.0;
+
+		pr_inf("%-13s %5" PRId32 " %12.2f %12.2f %8.2f %27s\n",
+			munged, r->n, mean, stddev, cv, buf);
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      runs:\n");
+		for (j = 0; j < r->n; j++) {
+			const stress_repeat_run_t *run = &r->runs[j];
+
+			pr_yaml(yaml, "        - run: %" PRId32 "\n", j + 1);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", run->bogo_ops);
+			pr_yaml(yaml, "          wall-clock-time: %f\n", run->wall_time);
+			pr_yaml(yaml, "          usr-sys-time: %f\n", run->cpu_time);
+			pr_yaml(yaml, "          bogo-ops-per-second-real-time: %f\n",
+				stress_repeat_rate(run));
+			pr_yaml(yaml, "          bogo-ops-per-second-usr-sys-time: %f\n",
+				(run->cpu_time > 0.0) ? (double)run->bogo_ops / run->cpu_time : 0.0);
+		}
+		pr_yaml(yaml, "      bogo-ops-per-second-mean: %f\n", mean);
+		pr_yaml(yaml, "      bogo-ops-per-second-stddev: %f\n", stddev);
+		pr_yaml(yaml, "      bogo-ops-per-second-cv-percent: %f\n", cv);
+		if (r->n > 1) {
+			pr_yaml(yaml, "      bogo-ops-per-second-ci95-low: %f\n", mean - ci);
+			pr_yaml(yaml, "      bogo-ops-per-second-ci95-high: %f\n", mean + ci);
+		}
+		pr_yaml(yaml, "\n");
+	}
+}
+
+/*
+ *  stress_repeat_free()
+ *	free per stressor per run result buffers
+ */
+void stress_repeat_free(void)
+{
+	size_t i;
+
+	if (!repeats)
+		return;
+	for (i = 0; i < repeats_stressors; i++)
+		free(repeats[i].runs);
+	free(repeats);
+	repeats = NULL;
+	repeats_stressors = 0;
+}
@@ -0,0 +1,570 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-repeat.h"
+#include "core-sampler.h"
+#include "core-scaling.h"
+
+#define MIN_METRICS_INTERVAL	(10)		/* 10 milliseconds */
+#define MAX_METRICS_INTERVAL	(3600000)	/* 1 hour */
+#define MAX_SAMPLER_BYTES	(64 * MB)	/* ring size limit */
+
+#define DEFAULT_STEADY_STATE_INTERVAL	(1000)	/* 1 second */
+#define DEFAULT_STEADY_STATE_WINDOW	(10)	/* intervals */
+#define MIN_STEADY_STATE_WINDOW		(3)
+#define MAX_STEADY_STATE_WINDOW		(1000)
+
+/* Per stressor steady state detection state */
+typedef struct {
+	uint64_t samples;		/* samples with all instances running */
+	bool converged;			/* steady state reached */
+} stress_steady_state_t;
+
+static uint64_t metrics_interval = 0;		/* interval in milliseconds */
+static double steady_state_cv = 0.0;		/* CV % threshold, 0 = disabled */
+static uint64_t steady_state_window = DEFAULT_STEADY_STATE_WINDOW;
+static pid_t sampler_pid = 0;
+
+/*
+ *  stress_set_metrics_interval()
+ *	set bogo-op sampling interval in milliseconds
+ */
+int stress_set_metrics_interval(const char *opt)
+{
+	metrics_interval = stress_get_uint64(opt);
+	stress_check_range("metrics-interval", metrics_interval,
+		MIN_METRICS_INTERVAL, MAX_METRICS_INTERVAL);
+	return 0;
+}
+
+/*
+ *  stress_set_steady_state()
+ *	set coefficient of variation threshold (in percent) of the
+ *	bogo-op rate at which a stressor is deemed to be steady
+ */
+int stress_set_steady_state(const char *opt)
+{
+	char *end;
+
+	errno = 0;
+	steady_state_cv = strtod(opt, &end);
+	if ((errno != 0) || (end == opt) || (*end != '\0')) {
+		(void)fprintf(stderr, "Invalid number %s for steady-state\n", opt);
+		longjmp(g_error_env, 1);
+	}
+	if ((steady_state_cv <= 0.0) || (steady_state_cv > 100.0)) {
+		(void)fprintf(stderr, "steady-state must be a percentage "
+			"greater than 0 and no more than 100\n");
+		longjmp(g_error_env, 1);
+	}
+	return 0;
+}
+
+/*
+ *  stress_set_steady_state_window()
+ *	set number of sample intervals the steady state
+ *	coefficient of variation is computed over
+ */
+int stress_set_steady_state_window(const char *opt)
+{
+	steady_state_window = stress_get_uint64(opt);
+	stress_check_range("steady-state-window", steady_state_window,
+		MIN_STEADY_STATE_WINDOW, MAX_STEADY_STATE_WINDOW);
+	return 0;
+}
+
+/*
+ *  stress_sampler_read_counter()
+ *	read a stressor bogo-op counter, if it is being
+ *	updated then fall back to the previous sample
+ */
+static inline uint64_t stress_sampler_read_counter(
+	const stress_stats_t *stats,
+	const uint64_t prev)
+{
+	uint64_t counter;
+
+	return stress_stats_counter_read(stats, &counter) ? counter : prev;
+}
+
+/*
+ *  stress_sampler_sample()
+ *	take a snapshot of all the bogo-op counters
+ */
+static void stress_sampler_sample(stress_sampler_t *sampler)
+{
+	const size_t slot = (size_t)(sampler->ticks % sampler->slots);
+	const size_t prev_slot = (slot ? slot : sampler->slots) - 1;
+	uint64_t *counter = sampler->counter + (slot * sampler->instances);
+	const uint64_t *prev = sampler->counter + (prev_slot * sampler->instances);
+	size_t i;
+
+	for (i = 0; i < sampler->instances; i++) {
+		counter[i] = stress_sampler_read_counter(&g_shared->stats[i],
+			sampler->ticks ? prev[i] : 0);
+	}
+	sampler->time[slot] = stress_time_now();
+	shim_mb();
+	sampler->ticks++;
+}
+
+/*
+ *  stress_sampler_sum()
+ *	sum the bogo-op counters of the first n instances of a
+ *	stressor for the given sample slot
+ */
+static uint64_t stress_sampler_sum(
+	const stress_sampler_t *sampler,
+	const stress_stressor_t *ss,
+	const int32_t n,
+	const size_t slot)
+{
+	const uint64_t *counter = sampler->counter + (slot * sampler->instances);
+	uint64_t sum = 0;
+	int32_t j;
+
+	for (j = 0; j < n; j++) {
+		const size_t i = (size_t)(ss->stats[j] - g_shared->stats);
+
+		if (i < sampler->instances)
+			sum += counter[i];
+	}
+	return sum;
+}
+
+/*
+ *  stress_sampler_steady_state()
+ *	check if the bogo-op rate of each running stressor has
+ *	a coefficient of variation below the threshold over the
+ *	last window of intervals, if so stop its instances
+ */
+static void stress_sampler_steady_state(
+	const stress_sampler_t *sampler,
+	stress_stressor_t *stressors_list,
+	stress_steady_state_t *steady)
+{
+	const size_t window = (size_t)steady_state_window;
+	stress_stressor_t *ss;
+
+	for (ss = stressors_list; ss; ss = ss->next, steady++) {
+		double sum = 0.0, sum_sq = 0.0, mean, cv, t_start = 0.0;
+		int32_t j;
+		size_t i;
+		bool running = true;
+
+		if (steady->converged)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+
+			if (!stats->pid || (stats->reaped > 0.0) ||
+			    (stats->finish > stats->start)) {
+				running = false;
+				break;
+			}
+			if ((t_start == 0.0) || (stats->start < t_start))
+				t_start = stats->start;
+		}
+		if (!running) {
+			steady->samples = 0;
+			continue;
+		}
+		/* Need window + 1 samples to compute window rates */
+		steady->samples++;
+		if ((steady->samples <= window) ||
+		    (sampler->ticks <= window) ||
+		    (window >= sampler->slots))
+			continue;
+
+		for (i = 0; i < window; i++) {
+			const uint64_t tick = sampler->ticks - 1 - i;
+			const size_t slot = (size_t)(tick % sampler->slots);
+			const size_t prev_slot = (size_t)((tick - 1) % sampler->slots);
+			const uint64_t count = stress_sampler_sum(sampler, ss, ss->num_instances, slot);
+			const uint64_t prev = stress_sampler_sum(sampler, ss, ss->num_instances, prev_slot);
+			const double dt = sampler->time[slot] - sampler->time[prev_slot];
+			const double rate = ((dt > 0.0) && (count >= prev)) ?
+				(double)(count - prev) / dt : 0.0;
+
+			sum += rate;
+			sum_sq += rate * rate;
+		}
+		mean = sum / (double)window;
+		if (mean <= 0.0)
+			continue;
+		cv = 100.0 * sqrt(STRESS_MAXIMUM(0.0, (sum_sq / (double)window) - (mean * mean))) / mean;
+		if (cv >= steady_state_cv)
+			continue;
+
+		steady->converged = true;
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *stats = ss->stats[j];
+
+			stats->steady_state = stress_time_now() - t_start;
+			stats->steady_state_cv = cv;
+			/* Threaded instances share one process */
+			if ((j == 0) || (ss->stats[j - 1]->pid != stats->pid))
+				(void)kill(stats->pid, SIGALRM);
+		}
+	}
+}
+
+/*
+ *  stress_sampler_runs()
+ *	number of --timeout long runs the stressors are run for,
+ *	taking the run mode and --repeat into account
+ */
+static uint64_t stress_sampler_runs(stress_stressor_t *stressors_list)
+{
+	const stress_stressor_t *ss;
+	const int32_t *steps;
+	const size_t n_steps = stress_get_scaling(&steps);
+	uint64_t n = 0, phases = 0, runs;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		n++;
+		if (!ss->prev || (ss->prev->phase != ss->phase))
+			phases++;
+	}
+
+	if (n_steps)
+		runs = n * n_steps;
+	else if (g_opt_flags & OPT_FLAGS_INTERFERENCE)
+		runs = n + ((n * (n - 1)) / 2);
+	else if (phases > 1)
+		runs = phases;
+	else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL)
+		runs = n;
+	else
+		runs = 1;
+
+	return runs * (uint64_t)stress_get_repeat();
+}
+
+/*
+ *  stress_sampler_start()
+ *	map the sample ring and start the sampling process
+ */
+void stress_sampler_start(stress_stressor_t *stressors_list, const int32_t instances)
+{
+	stress_sampler_t *sampler;
+	stress_stressor_t *ss;
+	const size_t page_size = stress_get_page_size();
+	size_t slot_size, slots, len;
+	uint64_t runtime = g_opt_timeout, runs;
+	pid_t ppid;
+
+	/* Steady state detection needs samples */
+	if ((steady_state_cv > 0.0) && !metrics_interval)
+		metrics_interval = DEFAULT_STEADY_STATE_INTERVAL;
+	if (!metrics_interval || (instances < 1))
+		return;
+
+	/*
+	 *  Size the ring for the total planned run time of all the
+	 *  sequential, scaling, interference, phase and --repeat runs,
+	 *  runs that are too long for the ring limit just retain the
+	 *  most recent samples
+	 */
+	runs = stress_sampler_runs(stressors_list);
+	runtime = (runtime <= (UINT64_MAX / 1000) / runs) ? runtime * runs : 0;
+	slot_size = sizeof(*sampler->time) + (sizeof(*sampler->counter) * (size_t)instances);
+	slots = MAX_SAMPLER_BYTES / slot_size;
+	if (runtime && (((runtime * 1000) / metrics_interval) + 2 < slots))
+		slots = (size_t)((runtime * 1000) / metrics_interval) + 2;
+	if (slots < 2) {
+		pr_inf("metrics-interval: too many instances to sample, disabling sampling\n");
+		return;
+	}
+
+	len = sizeof(*sampler) + (slots * slot_size);
+	len = (len + page_size - 1) & ~(page_size - 1);
+	sampler = (stress_sampler_t *)mmap(NULL, len, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANON, -1, 0);
+	if (sampler == MAP_FAILED) {
+		pr_inf("metrics-interval: cannot mmap %zd bytes for samples, "
+			"errno=%d (%s), disabling sampling\n",
+			len, errno, strerror(errno));
+		return;
+	}
+	sampler->length = len;
+	sampler->slots = slots;
+	sampler->instances = (size_t)instances;
+	sampler->interval = (double)metrics_interval / 1000.0;
+	sampler->ticks = 0;
+	sampler->counter = (uint64_t *)(sampler + 1);
+	sampler->time = (double *)(sampler->counter + (slots * (size_t)instances));
+	sampler->start = stress_time_now();
+	g_shared->sampler = sampler;
+
+	ppid = getpid();
+	sampler_pid = fork();
+	if (sampler_pid < 0) {
+		pr_inf("metrics-interval: cannot fork sampler process, "
+			"errno=%d (%s), disabling sampling\n",
+			errno, strerror(errno));
+		sampler_pid = 0;
+		stress_sampler_free();
+		return;
+	} else if (sampler_pid == 0) {
+		double next = sampler->start;
+		stress_steady_state_t *steady = NULL;
+
+		stress_set_proc_name("stress-ng-sampler");
+		/* SIGALRM is used to stop stressors, not the sampler */
+		if (stress_sighandler("sampler", SIGALRM, SIG_IGN, NULL) < 0)
+			_exit(0);
+
+		if (steady_state_cv > 0.0) {
+			size_t n = 0;
+
+			for (ss = stressors_list; ss; ss = ss->next)
+				n++;
+			steady = calloc(n, sizeof(*steady));
+			if (!steady)
+				pr_inf("steady-state: cannot allocate state, "
+					"steady state detection disabled\n");
+		}
+
+		while (getppid() == ppid) {
+			const double now = stress_time_now();
+
+			next += sampler->interval;
+			if (next > now)
+				(void)shim_nanosleep_uint64((uint64_t)((next - now) * (double)STRESS_NANOSECOND));
+			else
+				next = now;	/* overran, resync */
+			stress_sampler_sample(sampler);
+			if (steady)
+				stress_sampler_steady_state(sampler, stressors_list, steady);
+		}
+		free(steady);
+		_exit(0);
+	}
+}
+
+/*
+ *  stress_sampler_stop()
+ *	stop the sampling process
+ */
+void stress_sampler_stop(void)
+{
+	if (sampler_pid > 0) {
+		int status;
+
+		(void)kill(sampler_pid, SIGKILL);
+		(void)shim_waitpid(sampler_pid, &status, 0);
+		sampler_pid = 0;
+	}
+}
+
+/*
+ *  stress_sampler_dump_csv()
+ *	dump samples of all stressors in comma separated value format,
+ *	one row per sample
+ */
+static void stress_sampler_dump_csv(
+	const stress_sampler_t *sampler,
+	stress_stressor_t *stressors_list,
+	const char *filename)
+{
+	const uint64_t first = (sampler->ticks > sampler->slots) ?
+		sampler->ticks - sampler->slots : 0;
+	stress_stressor_t *ss;
+	uint64_t tick;
+	double prev_time = sampler->start;
+	FILE *fp;
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		pr_err("metrics-interval: cannot open CSV file %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+
+	(void)fprintf(fp, "time");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+
+		(void)fprintf(fp, ",%s bogo-ops,%s bogo-ops-per-second", munged, munged);
+	}
+	(void)fprintf(fp, "\n");
+
+	for (tick = first; tick < sampler->ticks; tick++) {
+		const size_t slot = (size_t)(tick % sampler->slots);
+		const size_t prev_slot = (slot ? slot : sampler->slots) - 1;
+		const double t = sampler->time[slot];
+		const double dt = t - prev_time;
+
+		(void)fprintf(fp, "%.3f", t - sampler->start);
+		for (ss = stressors_list; ss; ss = ss->next) {
+			const uint64_t count = stress_sampler_sum(sampler, ss, ss->started_instances, slot);
+			const uint64_t prev = (tick > first) ?
+				stress_sampler_sum(sampler, ss, ss->started_instances, prev_slot) :
+				(first ? count : 0);
+			const double rate = ((dt > 0.0) && (count >= prev)) ?
+				(double)(count - prev) / dt : 0.0;
+
+			(void)fprintf(fp, ",%" PRIu64 ",%.2f", count, rate);
+		}
+		(void)fprintf(fp, "\n");
+		prev_time = t;
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_sampler_dump()
+ *	dump per interval bogo-op samples of each stressor
+ */
+void stress_sampler_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	const stress_sampler_t *sampler = g_shared ? g_shared->sampler : NULL;
+	stress_stressor_t *ss;
+	uint64_t first;
+	char *csv_filename = NULL;
+	bool lock = false;
+
+	if (!sampler || !sampler->ticks)
+		return;
+
+	first = (sampler->ticks > sampler->slots) ? sampler->ticks - sampler->slots : 0;
+	if (first)
+		pr_inf("metrics-interval: sample ring too small, only the last "
+			"%zd of %" PRIu64 " samples are retained\n",
+			sampler->slots, sampler->ticks);
+
+	pr_lock(&lock);
+	pr_inf("%-13s %9.9s %12.12s %12.12s %12.12s\n",
+		"stressor", "samples", "bogo ops/s", "bogo ops/s", "bogo ops/s");
+	pr_inf("%-13s %9.9s %12.12s %12.12s %12.12s\n",
+		"", "", "(min)", "(mean)", "(max)");
+	pr_unlock(&lock);
+	pr_yaml(yaml, "metrics-interval:\n");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		double t_start = 0.0, t_finish = 0.0, prev_time;
+		double rate_min = 0.0, rate_max = 0.0, rate_total = 0.0;
+		uint64_t tick, prev_count = 0, n = 0;
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if ((stats->start > 0.0) && ((t_start == 0.0) || (stats->start < t_start)))
+				t_start = stats->start;
+			if (stats->finish > t_finish)
+				t_finish = stats->finish;
+		}
+		if (t_start == 0.0)
+			continue;
+		if (t_finish < t_start)
+			t_finish = sampler->time[(sampler->ticks - 1) % sampler->slots];
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      interval: %f\n", sampler->interval);
+		pr_yaml(yaml, "      samples:\n");
+
+		prev_time = t_start;
+		for (tick = first; tick < sampler->ticks; tick++) {
+			const size_t slot = (size_t)(tick % sampler->slots);
+			const uint64_t count = stress_sampler_sum(sampler, ss, ss->started_instances, slot);
+			double t = sampler->time[slot], rate;
+
+			if (t < t_start)
+				continue;
+			if (prev_time >= t_finish)
+				break;
+			/* Counters are final after the finish time, so clip to it */
+			if (t > t_finish)
+				t = t_finish;
+			/* Ring wrapped, earliest retained sample is just a reference point */
+			if (first && (tick == first)) {
+				prev_count = count;
+				prev_time = t;
+				continue;
+			}
+			rate = ((t > prev_time) && (count >= prev_count)) ?
+				(double)(count - prev_count) / (t - prev_time) : 0.0;
+
+			pr_yaml(yaml, "        - time: %f\n", t - sampler->start);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", count);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", rate);
+
+			if ((n == 0) || (rate < rate_min))
+				rate_min = rate;
+			if (rate > rate_max)
+				rate_max = rate;
+			rate_total += rate;
+			n++;
+			prev_count = count;
+			prev_time = t;
+		}
+		if (steady_state_cv > 0.0) {
+			const stress_stats_t *const stats = ss->stats[0];
+
+			pr_yaml(yaml, "      steady-state: %s\n",
+				stats->steady_state > 0.0 ? "true" : "false");
+			if (stats->steady_state > 0.0) {
+				pr_yaml(yaml, "      steady-state-seconds: %f\n", stats->steady_state);
+				pr_yaml(yaml, "      steady-state-cv-percent: %f\n", stats->steady_state_cv);
+			}
+		}
+		pr_yaml(yaml, "\n");
+
+		pr_inf("%-13s %9" PRIu64 " %12.2f %12.2f %12.2f\n",
+			munged, n, rate_min,
+			n ? rate_total / (double)n : 0.0, rate_max);
+	}
+
+	if (steady_state_cv > 0.0) {
+		for (ss = stressors_list; ss; ss = ss->next) {
+			const stress_stats_t *const stats = ss->stats[0];
+			const char *munged = stress_munge_underscore(ss->stressor->name);
+
+			if (!ss->started_instances)
+				continue;
+			if (stats->steady_state > 0.0)
+				pr_inf("steady-state: %s converged after %.2fs "
+					"(bogo ops/s CV %.2f%% over %" PRIu64 " intervals)\n",
+					munged, stats->steady_state,
+					stats->steady_state_cv, steady_state_window);
+			else
+				pr_inf("steady-state: %s did not converge to a "
+					"CV below %.2f%%\n", munged, steady_state_cv);
+		}
+	}
+
+	(void)stress_get_setting("metrics-csv", &csv_filename);
+	if (csv_filename)
+		stress_sampler_dump_csv(sampler, stressors_list, csv_filename);
+}
+
+/*
+ *  stress_sampler_free()
+ *	unmap the sample ring
+ */
+void stress_sampler_free(void)
+{
+	if (g_shared && g_shared->sampler) {
+		(void)munmap((void *)g_shared->sampler, g_shared->sampler->length);
+		g_shared->sampler = NULL;
+	}
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-scaling.h"
+
+#define MAX_SCALING_STEPS	(64)
+#define SCALING_KNEE		(80.0)	/* efficiency % knee */
+
+/* Results of a stressor at one instance count */
+typedef struct {
+	uint64_t bogo_ops;		/* bogo ops of all instances */
+	double wall_time;		/* average wall clock time */
+	double cpu_time;		/* total usr + sys time */
+	bool valid;			/* true if step was run */
+} stress_scaling_step_t;
+
+static int32_t scaling_steps[MAX_SCALING_STEPS];	/* instance counts */
+static size_t scaling_n = 0;				/* number of steps */
+static stress_scaling_step_t *scaling_results;		/* [stressor][step] */
+static size_t scaling_stressors;
+
+/*
+ *  stress_scaling_instances()
+ *	parse an instance count, 0 = configured CPUs, < 0 = online CPUs
+ */
+static int32_t stress_scaling_instances(const char *str)
+{
+	int32_t n = stress_get_int32(str);
+
+	if (n == 0)
+		n = stress_get_processors_configured();
+	else if (n < 0)
+		n = stress_get_processors_online();
+	stress_check_max_stressors("scaling", n);
+	return n;
+}
+
+/*
+ *  stress_set_scaling()
+ *	set the instance counts to sweep, either a comma separated
+ *	list or N for 1, 2, 4 .. up to N instances
+ */
+int stress_set_scaling(const char *opt)
+{
+	char *str, *token, *saveptr = NULL, *ptr;
+
+	scaling_n = 0;
+	if (!strchr(opt, ',')) {
+		const int32_t max = stress_scaling_instances(opt);
+		int32_t n;
+
+		for (n = 1; (n < max) && (scaling_n < MAX_SCALING_STEPS - 1); n <<= 1)
+			scaling_steps[scaling_n++] = n;
+		scaling_steps[scaling_n++] = max;
+		return 0;
+	}
+
+	str = strdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "out of memory parsing '%s'\n", opt);
+		longjmp(g_error_env, 1);
+	}
+	for (ptr = str; (token = strtok_r(ptr, ",", &saveptr)) != NULL; ptr = NULL) {
+		if (scaling_n >= MAX_SCALING_STEPS) {
+			(void)fprintf(stderr, "scaling allows a maximum of %d "
+				"instance counts\n", MAX_SCALING_STEPS);
+			free(str);
+			longjmp(g_error_env, 1);
+		}
+		scaling_steps[scaling_n++] = stress_scaling_instances(token);
+	}
+	free(str);
+	return 0;
+}
+
+/*
+ *  stress_get_scaling()
+ *	get the instance counts to sweep, returns number of steps,
+ *	0 if --scaling is not enabled
+ */
+size_t stress_get_scaling(const int32_t **steps)
+{
+	*steps = scaling_steps;
+	return scaling_n;
+}
+
+/*
+ *  stress_scaling_init()
+ *	allocate per stressor per step result buffers
+ */
+int stress_scaling_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!scaling_n)
+		return 0;
+
+	for (scaling_stressors = 0, ss = stressors_list; ss; ss = ss->next)
+		scaling_stressors++;
+	if (!scaling_stressors)
+		return 0;
+
+	scaling_results = calloc(scaling_stressors * scaling_n, sizeof(*scaling_results));
+	if (!scaling_results) {
+		pr_err("cannot allocate scaling results for %zu steps\n", scaling_n);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_scaling_record()
+ *	record the results of the index'th stressor for a step
+ */
+void stress_scaling_record(
+	const size_t index,
+	const size_t step,
+	const uint64_t bogo_ops,
+	const double wall_time,
+	const double cpu_time)
+{
+	stress_scaling_step_t *s;
+
+	if (!scaling_results || (index >= scaling_stressors) || (step >= scaling_n))
+		return;
+	s = &scaling_results[(index * scaling_n) + step];
+	s->bogo_ops = bogo_ops;
+	s->wall_time = wall_time;
+	s->cpu_time = cpu_time;
+	s->valid = true;
+}
+
+/*
+ *  stress_scaling_dump()
+ *	report throughput, speedup and parallel efficiency of
+ *	each step relative to the first step of each stressor
+ */
+void stress_scaling_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	if (!scaling_results)
+		return;
+
+	pr_yaml(yaml, "scaling:\n");
+
+	for (i = 0, ss = stressors_list; ss && (i < scaling_stressors); ss = ss->next, i++) {
+		const stress_scaling_step_t *steps = &scaling_results[i * scaling_n];
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		double base_rate = 0.0, peak_rate = 0.0;
+		int32_t base_instances = 0, peak_instances = 0, knee = 0;
+		size_t j;
+
+		if (!steps[0].valid)
+			continue;
+
+		pr_inf("%-13s %9s %12s %12s %9s %12s\n",
+			"stressor", "instances", "bogo ops/s", "bogo ops/s", "speedup", "parallel");
+		pr_inf("%-13s %9s %12s %12s %9s %12s\n",
+			"", "", "(real time)", "(per inst.)", "", "efficiency (%)");
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      steps:\n");
+
+		for (j = 0; j < scaling_n; j++) {
+			const stress_scaling_step_t *s = &steps[j];
+			const int32_t instances = scaling_steps[j];
+			double rate, speedup, efficiency;
+
+			if (!s->valid)
+				continue;
+
+			rate = (s->wall_time > 0.0) ? (double)s->bogo_ops / s->wall_time : 0.0;
+			if (!base_instances) {
+				base_rate = rate;
+				base_instances = instances;
+			}
+			speedup = (base_rate > 0.0) ? rate / base_rate : 0.0;
+			/* Efficiency relative to linear scaling from the first step */
+			efficiency = 100.0 * speedup * (double)base_instances / (double)instances;
+			if (rate > peak_rate) {
+				peak_rate = rate;
+				peak_instances = instances;
+			}
+			if (!knee && (efficiency < SCALING_KNEE))
+				knee = instances;
+
+			pr_inf("%-13s %9" PRId32 " %12.2f %12.2f %9.2f %12.2f\n",
+				munged, instances, rate, rate / (double)instances,
+				speedup, efficiency);
+
+			pr_yaml(yaml, "        - instances: %" PRId32 "\n", instances);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", s->bogo_ops);
+			pr_yaml(yaml, "          wall-clock-time: %f\n", s->wall_time);
+			pr_yaml(yaml, "          usr-sys-time: %f\n", s->cpu_time);
+			pr_yaml(yaml, "          bogo-ops-per-second-real-time: %f\n", rate);
+			pr_yaml(yaml, "          speedup: %f\n", speedup);
+			pr_yaml(yaml, "          efficiency-percent: %f\n", efficiency);
+		}
+		if (knee)
+			pr_inf("%-13s peak throughput at %" PRId32 " instance%s, parallel "
+				"efficiency drops below %.0f%% at %" PRId32 " instances\n",
+				munged, peak_instances, peak_instances == 1 ? "" : "s",
+				SCALING_KNEE, knee);
+		else
+			pr_inf("%-13s peak throughput at %" PRId32 " instance%s\n",
+				munged, peak_instances, peak_instances == 1 ? "" : "s");
+		pr_yaml(yaml, "      peak-instances: %" PRId32 "\n", peak_instances);
+		if (knee)
+			pr_yaml(yaml, "      knee-instances: %" PRId32 "\n", knee);
+		pr_yaml(yaml, "\n");
+	}
+}
+
+/*
+ *  stress_scaling_free()
+ *	free per stressor per step result buffers
+ */
+void stress_scaling_free(void)
+{
+	free(scaling_results);
+	scaling_results = NULL;
+	scaling_stressors = 0;
+}
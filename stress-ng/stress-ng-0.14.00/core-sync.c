@@ -0,0 +1,115 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-sync.h"
+
+#define SYNC_START_HELD		(0)	/* instances wait at start barrier */
+#define SYNC_START_RELEASED	(1)	/* instances may start */
+
+#define SYNC_STOP_RUNNING	(0)	/* no instance has finished yet */
+#define SYNC_STOP_NOTIFIED	(1)	/* an instance has finished */
+#define SYNC_STOP_CLAIMED	(2)	/* parent is stopping the rest */
+
+/* Max time parent waits for late instances to reach the barrier */
+#define SYNC_START_MAX_WAIT	(5.0)
+
+/*
+ *  stress_sync_init()
+ *	reset start barrier and stop state, called by
+ *	the parent before forking the stressors
+ */
+void stress_sync_init(void)
+{
+	g_shared->sync.start = SYNC_START_HELD;
+	g_shared->sync.waiting = 0;
+	g_shared->sync.stop = SYNC_STOP_RUNNING;
+}
+
+/*
+ *  stress_sync_start_wait()
+ *	block a stressor instance at the start barrier
+ *	until the parent releases all instances at once
+ */
+void stress_sync_start_wait(void)
+{
+	volatile uint32_t *start = &g_shared->sync.start;
+
+	(void)__sync_fetch_and_add(&g_shared->sync.waiting, 1);
+	while ((*start == SYNC_START_HELD) && keep_stressing_flag()) {
+		/*
+		 *  Timeout so a lost wake up or a terminated
+		 *  parent does not leave the instance stuck
+		 */
+		struct timespec timeout = { 0, 100000000 };
+
+		if ((shim_futex_wait((const void *)start,
+				SYNC_START_HELD, &timeout) < 0) &&
+		    (errno == ENOSYS))
+			(void)shim_usleep(1000);
+	}
+}
+
+/*
+ *  stress_sync_start_release()
+ *	wait for the started instances to reach the barrier
+ *	and release them all together
+ */
+void stress_sync_start_release(const int32_t instances)
+{
+	const double t_start = stress_time_now();
+	volatile uint32_t *waiting = &g_shared->sync.waiting;
+
+	while ((*waiting < (uint32_t)instances) && keep_stressing_flag()) {
+		if (stress_time_now() - t_start > SYNC_START_MAX_WAIT) {
+			pr_dbg("sync-start: only %" PRIu32 " of %" PRId32
+				" instances ready, starting anyway\n",
+				*waiting, instances);
+			break;
+		}
+		(void)shim_usleep(1000);
+	}
+	g_shared->sync.start = SYNC_START_RELEASED;
+	shim_mb();
+	(void)shim_futex_wake((const void *)&g_shared->sync.start, INT_MAX);
+
+	pr_dbg("sync-start: released %" PRIu32 " instances after %.3fs\n",
+		*waiting, stress_time_now() - t_start);
+}
+
+/*
+ *  stress_sync_stop_notify()
+ *	called when an instance finishes, returns true
+ *	if it is the first instance to finish
+ */
+bool stress_sync_stop_notify(void)
+{
+	return __sync_bool_compare_and_swap(&g_shared->sync.stop,
+		SYNC_STOP_RUNNING, SYNC_STOP_NOTIFIED);
+}
+
+/*
+ *  stress_sync_stop_claim()
+ *	called by the parent, returns true once only
+ *	after an instance has finished
+ */
+bool stress_sync_stop_claim(void)
+{
+	return __sync_bool_compare_and_swap(&g_shared->sync.stop,
+		SYNC_STOP_NOTIFIED, SYNC_STOP_CLAIMED);
+}
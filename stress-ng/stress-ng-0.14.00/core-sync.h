@@ -0,0 +1,29 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SYNC_H
+#define CORE_SYNC_H
+
+/* Synchronized start and stop of stressor instances */
+extern void stress_sync_init(void);
+extern void stress_sync_start_wait(void);
+extern void stress_sync_start_release(const int32_t instances);
+extern bool stress_sync_stop_notify(void);
+extern bool stress_sync_stop_claim(void);
+
+#endif
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-time.h"
 
 #define SECONDS_IN_MINUTE	(60.0)
 #define SECONDS_IN_HOUR		(60.0 * SECONDS_IN_MINUTE)
@@ -25,6 +26,11 @@
 #define SECONDS_IN_YEAR		(365.2425 * SECONDS_IN_DAY)
 				/* Approx, for Gregorian calendar */
 
+#define CLOCK_CALIBRATE_NS	(20000000ULL)	/* cycle counter calibration time */
+#define CLOCK_CALIBRATE_READS	(8)		/* reads to find a tight bracket */
+
+stress_clock_t g_clock;
+
 /*
  *  stress_timeval_to_double()
  *      convert timeval to seconds as a double
@@ -36,17 +42,84 @@ double stress_timeval_to_double(const struct timeval *tv)
 
 /*
  *  stress_time_now()
- *	time in seconds as a double
+ *	monotonic time in seconds as a double
  */
 double stress_time_now(void)
 {
-	struct timeval now;
+	return (double)stress_time_now_ns() * ONE_BILLIONTH;
+}
 
-	if (gettimeofday(&now, NULL) < 0)
-		return -1.0;
+#if defined(HAVE_STRESS_CLOCK_CYCLES) &&	\
+    defined(__linux__)
+/*
+ *  stress_time_sample()
+ *	read the cycle counter and CLOCK_MONOTONIC together, the
+ *	tightest of a few clock reads around the counter read is used
+ */
+static void stress_time_sample(uint64_t *cycles, uint64_t *ns)
+{
+	uint64_t best = ~0ULL;
+	int i;
+
+	for (i = 0; i < CLOCK_CALIBRATE_READS; i++) {
+		const uint64_t t1 = stress_time_monotonic_ns();
+		const uint64_t c = stress_clock_cycles();
+		const uint64_t t2 = stress_time_monotonic_ns();
+
+		if (t2 - t1 < best) {
+			best = t2 - t1;
+			*cycles = c;
+			*ns = t1 + ((t2 - t1) >> 1);
+		}
+	}
+}
 
-	return stress_timeval_to_double(&now);
+/*
+ *  stress_time_init()
+ *	calibrate the cycle counter against CLOCK_MONOTONIC, the
+ *	counter is only used if the kernel uses it as its clocksource
+ */
+void stress_time_init(void)
+{
+	char buf[64], *ptr;
+	uint64_t c0 = 0, c1 = 0, t0 = 0, t1 = 0;
+	double ns_per_cycle;
+
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read("/sys/devices/system/clocksource/clocksource0/current_clocksource",
+			buf, sizeof(buf) - 1) < 0)
+		return;
+	for (ptr = buf; *ptr && !isspace((int)*ptr); ptr++)
+		;
+	*ptr = '\0';
+	if (strcmp(buf, STRESS_CLOCK_SOURCE)) {
+		pr_dbg("clock: using CLOCK_MONOTONIC, %s clocksource is not %s\n",
+			buf, STRESS_CLOCK_SOURCE);
+		return;
+	}
+
+	stress_time_sample(&c0, &t0);
+	(void)shim_nanosleep_uint64(CLOCK_CALIBRATE_NS);
+	stress_time_sample(&c1, &t1);
+	if ((c1 <= c0) || (t1 <= t0))
+		return;
+
+	/* Sanity check, 10 MHz .. 100 GHz */
+	ns_per_cycle = (double)(t1 - t0) / (double)(c1 - c0);
+	if ((ns_per_cycle < 0.01) || (ns_per_cycle > 100.0))
+		return;
+
+	g_clock.ns_per_cycle = ns_per_cycle;
+	g_clock.cycles_base = c1;
+	g_clock.ns_base = t1;
+	g_clock.fast = true;
+	pr_dbg("clock: using %s, %.3f MHz\n", STRESS_CLOCK_SOURCE, 1000.0 / ns_per_cycle);
+}
+#else
+void stress_time_init(void)
+{
 }
+#endif
 
 /*
  *  stress_format_time()
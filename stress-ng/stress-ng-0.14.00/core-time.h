@@ -0,0 +1,125 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_TIME_H
+#define CORE_TIME_H
+
+#include "core-arch.h"
+
+/*
+ *  Clock used by stress_time_now_ns(), a calibrated cycle counter
+ *  when the kernel trusts it as its clocksource (so it runs at a
+ *  constant rate and is synchronized across CPUs), otherwise
+ *  CLOCK_MONOTONIC
+ */
+typedef struct {
+	double ns_per_cycle;		/* calibrated counter period */
+	uint64_t cycles_base;		/* counter at calibration */
+	uint64_t ns_base;		/* CLOCK_MONOTONIC at calibration */
+	bool fast;			/* true if counter is used */
+} stress_clock_t;
+
+extern stress_clock_t g_clock;
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(__x86_64__) &&		\
+    !defined(__PCC__) &&		\
+    !defined(__TINYC__)
+#define HAVE_STRESS_CLOCK_CYCLES
+#define STRESS_CLOCK_SOURCE	"tsc"
+
+/*
+ *  stress_clock_cycles()
+ *	read the time stamp counter
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_cycles(void)
+{
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__)
+#define HAVE_STRESS_CLOCK_CYCLES
+#define STRESS_CLOCK_SOURCE	"arch_sys_counter"
+
+/*
+ *  stress_clock_cycles()
+ *	read the virtual counter
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_cycles(void)
+{
+	uint64_t val;
+
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (val));
+	return val;
+}
+#endif
+
+/*
+ *  stress_time_monotonic_ns()
+ *	CLOCK_MONOTONIC time in nanoseconds, this is a vDSO
+ *	call on most Linux systems
+ */
+static inline uint64_t ALWAYS_INLINE stress_time_monotonic_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	{
+		struct timeval tv;
+
+		(void)gettimeofday(&tv, NULL);
+		return ((uint64_t)tv.tv_sec * STRESS_NANOSECOND) + ((uint64_t)tv.tv_usec * 1000);
+	}
+}
+
+/*
+ *  stress_time_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t ALWAYS_INLINE stress_time_now_ns(void)
+{
+#if defined(HAVE_STRESS_CLOCK_CYCLES)
+	if (LIKELY(g_clock.fast)) {
+		const uint64_t cycles = stress_clock_cycles() - g_clock.cycles_base;
+
+		return g_clock.ns_base + (uint64_t)((double)cycles * g_clock.ns_per_cycle);
+	}
+#endif
+	return stress_time_monotonic_ns();
+}
+
+/*
+ *  stress_cycles_to_ns()
+ *	convert a cycle counter delta to nanoseconds,
+ *	0 if there is no usable cycle counter
+ */
+static inline uint64_t ALWAYS_INLINE stress_cycles_to_ns(const uint64_t cycles)
+{
+	return g_clock.fast ? (uint64_t)((double)cycles * g_clock.ns_per_cycle) : 0;
+}
+
+extern void stress_time_init(void);
+
+#endif
@@ -40,6 +40,7 @@
 static int32_t vmstat_delay = 0;
 static int32_t thermalstat_delay = 0;
 static int32_t iostat_delay = 0;
+static int32_t psistat_delay = 0;
 
 #if defined(__FreeBSD__)
 static int freebsd_getsysctl(const char *name, void *ptr, size_t size)
@@ -101,6 +102,11 @@ int stress_set_iostat(const char *const opt)
 	return stress_set_generic_stat(opt, "iostat", &iostat_delay);
 }
 
+int stress_set_psistat(const char *const opt)
+{
+	return stress_set_generic_stat(opt, "psistat", &psistat_delay);
+}
+
 /*
  *  stress_find_mount_dev()
  *	find the path of the device that the file is located on
@@ -660,6 +666,328 @@ static double stress_get_cpu_ghz_average(void)
 }
 #endif
 
+/* cgroup v2 statistics of the stress-ng cgroup */
+typedef struct {
+	uint64_t usage_usec;		/* cpu.stat CPU time */
+	uint64_t user_usec;		/* cpu.stat user time */
+	uint64_t system_usec;		/* cpu.stat system time */
+	uint64_t anon;			/* memory.stat anonymous bytes */
+	uint64_t file;			/* memory.stat page cache bytes */
+	uint64_t rbytes;		/* io.stat bytes read */
+	uint64_t wbytes;		/* io.stat bytes written */
+	bool cpu_valid;			/* cpu.stat was read */
+	bool memory_valid;		/* memory.stat was read */
+	bool io_valid;			/* io.stat was read */
+} stress_cgroup_stat_t;
+
+#if defined(__linux__)
+static const char * const psi_files[] = {
+	"/proc/pressure/cpu",
+	"/proc/pressure/memory",
+	"/proc/pressure/io",
+};
+
+/*
+ *  stress_read_psi()
+ *	read the some and full stall totals of the cpu,
+ *	memory and io pressure stall information
+ */
+static void stress_read_psi(stress_psi_t *psi)
+{
+	static const stress_psi_index_t some[] = {
+		STRESS_PSI_CPU_SOME, STRESS_PSI_MEM_SOME, STRESS_PSI_IO_SOME,
+	};
+	static const stress_psi_index_t full[] = {
+		STRESS_PSI_MAX, STRESS_PSI_MEM_FULL, STRESS_PSI_IO_FULL,
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(psi_files); i++) {
+		FILE *fp;
+		char buffer[256];
+
+		fp = fopen(psi_files[i], "r");
+		if (!fp)
+			continue;
+		while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+			const char *ptr = strstr(buffer, "total=");
+			uint64_t total;
+
+			if (!ptr || (sscanf(ptr + 6, "%" SCNu64, &total) != 1))
+				continue;
+			/* Only cgroup cpu pressure has a meaningful full line */
+			if (!strncmp(buffer, "some", 4)) {
+				psi->total_us[some[i]] = total;
+				psi->valid = true;
+			} else if (!strncmp(buffer, "full", 4) && (full[i] < STRESS_PSI_MAX)) {
+				psi->total_us[full[i]] = total;
+			}
+		}
+		(void)fclose(fp);
+	}
+}
+
+/*
+ *  stress_cgroup_path()
+ *	find the cgroup v2 directory of the current process,
+ *	returns NULL if there is no cgroup v2 hierarchy
+ */
+static const char *stress_cgroup_path(void)
+{
+	static char cgroup_path[PATH_MAX];
+	static bool checked = false;
+	char buffer[PATH_MAX / 2], mnt[PATH_MAX / 2];
+	struct mntent *mntent;
+	FILE *fp;
+	bool found = false;
+
+	if (checked)
+		return *cgroup_path ? cgroup_path : NULL;
+	checked = true;
+
+	/* cgroup v2 is the 0:: entry */
+	fp = fopen("/proc/self/cgroup", "r");
+	if (!fp)
+		return NULL;
+	while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+		if (!strncmp(buffer, "0::", 3)) {
+			char *nl = strchr(buffer, '\n');
+
+			if (nl)
+				*nl = '\0';
+			found = true;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	if (!found)
+		return NULL;
+
+	found = false;
+	fp = setmntent("/proc/self/mounts", "r");
+	if (!fp)
+		return NULL;
+	while ((mntent = getmntent(fp)) != NULL) {
+		if (!strcmp(mntent->mnt_type, "cgroup2")) {
+			(void)shim_strlcpy(mnt, mntent->mnt_dir, sizeof(mnt));
+			found = true;
+			break;
+		}
+	}
+	(void)endmntent(fp);
+	if (!found)
+		return NULL;
+
+	(void)snprintf(cgroup_path, sizeof(cgroup_path), "%s%s", mnt,
+		strcmp(buffer + 3, "/") ? buffer + 3 : "");
+	return cgroup_path;
+}
+
+/*
+ *  stress_read_cgroup_file()
+ *	read the "key value" or "dev key=value ..." fields of a
+ *	cgroup stat file, values of duplicate keys are summed
+ */
+static bool stress_read_cgroup_file(
+	const char *path,
+	const char *file,
+	const char * const keys[],
+	uint64_t * const values[],
+	const size_t n)
+{
+	FILE *fp;
+	char filename[PATH_MAX], buffer[4096];
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s", path, file);
+	fp = fopen(filename, "r");
+	if (!fp)
+		return false;
+
+	while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+		char *token, *saveptr = NULL;
+
+		for (token = strtok_r(buffer, " \n", &saveptr); token;
+		     token = strtok_r(NULL, " \n", &saveptr)) {
+			char *value = strchr(token, '=');
+			size_t i;
+
+			if (value) {
+				*value++ = '\0';
+			} else {
+				value = strtok_r(NULL, " \n", &saveptr);
+				if (!value)
+					break;
+			}
+			for (i = 0; i < n; i++) {
+				if (!strcmp(token, keys[i]))
+					*values[i] += (uint64_t)strtoull(value, NULL, 10);
+			}
+		}
+	}
+	(void)fclose(fp);
+
+	return true;
+}
+
+/*
+ *  stress_read_cgroup()
+ *	read the cgroup v2 cpu, memory and io statistics
+ */
+static void stress_read_cgroup(stress_cgroup_stat_t *cg, uint64_t *throttled_usec)
+{
+	static const char * const cpu_keys[] = {
+		"usage_usec", "user_usec", "system_usec", "throttled_usec",
+	};
+	static const char * const memory_keys[] = {
+		"anon", "file",
+	};
+	static const char * const io_keys[] = {
+		"rbytes", "wbytes",
+	};
+	uint64_t * const cpu_values[] = {
+		&cg->usage_usec, &cg->user_usec, &cg->system_usec, throttled_usec,
+	};
+	uint64_t * const memory_values[] = {
+		&cg->anon, &cg->file,
+	};
+	uint64_t * const io_values[] = {
+		&cg->rbytes, &cg->wbytes,
+	};
+	const char *path = stress_cgroup_path();
+
+	(void)memset(cg, 0, sizeof(*cg));
+	*throttled_usec = 0;
+	if (!path)
+		return;
+
+	cg->cpu_valid = stress_read_cgroup_file(path, "cpu.stat",
+		cpu_keys, cpu_values, SIZEOF_ARRAY(cpu_keys));
+	cg->memory_valid = stress_read_cgroup_file(path, "memory.stat",
+		memory_keys, memory_values, SIZEOF_ARRAY(memory_keys));
+	cg->io_valid = stress_read_cgroup_file(path, "io.stat",
+		io_keys, io_values, SIZEOF_ARRAY(io_keys));
+}
+#else
+static void stress_read_psi(stress_psi_t *psi)
+{
+	(void)psi;
+}
+
+static void stress_read_cgroup(stress_cgroup_stat_t *cg, uint64_t *throttled_usec)
+{
+	(void)memset(cg, 0, sizeof(*cg));
+	*throttled_usec = 0;
+}
+#endif
+
+/*
+ *  stress_get_psi()
+ *	snapshot the pressure stall and cgroup throttling totals
+ */
+static void stress_get_psi(stress_psi_t *psi, stress_cgroup_stat_t *cg)
+{
+	(void)memset(psi, 0, sizeof(*psi));
+	stress_read_psi(psi);
+	stress_read_cgroup(cg, &psi->total_us[STRESS_PSI_CG_THROTTLED]);
+	psi->time = stress_time_now();
+}
+
+/*
+ *  stress_psi_start()
+ *	snapshot the pressure stall totals at the start
+ *	of a stressor instance
+ */
+void stress_psi_start(stress_psi_t *psi)
+{
+	stress_cgroup_stat_t cg;
+
+	if (!psistat_delay) {
+		(void)memset(psi, 0, sizeof(*psi));
+		return;
+	}
+	stress_get_psi(psi, &cg);
+}
+
+/*
+ *  stress_psi_stop()
+ *	turn the start snapshot into the pressure stall
+ *	times over the run of a stressor instance
+ */
+void stress_psi_stop(stress_psi_t *psi)
+{
+	stress_psi_t now;
+	stress_cgroup_stat_t cg;
+	size_t i;
+
+	if (!psistat_delay || !psi->valid)
+		return;
+	stress_get_psi(&now, &cg);
+	for (i = 0; i < STRESS_PSI_MAX; i++) {
+		psi->total_us[i] = (now.total_us[i] > psi->total_us[i]) ?
+			now.total_us[i] - psi->total_us[i] : 0;
+	}
+	psi->time = now.time - psi->time;
+}
+
+/*
+ *  stress_psistat_dump()
+ *	dump the percentage of run time stalled on the cpu, memory
+ *	and io while each stressor was running
+ */
+void stress_psistat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	static const char * const psi_names[] = {
+		"cpu-some", "memory-some", "memory-full",
+		"io-some", "io-full", "cgroup-throttled",
+	};
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!psistat_delay)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		double total_us[STRESS_PSI_MAX], pc[STRESS_PSI_MAX], time = 0.0;
+		int32_t j;
+		size_t i;
+
+		if (!ss->stats)
+			continue;
+		(void)memset(total_us, 0, sizeof(total_us));
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_psi_t *psi = &ss->stats[j]->psi;
+
+			if (!psi->valid)
+				continue;
+			for (i = 0; i < STRESS_PSI_MAX; i++)
+				total_us[i] += (double)psi->total_us[i];
+			time += psi->time;
+		}
+		if (time <= 0.0)
+			continue;
+		for (i = 0; i < STRESS_PSI_MAX; i++)
+			pc[i] = 100.0 * total_us[i] / (time * (double)STRESS_MICROSECOND);
+
+		if (!header) {
+			pr_inf("pressure stall information, %% of run time stalled:\n");
+			pr_inf("%-13s %7s %7s %7s %7s %7s %7s\n", "stressor",
+				"CPU", "Mem", "MemFull", "IO", "IOFull", "CgThrtl");
+			pr_yaml(yaml, "pressure-stall:\n");
+			header = true;
+		}
+		pr_inf("%-13s %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f\n", munged,
+			pc[STRESS_PSI_CPU_SOME], pc[STRESS_PSI_MEM_SOME],
+			pc[STRESS_PSI_MEM_FULL], pc[STRESS_PSI_IO_SOME],
+			pc[STRESS_PSI_IO_FULL], pc[STRESS_PSI_CG_THROTTLED]);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		for (i = 0; i < STRESS_PSI_MAX; i++)
+			pr_yaml(yaml, "      %s-percent: %f\n", psi_names[i], pc[i]);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+}
+
 /*
  *  stress_vmstat_start()
  *	start vmstat statistics (1 per second)
@@ -669,7 +997,9 @@ void stress_vmstat_start(void)
 	stress_vmstat_t vmstat;
 	size_t tz_num = 0;
 	stress_tz_info_t *tz_info, *tz_info_list;
-	int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep;
+	int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep, psistat_sleep;
+	stress_psi_t psi;
+	stress_cgroup_stat_t cg;
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(__linux__)
 	char iostat_name[PATH_MAX];
@@ -678,13 +1008,15 @@ void stress_vmstat_start(void)
 
 	if ((vmstat_delay == 0) &&
 	    (thermalstat_delay == 0) &&
-	    (iostat_delay == 0))
+	    (iostat_delay == 0) &&
+	    (psistat_delay == 0))
 		return;
 
 	tz_info_list = NULL;
 	vmstat_sleep = vmstat_delay;
 	thermalstat_sleep = thermalstat_delay;
 	iostat_sleep = iostat_delay;
+	psistat_sleep = psistat_delay;
 
 	vmstat_pid = fork();
 	if ((vmstat_pid < 0) || (vmstat_pid > 0))
@@ -708,6 +1040,9 @@ void stress_vmstat_start(void)
 		stress_get_iostat(iostat_name, &iostat);
 #endif
 
+	if (psistat_delay)
+		stress_get_psi(&psi, &cg);
+
 	while (keep_stressing_flag()) {
 		int32_t sleep_delay = INT_MAX;
 		long clk_tick;
@@ -721,6 +1056,8 @@ void stress_vmstat_start(void)
 		if (iostat_delay > 0)
 			sleep_delay = STRESS_MINIMUM(iostat_delay, sleep_delay);
 #endif
+		if (psistat_delay > 0)
+			sleep_delay = STRESS_MINIMUM(psistat_delay, sleep_delay);
 
 		(void)sleep((unsigned int)sleep_delay);
 
@@ -730,6 +1067,7 @@ void stress_vmstat_start(void)
 		vmstat_sleep -= sleep_delay;
 		thermalstat_sleep -= sleep_delay;
 		iostat_sleep -= sleep_delay;
+		psistat_sleep -= sleep_delay;
 
 		if ((vmstat_delay > 0) && (vmstat_sleep <= 0))
 			vmstat_sleep = vmstat_delay;
@@ -737,6 +1075,8 @@ void stress_vmstat_start(void)
 			thermalstat_sleep = thermalstat_delay;
 		if ((iostat_delay > 0) && (iostat_sleep <= 0))
 			iostat_sleep = iostat_delay;
+		if ((psistat_delay > 0) && (psistat_sleep <= 0))
+			psistat_sleep = psistat_delay;
 
 		if (vmstat_sleep == vmstat_delay) {
 			double clk_tick_vmstat_delay = (double)clk_tick * (double)vmstat_delay;
@@ -842,6 +1182,54 @@ void stress_vmstat_start(void)
 				(double)iostat.discard_io * clk_scale);
 		}
 #endif
+
+		if (psistat_delay == psistat_sleep) {
+			stress_psi_t psi_prev = psi;
+			const stress_cgroup_stat_t cg_prev = cg;
+			double secs, pc_scale, kb_scale, pc[STRESS_PSI_MAX];
+			char cg_cpu[24], cg_mem[24], cg_io[24];
+			static uint32_t psistat_count = 0;
+			size_t i;
+
+			if ((psistat_count++ % 25) == 0)
+				pr_inf("psi:    CPU    Mem MemFul     IO  IOFul "
+					"CgUsr%% CgSys%% CgThr%%  Anon MB  File MB   Rd K/s   Wr K/s\n");
+
+			stress_get_psi(&psi, &cg);
+			secs = psi.time - psi_prev.time;
+			pc_scale = (secs > 0.0) ? 100.0 / (secs * (double)STRESS_MICROSECOND) : 0.0;
+			kb_scale = (secs > 0.0) ? 1.0 / (secs * (double)KB) : 0.0;
+			for (i = 0; i < STRESS_PSI_MAX; i++)
+				pc[i] = (double)(psi.total_us[i] - psi_prev.total_us[i]) * pc_scale;
+
+			if (cg.cpu_valid && cg_prev.cpu_valid)
+				(void)snprintf(cg_cpu, sizeof(cg_cpu), "%6.1f %6.1f %6.1f",
+					(double)(cg.user_usec - cg_prev.user_usec) * pc_scale,
+					(double)(cg.system_usec - cg_prev.system_usec) * pc_scale,
+					pc[STRESS_PSI_CG_THROTTLED]);
+			else
+				(void)snprintf(cg_cpu, sizeof(cg_cpu), "%6s %6s %6s", "n/a", "n/a", "n/a");
+			if (cg.memory_valid)
+				(void)snprintf(cg_mem, sizeof(cg_mem), "%8.1f %8.1f",
+					(double)cg.anon / (double)MB, (double)cg.file / (double)MB);
+			else
+				(void)snprintf(cg_mem, sizeof(cg_mem), "%8s %8s", "n/a", "n/a");
+			if (cg.io_valid && cg_prev.io_valid)
+				(void)snprintf(cg_io, sizeof(cg_io), "%8.0f %8.0f",
+					(double)(cg.rbytes - cg_prev.rbytes) * kb_scale,
+					(double)(cg.wbytes - cg_prev.wbytes) * kb_scale);
+			else
+				(void)snprintf(cg_io, sizeof(cg_io), "%8s %8s", "n/a", "n/a");
+
+			if (psi.valid)
+				pr_inf("psi: %6.2f %6.2f %6.2f %6.2f %6.2f %s %s %s\n",
+					pc[STRESS_PSI_CPU_SOME], pc[STRESS_PSI_MEM_SOME],
+					pc[STRESS_PSI_MEM_FULL], pc[STRESS_PSI_IO_SOME],
+					pc[STRESS_PSI_IO_FULL], cg_cpu, cg_mem, cg_io);
+			else
+				pr_inf("psi: %6s %6s %6s %6s %6s %s %s %s\n",
+					"n/a", "n/a", "n/a", "n/a", "n/a", cg_cpu, cg_mem, cg_io);
+		}
 	}
 }
 
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-perf.h"
+#include "core-warmup.h"
+
+static uint64_t warmup = 0;			/* warm-up in seconds */
+
+/*
+ *  Per instance warm-up state, with --instance-model threads
+ *  each thread has its own state. A stressor that does its
+ *  work in a forked child (e.g. the oomable stressors) inherits
+ *  it, so the snapshot is taken by the process running the work
+ *  loop and covers its CPU time and page faults
+ */
+static THREAD_LOCAL stress_stats_t *warmup_stats;
+static THREAD_LOCAL bool warmup_threaded;
+static THREAD_LOCAL double warmup_deadline;
+
+/*
+ *  stress_set_warmup()
+ *	set warm-up period in seconds
+ */
+int stress_set_warmup(const char *opt)
+{
+	warmup = stress_get_uint64_time(opt);
+	return 0;
+}
+
+/*
+ *  stress_get_warmup()
+ *	get warm-up period in seconds, 0 if disabled
+ */
+uint64_t stress_get_warmup(void)
+{
+	return warmup;
+}
+
+/*
+ *  stress_warmup_check()
+ *	called from the bogo-op counter updates until the warm-up
+ *	is over, at the end of the warm-up snapshot the bogo-op
+ *	counter, wall clock, CPU times and resource usage and
+ *	restart the perf counters and samples so the metrics only
+ *	cover the remainder of the run
+ */
+void stress_warmup_check(void)
+{
+	stress_stats_t *stats = warmup_stats;
+	double now;
+
+	if (!stats || stats->warmup.done)
+		return;
+	now = stress_time_now();
+	if (now < warmup_deadline)
+		return;
+
+	stats->warmup.counter = stats->counter;
+	stats->warmup.time = now;
+	if (warmup_threaded)
+		stress_get_thread_times(&stats->warmup.tms);
+	else if (times(&stats->warmup.tms) == (clock_t)-1)
+		return;
+	stress_get_rusage(&stats->warmup.rusage, warmup_threaded);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		(void)stress_perf_reset(&stats->sp);
+	stress_perf_sample_reset();
+#endif
+	stats->warmup.done = true;
+}
+
+/*
+ *  stress_warmup_start()
+ *	set the end of the warm-up period of the calling instance,
+ *	returns the warm-up snapshot to pass to the stressor or
+ *	NULL if there is no warm-up
+ */
+stress_warmup_t *stress_warmup_start(
+	const char *name,
+	stress_stats_t *stats,
+	const bool threaded)
+{
+	if (!warmup)
+		return NULL;
+	if (g_opt_timeout && (warmup >= g_opt_timeout)) {
+		if (stats == g_stressor_current->stats[0])
+			pr_inf("%s: warm-up of %" PRIu64 " seconds is not less than "
+				"the timeout, metrics include the warm-up\n",
+				name, warmup);
+		return NULL;
+	}
+
+	warmup_stats = stats;
+	warmup_threaded = threaded;
+	warmup_deadline = stress_time_now() + (double)warmup;
+
+	return &stats->warmup;
+}
+
+/*
+ *  stress_warmup_counter_shift()
+ *	stressors that count in finer grained units and scale
+ *	the bogo-op counter down by shift bits when they finish
+ *	need to scale the warm-up counter snapshot to match
+ */
+void stress_warmup_counter_shift(const unsigned int shift)
+{
+	stress_stats_t *stats = warmup_stats;
+
+	if (!stats)
+		return;
+	/* Stop a late warm-up check snapshotting the scaled counter */
+	warmup_stats = NULL;
+	if (stats->warmup.done)
+		stats->warmup.counter >>= shift;
+}
+
+/*
+ *  stress_warmup_stop()
+ *	end the warm-up tracking of the calling instance
+ */
+void stress_warmup_stop(void)
+{
+	warmup_stats = NULL;
+}
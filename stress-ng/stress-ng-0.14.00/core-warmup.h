@@ -0,0 +1,30 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_WARMUP_H
+#define CORE_WARMUP_H
+
+/* Warm-up period excluded from the metrics */
+extern int stress_set_warmup(const char *opt);
+extern uint64_t stress_get_warmup(void);
+extern stress_warmup_t *stress_warmup_start(const char *name,
+	stress_stats_t *stats, const bool threaded);
+extern void stress_warmup_counter_shift(const unsigned int shift);
+extern void stress_warmup_stop(void);
+
+#endif
@@ -353,6 +353,7 @@ L0x000:
 stressor_info_t stress_branch_info = {
 	.stressor = stress_branch,
 	.class = CLASS_CPU,
+	.thread_safe = true,
 	.help = help
 };
 #else
@@ -150,5 +150,6 @@ stressor_info_t stress_bsearch_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
+	.thread_safe = true,
 	.help = help
 };
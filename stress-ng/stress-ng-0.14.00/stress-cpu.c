@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-cpu.h"
+#include "core-load-profile.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 
@@ -3197,6 +3198,8 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 	stress_cpu_func func;
 	int32_t cpu_load = 100;
 	int32_t cpu_load_slice = -64;
+	const bool load_profile = stress_load_profile_enabled();
+	double load, t_start;
 
 	(void)stress_get_setting("cpu-load", &cpu_load);
 	(void)stress_get_setting("cpu-load-slice", &cpu_load_slice);
@@ -3210,7 +3213,7 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 	 * It is unlikely, but somebody may request to do a zero
 	 * load stress test(!)
 	 */
-	if (cpu_load == 0) {
+	if ((cpu_load == 0) && !load_profile) {
 		(void)sleep((unsigned int)g_opt_timeout);
 		return EXIT_SUCCESS;
 	}
@@ -3220,7 +3223,7 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 	/*
 	 * Normal use case, 100% load, simple spinning on CPU
 	 */
-	if (cpu_load == 100) {
+	if ((cpu_load == 100) && !load_profile) {
 		do {
 			(void)func(args->name);
 			inc_counter(args);
@@ -3234,10 +3237,24 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 	 * enough for most purposes.
 	 */
 	bias = 0.0;
+	load = (double)cpu_load;
+	t_start = stress_time_now();
 	do {
 		double delay, t1, t2;
 		struct timeval tv;
 
+		/*
+		 *  A --load-profile overrides --cpu-load, the
+		 *  target load is re-evaluated on each time slice
+		 */
+		if (load_profile) {
+			load = stress_load_profile(t_start);
+			if (load < 1.0) {
+				(void)shim_usleep(100000);
+				continue;
+			}
+		}
+
 		t1 = stress_per_cpu_time();
 		if (cpu_load_slice < 0) {
 			/* < 0 specifies number of iterations to do per slice */
@@ -3275,7 +3292,7 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 		}
 
 		/* Must not calculate this with zero % load */
-		delay = (((100 - cpu_load) * (t2 - t1)) / (double)cpu_load);
+		delay = (((100.0 - load) * (t2 - t1)) / load);
 		delay -= bias;
 
 		/* We may have clock warping so don't sleep for -ve delays */
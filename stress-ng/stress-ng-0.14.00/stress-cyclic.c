@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 
 #define DEFAULT_DELAY_NS	(100000)
 #define MAX_SAMPLES		(10000)
@@ -121,11 +122,29 @@ static int stress_set_cyclic_dist(const char *opt)
 	return stress_set_setting("cyclic-dist", TYPE_ID_UINT64, &cyclic_dist);
 }
 
+/*
+ *  stress_cyclic_record()
+ *	record a latency sample, also add it to the
+ *	stressor latency histogram
+ */
+static inline void stress_cyclic_record(
+	const stress_args_t *args,
+	stress_rt_stats_t *rt_stats,
+	const int64_t delta_ns)
+{
+	if (rt_stats->index < MAX_SAMPLES)
+		rt_stats->latencies[rt_stats->index++] = delta_ns;
+
+	rt_stats->ns += (double)delta_ns;
+	stress_latency_record_ns(args, (delta_ns > 0) ? (uint64_t)delta_ns : 0);
+}
+
 #if (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP)) ||	\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
     (defined(HAVE_CLOCK_GETTIME))
 static void stress_cyclic_stats(
+	const stress_args_t *args,
 	stress_rt_stats_t *rt_stats,
 	const uint64_t cyclic_sleep,
 	const struct timespec *t1,
@@ -137,10 +156,7 @@ static void stress_cyclic_stats(
 		   (t2->tv_nsec - t1->tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < MAX_SAMPLES)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(args, rt_stats, delta_ns);
 }
 #else
 	UNEXPECTED
@@ -160,15 +176,13 @@ static int stress_cyclic_clock_nanosleep(
 	struct timespec t1, t2, t, trem;
 	int ret;
 
-	(void)args;
-
 	t.tv_sec = cyclic_sleep / STRESS_NANOSECOND;
 	t.tv_nsec = cyclic_sleep % STRESS_NANOSECOND;
 	(void)clock_gettime(CLOCK_REALTIME, &t1);
 	ret = clock_nanosleep(CLOCK_REALTIME, 0, &t, &trem);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -189,15 +203,13 @@ static int stress_cyclic_posix_nanosleep(
 	struct timespec t1, t2, t, trem;
 	int ret;
 
-	(void)args;
-
 	t.tv_sec = cyclic_sleep / STRESS_NANOSECOND;
 	t.tv_nsec = cyclic_sleep % STRESS_NANOSECOND;
 	(void)clock_gettime(CLOCK_REALTIME, &t1);
 	ret = nanosleep(&t, &trem);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -216,8 +228,6 @@ static int stress_cyclic_poll(
 {
 	struct timespec t1, t2;
 
-	(void)args;
-
 	/* find nearest point to clock roll over */
 	(void)clock_gettime(CLOCK_REALTIME, &t1);
 	for (;;) {
@@ -237,10 +247,7 @@ static int stress_cyclic_poll(
 		if (delta_ns >= (int64_t)cyclic_sleep) {
 			delta_ns -= cyclic_sleep;
 
-			if (rt_stats->index < MAX_SAMPLES)
-				rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-			rt_stats->ns += (double)delta_ns;
+			stress_cyclic_record(args, rt_stats, delta_ns);
 			break;
 		}
 	}
@@ -264,15 +271,13 @@ static int stress_cyclic_pselect(
 	struct timespec t1, t2, t;
 	int ret;
 
-	(void)args;
-
 	t.tv_sec = cyclic_sleep / STRESS_NANOSECOND;
 	t.tv_nsec = cyclic_sleep % STRESS_NANOSECOND;
 	(void)clock_gettime(CLOCK_REALTIME, &t1);
 	ret = pselect(0, NULL, NULL,NULL, &t, NULL);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -336,10 +341,7 @@ static int stress_cyclic_itimer(
 		(itimer_time.tv_nsec - t1.tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < MAX_SAMPLES)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(args, rt_stats, delta_ns);
 
 	(void)timer_delete(timerid);
 
@@ -370,13 +372,11 @@ static int stress_cyclic_usleep(
 	const useconds_t usecs = (useconds_t)cyclic_sleep / 1000;
 	int ret;
 
-	(void)args;
-
 	(void)clock_gettime(CLOCK_REALTIME, &t1);
 	ret = usleep(usecs);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -83,7 +83,9 @@ static void NOINLINE stress_funccall_ ## type(const stress_args_t *args)	\
 {									\
 	register int ii;						\
 	type a, b, c, d, e, f, g, h, i;					\
+	stress_counter_batch_t cb;					\
 									\
+	stress_counter_batch_init(&cb);					\
 	a = rndfunc();							\
 	b = rndfunc();							\
 	c = rndfunc();							\
@@ -132,8 +134,9 @@ static void NOINLINE stress_funccall_ ## type(const stress_args_t *args)	\
 				c, d, e, f, g, h, i));			\
 			type ## _put(res);				\
 			}						\
-		inc_counter(args);					\
-	} while (keep_stressing(args));					\
+		inc_counter_batch(args, &cb);				\
+	} while (keep_stressing_batch(args, &cb));			\
+	flush_counter_batch(args, &cb);					\
 }
 
 #define stress_funccall_1(type)				\
@@ -1111,5 +1114,6 @@ stressor_info_t stress_funccall_info = {
 	.set_default = stress_funccall_set_default,
 	.class = CLASS_CPU,
 	.opt_set_funcs = opt_set_funcs,
+	.thread_safe = true,
 	.help = help
 };
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SYS_UIO_H)
 #include <sys/uio.h>
@@ -594,6 +595,7 @@ static int stress_hdd(const stress_args_t *args)
 	uint64_t i, min_size, size_remainder;
 	int rc = EXIT_FAILURE;
 	ssize_t ret;
+	uint64_t t;
 	char filename[PATH_MAX];
 	size_t opt_index = 0;
 	uint64_t hdd_bytes = DEFAULT_HDD_BYTES;
@@ -809,6 +811,7 @@ rnd_wr_retry:
 					buf[j] = data_value(offset, j, args);
 				}
 
+				t = stress_latency_start(args);
 				ret = stress_hdd_write(fd, buf, offset,
 					hdd_write_size, hdd_flags);
 				if (ret <= 0) {
@@ -824,6 +827,7 @@ rnd_wr_retry:
 					}
 					continue;
 				}
+				stress_latency_end(args, t);
 				inc_counter(args);
 			}
 
@@ -841,6 +845,7 @@ seq_wr_retry:
 
 				for (j = 0; j < hdd_write_size; j++)
 					buf[j] = data_value(i, j, args);
+				t = stress_latency_start(args);
 				ret = stress_hdd_write(fd, buf, (off_t)i,
 					hdd_write_size, hdd_flags);
 				if (ret <= 0) {
@@ -856,6 +861,7 @@ seq_wr_retry:
 					}
 					continue;
 				}
+				stress_latency_end(args, t);
 				inc_counter(args);
 			}
 		}
@@ -881,6 +887,7 @@ seq_rd_retry:
 					(void)close(fd);
 					goto yielded;
 				}
+				t = stress_latency_start(args);
 				ret = stress_hdd_read(fd, buf, (off_t)i,
 					hdd_write_size, hdd_flags);
 				if (ret <= 0) {
@@ -896,6 +903,7 @@ seq_rd_retry:
 					}
 					continue;
 				}
+				stress_latency_end(args, t);
 				if (ret != (ssize_t)hdd_write_size) {
 					misreads++;
 				}
@@ -953,6 +961,7 @@ rnd_rd_retry:
 					(void)close(fd);
 					goto yielded;
 				}
+				t = stress_latency_start(args);
 				ret = stress_hdd_read(fd, buf, (off_t)offset,
 					hdd_write_size, hdd_flags);
 				if (ret <= 0) {
@@ -968,6 +977,7 @@ rnd_rd_retry:
 					}
 					continue;
 				}
+				stress_latency_end(args, t);
 				if (ret != (ssize_t)hdd_write_size)
 					misreads++;
 
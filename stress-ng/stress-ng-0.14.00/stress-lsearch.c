@@ -127,5 +127,6 @@ stressor_info_t stress_lsearch_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
+	.thread_safe = true,
 	.help = help
 };
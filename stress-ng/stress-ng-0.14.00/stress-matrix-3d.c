@@ -782,7 +782,7 @@ static void OPTIMIZE3 stress_matrix_3d_xyz_all(
 	stress_matrix_3d_type_t b[RESTRICT n][n][n],
 	stress_matrix_3d_type_t r[RESTRICT n][n][n])
 {
-	static int i = 1;	/* Skip over stress_matrix_3d_all */
+	static THREAD_LOCAL int i = 1;	/* Skip over stress_matrix_3d_all */
 
 	matrix_3d_methods[i++].func[0](n, a, b, r);
 	if (!matrix_3d_methods[i].name)
@@ -799,7 +799,7 @@ static void OPTIMIZE3 stress_matrix_3d_zyx_all(
 	stress_matrix_3d_type_t b[RESTRICT n][n][n],
 	stress_matrix_3d_type_t r[RESTRICT n][n][n])
 {
-	static int i = 1;	/* Skip over stress_matrix_3d_all */
+	static THREAD_LOCAL int i = 1;	/* Skip over stress_matrix_3d_all */
 
 	matrix_3d_methods[i++].func[1](n, a, b, r);
 	if (!matrix_3d_methods[i].name)
@@ -1021,6 +1021,7 @@ stressor_info_t stress_matrix_3d_info = {
 	.set_default = stress_matrix_3d_set_default,
 	.class = CLASS_CPU | CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
+	.thread_safe = true,
 	.help = help
 };
 #else
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-put.h"
 #include "core-target-clones.h"
+#include "core-mempolicy.h"
 
 #define MIN_MATRIX_SIZE		(16)
 #define MAX_MATRIX_SIZE		(8192)
@@ -798,7 +799,7 @@ static void OPTIMIZE3 stress_matrix_xy_all(
 	stress_matrix_type_t b[RESTRICT n][n],
 	stress_matrix_type_t r[RESTRICT n][n])
 {
-	static int i = 1;	/* Skip over stress_matrix_all */
+	static THREAD_LOCAL int i = 1;	/* Skip over stress_matrix_all */
 
 	matrix_methods[i++].func[0](n, a, b, r);
 	if (!matrix_methods[i].name)
@@ -815,7 +816,7 @@ static void OPTIMIZE3 stress_matrix_yx_all(
 	stress_matrix_type_t b[RESTRICT n][n],
 	stress_matrix_type_t r[RESTRICT n][n])
 {
-	static int i = 1;	/* Skip over stress_matrix_all */
+	static THREAD_LOCAL int i = 1;	/* Skip over stress_matrix_all */
 
 	matrix_methods[i++].func[1](n, a, b, r);
 	if (!matrix_methods[i].name)
@@ -964,6 +965,7 @@ static inline int stress_matrix_exercise(
 	} while (keep_stressing(args));
 
 	ret = EXIT_SUCCESS;
+	stress_mempolicy_numa_pages(args);
 
 	(void)munmap((void *)r, matrix_size);
 tidy_b:
@@ -1035,6 +1037,7 @@ stressor_info_t stress_matrix_info = {
 	.set_default = stress_matrix_set_default,
 	.class = CLASS_CPU | CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
+	.thread_safe = true,
 	.help = help
 };
 
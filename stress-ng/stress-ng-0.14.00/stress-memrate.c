@@ -19,9 +19,11 @@
  */
 #include "stress-ng.h"
 #include "core-cache.h"
+#include "core-load-profile.h"
 #include "core-nt-store.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
+#include "core-mempolicy.h"
 
 #define MR_RD			(0)
 #define MR_WR			(1)
@@ -57,6 +59,8 @@ typedef struct {
 	uint64_t memrate_bytes;
 	uint64_t memrate_rd_mbs;
 	uint64_t memrate_wr_mbs;
+	double t_start;			/* start time for --load-profile */
+	bool load_profile;		/* true if --load-profile enabled */
 	void *start;
 	void *end;
 } stress_memrate_context_t;
@@ -160,6 +164,27 @@ static uint64_t TARGET_CLONES stress_memrate_read##size(	\
 	return ((uintptr_t)ptr - (uintptr_t)start) / KB;	\
 }
 
+/*
+ *  stress_memrate_dur()
+ *	time to read or write 1MB at the given rate, with
+ *	--load-profile the rate is scaled by the target load
+ */
+static inline double stress_memrate_dur(
+	const stress_memrate_context_t *context,
+	const uint64_t mbs)
+{
+	double load;
+
+	if (!context->load_profile)
+		return 1.0 / (double)mbs;
+
+	/* Floor at 1% so a 0% load does not stall for too long */
+	load = stress_load_profile(context->t_start);
+	if (load < 1.0)
+		load = 1.0;
+	return 100.0 / ((double)mbs * load);
+}
+
 #define STRESS_MEMRATE_READ_RATE(size, type, prefetch)		\
 static uint64_t TARGET_CLONES stress_memrate_read_rate##size(	\
 	const stress_memrate_context_t *context,		\
@@ -167,7 +192,7 @@ static uint64_t TARGET_CLONES stress_memrate_read_rate##size(	\
 {								\
 	register type *ptr;					\
 	double t1;						\
-	const double dur = 1.0 / (double)context->memrate_rd_mbs;\
+	const uint64_t mbs = context->memrate_rd_mbs;		\
 	double total_dur = 0.0;					\
 	void *start ALIGNED(1024) = context->start;		\
 	void *end ALIGNED(1024) = context->end;			\
@@ -219,7 +244,7 @@ static uint64_t TARGET_CLONES stress_memrate_read_rate##size(	\
 			(void)v;				\
 		}						\
 		t2 = stress_time_now();				\
-		total_dur += dur;				\
+		total_dur += stress_memrate_dur(context, mbs);	\
 		dur_remainder = total_dur - (t2 - t1);		\
 								\
 		if (dur_remainder >= 0.0) {			\
@@ -318,7 +343,7 @@ static uint64_t TARGET_CLONES stress_memrate_write_rate##size(	\
 {								\
 	register volatile type *ptr;				\
 	double t1;						\
-	const double dur = 1.0 / (double)context->memrate_wr_mbs;\
+	const uint64_t mbs = context->memrate_wr_mbs;		\
 	double total_dur = 0.0;					\
 	type v;							\
 	void *start ALIGNED(1024) = context->start;		\
@@ -355,7 +380,7 @@ static uint64_t TARGET_CLONES stress_memrate_write_rate##size(	\
 			ptr[15] = v;				\
 		}						\
 		t2 = stress_time_now();				\
-		total_dur += dur;				\
+		total_dur += stress_memrate_dur(context, mbs);	\
 		dur_remainder = total_dur - (t2 - t1);		\
 								\
 		if (dur_remainder >= 0.0) {			\
@@ -435,7 +460,7 @@ static uint64_t OPTIMIZE3 stress_memrate_write_nt_rate##size(	\
 {								\
 	register type *ptr;					\
 	double t1;						\
-	const double dur = 1.0 / (double)context->memrate_wr_mbs;\
+	const uint64_t mbs = context->memrate_wr_mbs;		\
 	double total_dur = 0.0;					\
 	void *start ALIGNED(1024) = context->start;		\
 	void *end ALIGNED(1024) = context->end;			\
@@ -477,7 +502,7 @@ static uint64_t OPTIMIZE3 stress_memrate_write_nt_rate##size(	\
 			op(vptr + 15, v);			\
 		}						\
 		t2 = stress_time_now();				\
-		total_dur += dur;				\
+		total_dur += stress_memrate_dur(context, mbs);	\
 		dur_remainder = total_dur - (t2 - t1);		\
 								\
 		if (dur_remainder >= 0.0) {			\
@@ -643,6 +668,7 @@ static int stress_memrate_child(const stress_args_t *args, void *ctxt)
 
 	context->start = buffer;
 	context->end = buffer_end;
+	context->t_start = stress_time_now();
 
 	do {
 		size_t i;
@@ -665,6 +691,7 @@ static int stress_memrate_child(const stress_args_t *args, void *ctxt)
 		}
 
 		inc_counter(args);
+		stress_mempolicy_numa_pages(args);
 	} while (keep_stressing(args));
 
 	(void)munmap((void *)buffer, context->memrate_bytes);
@@ -689,6 +716,11 @@ static int stress_memrate(const stress_args_t *args)
 	(void)stress_get_setting("memrate-bytes", &context.memrate_bytes);
 	(void)stress_get_setting("memrate-rd-mbs", &context.memrate_rd_mbs);
 	(void)stress_get_setting("memrate-wr-mbs", &context.memrate_wr_mbs);
+	context.load_profile = stress_load_profile_enabled();
+	if (context.load_profile && (args->instance == 0) &&
+	    (context.memrate_rd_mbs == ~0ULL) && (context.memrate_wr_mbs == ~0ULL))
+		pr_inf("%s: --load-profile requires --memrate-rd-mbs or "
+			"--memrate-wr-mbs rates to scale, ignoring it\n", args->name);
 
 	stats_size = memrate_items * sizeof(*context.stats);
 	stats_size = (stats_size + args->page_size - 1) & ~(args->page_size - 1);
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
@@ -424,6 +425,7 @@ again:
 			unsigned int prio = stress_mwc8() % PRIOS_MAX;
 			const uint64_t timed = (msg.value & 1);
 			uint64_t i = 0;
+			uint64_t t;
 
 			if ((attr_count++ & 31) == 0) {
 				struct mq_attr old_attr;
@@ -449,6 +451,7 @@ again:
 			/*
 			 * toggle between timedsend and send
 			 */
+			t = stress_latency_start(args);
 			if (do_timed && (timed))
 				ret = mq_timedsend(mq, (char *)&msg, sizeof(msg), prio, &abs_timeout);
 			else
@@ -461,6 +464,7 @@ again:
 						errno, strerror(errno));
 				break;
 			}
+			stress_latency_end(args, t);
 
 			if (!(i & 1023)) {
 				if (do_timed && (timed)) {
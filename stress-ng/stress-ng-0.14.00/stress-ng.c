@@ -19,12 +19,33 @@
  */
 #include "stress-ng.h"
 #include "core-ftrace.h"
+#include "core-exporter.h"
 #include "core-hash.h"
+#include "core-interference.h"
+#include "core-latency.h"
+#include "core-load-profile.h"
+#include "core-baseline.h"
 #include "core-perf.h"
+#include "core-progress.h"
+#include "core-rate.h"
+#include "core-repeat.h"
+#include "core-sampler.h"
+#include "core-scaling.h"
+#include "core-mempolicy.h"
 #include "core-smart.h"
+#include "core-sync.h"
+#include "core-warmup.h"
 #include "core-thermal-zone.h"
 #include "core-thrash.h"
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_SIGNALFD_H)
+#include <sys/signalfd.h>
+#endif
+
 #if defined(HAVE_SYS_UTSNAME_H)
 #include <sys/utsname.h>
 #endif
@@ -42,6 +63,11 @@ typedef struct {
 static stress_stressor_t *stressors_head, *stressors_tail;
 stress_stressor_t *g_stressor_current;
 
+/* Job file phase of newly created stressors */
+static uint32_t job_phase;
+static const char *job_phase_name;
+static const char *job_sweep;
+
 /* Various option settings and flags */
 static volatile bool wait_flag = true;		/* false = exit run wait loop */
 static int terminate_signum;			/* signal sent to process */
@@ -68,7 +94,9 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_cpu_online_all,	OPT_FLAGS_CPU_ONLINE_ALL },
 	{ OPT_dry_run,		OPT_FLAGS_DRY_RUN },
 	{ OPT_ftrace,		OPT_FLAGS_FTRACE },
+	{ OPT_ftrace_sched,	OPT_FLAGS_FTRACE_SCHED },
 	{ OPT_ignite_cpu,	OPT_FLAGS_IGNITE_CPU },
+	{ OPT_interference,	OPT_FLAGS_INTERFERENCE },
 	{ OPT_keep_files, 	OPT_FLAGS_KEEP_FILES },
 	{ OPT_keep_name, 	OPT_FLAGS_KEEP_NAME },
 	{ OPT_klog_check,	OPT_FLAGS_KLOG_CHECK },
@@ -85,11 +113,14 @@ static const stress_opt_flag_t opt_flags[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ OPT_perf_stats,	OPT_FLAGS_PERF_STATS },
+	{ OPT_perf_sample,	OPT_FLAGS_PERF_SAMPLE },
 #endif
 	{ OPT_skip_silent,	OPT_FLAGS_SKIP_SILENT },
 	{ OPT_smart,		OPT_FLAGS_SMART },
 	{ OPT_sock_nodelay,	OPT_FLAGS_SOCKET_NODELAY },
 	{ OPT_stdout,		OPT_FLAGS_STDOUT },
+	{ OPT_sync_start,	OPT_FLAGS_SYNC_START },
+	{ OPT_sync_stop,	OPT_FLAGS_SYNC_STOP },
 #if defined(HAVE_SYSLOG_H)
 	{ OPT_syslog,		OPT_FLAGS_SYSLOG },
 #endif
@@ -247,6 +278,8 @@ static const struct option long_options[] = {
 	{ "bad-ioctl",		1,	0,	OPT_bad_ioctl },
 	{ "bad-ioctl-ops",	1,	0,	OPT_bad_ioctl_ops },
 	{ "backoff",		1,	0,	OPT_backoff },
+	{ "baseline",		1,	0,	OPT_baseline },
+	{ "baseline-threshold",	1,	0,	OPT_baseline_threshold },
 	{ "bigheap",		1,	0,	OPT_bigheap },
 	{ "bigheap-ops",	1,	0,	OPT_bigheap_ops },
 	{ "bigheap-growth",	1,	0,	OPT_bigheap_growth },
@@ -408,6 +441,7 @@ static const struct option long_options[] = {
 	{ "fstat-ops",		1,	0,	OPT_fstat_ops },
 	{ "fstat-dir",		1,	0,	OPT_fstat_dir },
 	{ "ftrace",		0,	0,	OPT_ftrace },
+	{ "ftrace-sched",	0,	0,	OPT_ftrace_sched },
 	{ "full",		1,	0,	OPT_full },
 	{ "full-ops",		1,	0,	OPT_full_ops },
 	{ "funccall",		1,	0,	OPT_funccall },
@@ -458,6 +492,9 @@ static const struct option long_options[] = {
 	{ "inode-flags-ops",	1,	0,	OPT_inode_flags_ops },
 	{ "inotify",		1,	0,	OPT_inotify },
 	{ "inotify-ops",	1,	0,	OPT_inotify_ops },
+	{ "instance-model",	1,	0,	OPT_instance_model },
+	{ "interference",	0,	0,	OPT_interference },
+	{ "interleave",		1,	0,	OPT_interleave },
 	{ "io",			1,	0,	OPT_io },
 	{ "io-ops",		1,	0,	OPT_io_ops },
 	{ "iomix",		1,	0,	OPT_iomix },
@@ -531,6 +568,8 @@ static const struct option long_options[] = {
 	{ "lockf-nonblock", 	0,	0,	OPT_lockf_nonblock },
 	{ "lockofd",		1,	0,	OPT_lockofd },
 	{ "lockofd-ops",	1,	0,	OPT_lockofd_ops },
+	{ "load-profile",	1,	0,	OPT_load_profile },
+	{ "localalloc",		0,	0,	OPT_localalloc },
 	{ "log-brief",		0,	0,	OPT_log_brief },
 	{ "log-file",		1,	0,	OPT_log_file },
 	{ "longjmp",		1,	0,	OPT_longjmp },
@@ -561,6 +600,7 @@ static const struct option long_options[] = {
 	{ "matrix-3d-zyx",	0,	0,	OPT_matrix_3d_zyx },
 	{ "maximize",		0,	0,	OPT_maximize },
 	{ "max-fd",		1,	0,	OPT_max_fd },
+	{ "mbind",		1,	0,	OPT_mbind },
 	{ "mcontend",		1,	0,	OPT_mcontend },
 	{ "mcontend-ops",	1,	0,	OPT_mcontend_ops },
 	{ "membarrier",		1,	0,	OPT_membarrier },
@@ -587,6 +627,9 @@ static const struct option long_options[] = {
 	{ "mergesort-size",	1,	0,	OPT_mergesort_integers },
 	{ "metrics",		0,	0,	OPT_metrics },
 	{ "metrics-brief",	0,	0,	OPT_metrics_brief },
+	{ "metrics-csv",	1,	0,	OPT_metrics_csv },
+	{ "metrics-export",	1,	0,	OPT_metrics_export },
+	{ "metrics-interval",	1,	0,	OPT_metrics_interval },
 	{ "mincore",		1,	0,	OPT_mincore },
 	{ "mincore-ops",	1,	0,	OPT_mincore_ops },
 	{ "mincore-random",	0,	0,	OPT_mincore_rand },
@@ -675,6 +718,7 @@ static const struct option long_options[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ "perf",		0,	0,	OPT_perf_stats },
+	{ "perf-sample",	0,	0,	OPT_perf_sample },
 #endif
 	{ "personality",	1,	0,	OPT_personality },
 	{ "personality-ops",	1,	0,	OPT_personality_ops },
@@ -686,6 +730,7 @@ static const struct option long_options[] = {
 	{ "pidfd-ops",		1,	0,	OPT_pidfd_ops },
 	{ "ping-sock",		1,	0,	OPT_ping_sock },
 	{ "ping-sock-ops",	1,	0,	OPT_ping_sock_ops },
+	{ "pin",		1,	0,	OPT_pin },
 	{ "pipe",		1,	0,	OPT_pipe },
 	{ "pipe-ops",		1,	0,	OPT_pipe_ops },
 	{ "pipe-data-size",	1,	0,	OPT_pipe_data_size },
@@ -702,11 +747,14 @@ static const struct option long_options[] = {
 	{ "poll-fds",		1,	0,	OPT_poll_fds },
 	{ "prctl",		1,	0,	OPT_prctl },
 	{ "prctl-ops",		1,	0,	OPT_prctl_ops },
+	{ "preferred",		1,	0,	OPT_preferred },
 	{ "prefetch",		1,	0,	OPT_prefetch },
 	{ "prefetch-ops",	1,	0,	OPT_prefetch_ops },
 	{ "prefetch-l3-size",	1,	0,	OPT_prefetch_l3_size },
 	{ "procfs",		1,	0,	OPT_procfs },
 	{ "procfs-ops",		1,	0,	OPT_procfs_ops },
+	{ "progress",		1,	0,	OPT_progress },
+	{ "psistat",		1,	0,	OPT_psistat },
 	{ "pthread",		1,	0,	OPT_pthread },
 	{ "pthread-ops",	1,	0,	OPT_pthread_ops },
 	{ "pthread-max",	1,	0,	OPT_pthread_max },
@@ -733,6 +781,7 @@ static const struct option long_options[] = {
 	{ "randlist-items", 	1,	0,	OPT_randlist_items },
 	{ "randlist-size", 	1,	0,	OPT_randlist_size },
 	{ "random",		1,	0,	OPT_random },
+	{ "rate",		1,	0,	OPT_rate },
 	{ "rawdev",		1,	0,	OPT_rawdev },
 	{ "rawdev-ops",		1,	0,	OPT_rawdev_ops },
 	{ "rawdev-method",	1,	0,	OPT_rawdev_method },
@@ -756,6 +805,7 @@ static const struct option long_options[] = {
 	{ "remap-ops",		1,	0,	OPT_remap_ops },
 	{ "rename",		1,	0,	OPT_rename },
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
+	{ "repeat",		1,	0,	OPT_repeat },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
 	{ "resources",		1,	0,	OPT_resources },
@@ -772,6 +822,7 @@ static const struct option long_options[] = {
 	{ "rseq-ops",		1,	0,	OPT_rseq_ops },
 	{ "rtc",		1,	0,	OPT_rtc },
 	{ "rtc-ops",		1,	0,	OPT_rtc_ops },
+	{ "scaling",		1,	0,	OPT_scaling },
 	{ "sched",		1,	0,	OPT_sched },
 	{ "sched-prio",		1,	0,	OPT_sched_prio },
 	{ "schedpolicy",	1,	0,	OPT_schedpolicy },
@@ -898,6 +949,8 @@ static const struct option long_options[] = {
 	{ "stackmmap",		1,	0,	OPT_stackmmap },
 	{ "stackmmap-ops",	1,	0,	OPT_stackmmap_ops },
 	{ "stdout",		0,	0,	OPT_stdout },
+	{ "steady-state",	1,	0,	OPT_steady_state },
+	{ "steady-state-window",1,	0,	OPT_steady_state_window },
 	{ "str",		1,	0,	OPT_str },
 	{ "str-ops",		1,	0,	OPT_str_ops },
 	{ "str-method",		1,	0,	OPT_str_method },
@@ -918,6 +971,8 @@ static const struct option long_options[] = {
 	{ "sync-file",		1,	0,	OPT_sync_file },
 	{ "sync-file-ops", 	1,	0,	OPT_sync_file_ops },
 	{ "sync-file-bytes", 	1,	0,	OPT_sync_file_bytes },
+	{ "sync-start",		0,	0,	OPT_sync_start },
+	{ "sync-stop",		0,	0,	OPT_sync_stop },
 	{ "syncload",		1,	0,	OPT_syncload },
 	{ "syncload-ops",	1,	0,	OPT_syncload_ops },
 	{ "syncload-msbusy",	1,	0,	OPT_syncload_msbusy },
@@ -1041,6 +1096,7 @@ static const struct option long_options[] = {
 	{ "vmstat",		1,	0,	OPT_vmstat },
 	{ "wait",		1,	0,	OPT_wait },
 	{ "wait-ops",		1,	0,	OPT_wait_ops },
+	{ "warmup",		1,	0,	OPT_warmup },
 	{ "watchdog",		1,	0,	OPT_watchdog },
 	{ "watchdog-ops",	1,	0,	OPT_watchdog_ops },
 	{ "wcs",		1,	0,	OPT_wcs},
@@ -1078,23 +1134,35 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"aggressive",		"enable all aggressive options" },
 	{ "a N",	"all N",		"start N workers of each stress test" },
 	{ "b N",	"backoff N",		"wait of N microseconds before work starts" },
+	{ NULL,		"baseline F",		"compare metrics against YAML file F from a previous run" },
+	{ NULL,		"baseline-threshold P",	"flag baseline metric changes of more than P percent" },
 	{ NULL,		"class name",		"specify a class of stressors, use with --sequential" },
 	{ "n",		"dry-run",		"do not run" },
 	{ NULL,		"ftrace",		"enable kernel function call tracing" },
+	{ NULL,		"ftrace-sched",		"trace off-CPU time and run queue waits of stressors" },
 	{ "h",		"help",			"show help" },
 	{ NULL,		"ignite-cpu",		"alter kernel controls to make CPU run hot" },
+	{ NULL,		"instance-model M",	"run instances as processes (fork) or threads" },
 	{ NULL,		"ionice-class C",	"specify ionice class (idle, besteffort, realtime)" },
 	{ NULL,		"ionice-level L",	"specify ionice level (0 max, 7 min)" },
+	{ NULL,		"interference",		"run stressors alone and in pairs, report the slowdown matrix" },
+	{ NULL,		"interleave L",		"interleave stressor memory over NUMA node list L or all" },
 	{ "j",		"job jobfile",		"run the named jobfile" },
 	{ "k",		"keep-name",		"keep stress worker names to be 'stress-ng'" },
 	{ NULL,		"keep-files",		"do not remove files or directories" },
 	{ NULL,		"klog-check",		"check kernel message log for errors" },
+	{ NULL,		"load-profile P",	"vary the load of cpu and memrate stressors with profile P" },
+	{ NULL,		"localalloc",		"allocate stressor memory on the local NUMA node" },
 	{ NULL,		"log-brief",		"less verbose log messages" },
 	{ NULL,		"log-file filename",	"log messages to a log file" },
 	{ NULL,		"maximize",		"enable maximum stress options" },
 	{ NULL,		"max-fd",		"set maximum file descriptor limit" },
+	{ NULL,		"mbind L",		"bind stressor memory to NUMA node list L" },
 	{ "M",		"metrics",		"print pseudo metrics of activity" },
 	{ NULL,		"metrics-brief",	"enable metrics and only show non-zero results" },
+	{ NULL,		"metrics-csv F",	"write per interval bogo-op samples to CSV file F" },
+	{ NULL,		"metrics-export A",	"serve OpenMetrics on unix socket path or localhost port A" },
+	{ NULL,		"metrics-interval N",	"sample bogo-op counters every N milliseconds" },
 	{ NULL,		"minimize",		"enable minimal stress options" },
 	{ NULL,		"no-madvise",		"don't use random madvise options for each mmap" },
 	{ NULL,		"no-rand-seed",		"seed random numbers with the same constant" },
@@ -1105,9 +1173,17 @@ static const stress_help_t help_generic[] = {
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ NULL,		"perf",			"display perf statistics" },
+	{ NULL,		"perf-sample",		"sample instruction pointers and show the top functions" },
 #endif
+	{ NULL,		"preferred N",		"prefer allocating stressor memory on NUMA node N" },
+	{ NULL,		"pin P",		"pin instances to CPUs, P = compact, scatter, llc, numa, nosmt" },
+	{ NULL,		"progress S",		"show stressor progress every S seconds" },
+	{ NULL,		"psistat S",		"show pressure stall and cgroup statistics every S seconds" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
+	{ NULL,		"rate N",		"pace each stressor at a fixed N bogo ops per second" },
+	{ NULL,		"repeat N",		"run the stressors N times and report run to run statistics" },
+	{ NULL,		"scaling L",		"run each stressor at 1, 2, 4 .. L or at list L instances" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -1117,8 +1193,12 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"seed N",		"set the random number generator seed with a 64 bit value" },
 	{ NULL,		"sequential N",		"run all stressors one by one, invoking N of them" },
 	{ NULL,		"skip-silent",		"silently skip unimplemented stressors" },
+	{ NULL,		"steady-state P",	"stop stressors once bogo-op rate CV is below P percent" },
+	{ NULL,		"steady-state-window N","compute steady state CV over N sample intervals" },
 	{ NULL,		"stressors",		"show available stress tests" },
 	{ NULL,		"smart",		"show changes in S.M.A.R.T. data" },
+	{ NULL,		"sync-start",		"start all stressor instances at the same time" },
+	{ NULL,		"sync-stop",		"stop all stressor instances when the first finishes" },
 #if defined(HAVE_SYSLOG_H)
 	{ NULL,		"syslog",		"log messages to the syslog" },
 #endif
@@ -1136,6 +1216,7 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"verify",		"verify results (not available on all tests)" },
 	{ NULL,		"verifiable",		"show stressors that enable verification via --verify" },
 	{ "V",		"version",		"show version" },
+	{ NULL,		"warmup N",		"exclude the first N seconds of each stressor from the metrics" },
 	{ "Y",		"yaml file",		"output results to YAML formatted file" },
 	{ "x",		"exclude",		"list of stressors to exclude (not run)" },
 	{ NULL,		NULL,			NULL }
@@ -1319,6 +1400,23 @@ static void MLOCKED_TEXT stress_sigalrm_parent_handler(int signum)
 {
 	(void)signum;
 	wait_flag = false;
+
+	/*
+	 *  With --sync-stop the first instance to finish alerts
+	 *  the parent, so stop all the other instances too
+	 */
+	if ((g_opt_flags & OPT_FLAGS_SYNC_STOP) && stress_sync_stop_claim()) {
+		stress_stressor_t *ss;
+
+		for (ss = stressors_head; ss; ss = ss->next) {
+			int32_t i;
+
+			for (i = 0; i < ss->started_instances; i++) {
+				if (ss->pids[i])
+					(void)kill(ss->pids[i], SIGALRM);
+			}
+		}
+	}
 }
 
 #if defined(SIGUSR2)
@@ -1607,6 +1705,8 @@ static char *stress_exit_status_to_string(const int status)
 		return "stressor terminated using _exit()";
 	case EXIT_METRICS_UNTRUSTWORTHY:
 		return "metrics may be untrustworthy";
+	case EXIT_BASELINE_REGRESSION:
+		return "metrics regressed against baseline";
 	default:
 		return "unknown";
 	}
@@ -1742,6 +1842,394 @@ static void stress_clean_dir(
 	}
 }
 
+/*
+ *  stress_instances_threaded()
+ *	true if all the instances of a stressor are run
+ *	as threads of one process (threads instance model)
+ */
+static bool stress_instances_threaded(const stress_stressor_t *ss)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	return (g_opt_flags & OPT_FLAGS_THREADS) &&
+	       ss->stressor->info->thread_safe;
+#else
+	(void)ss;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_wait_status()
+ *	handle the exit status of reaped stressor process
+ *	ss->pids[j] and mark it as finished
+ */
+static void MLOCKED_TEXT stress_wait_status(
+	stress_stressor_t *ss,
+	const int32_t j,
+	const int status,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	const pid_t ret = ss->pids[j];
+	const double reaped = stress_time_now();
+	int wexit_status = WEXITSTATUS(status);
+	int32_t k, n;
+	bool do_abort = false;
+	const char *stressor_name = stress_munge_underscore(ss->stressor->name);
+	char name[64];
+
+	(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+		stress_munge_underscore(stressor_name));
+
+	/* Record when each instance run by this process was reaped */
+	n = stress_instances_threaded(ss) ? ss->started_instances : j + 1;
+	for (k = j; k < n; k++)
+		ss->stats[k]->reaped = reaped;
+
+	if (WIFSIGNALED(status)) {
+#if defined(WTERMSIG)
+		const int wterm_signal = WTERMSIG(status);
+
+		if (wterm_signal != SIGALRM) {
+#if NEED_GLIBC(2,1,0)
+			const char *signame = strsignal(wterm_signal);
+
+			pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
+				ret, stressor_name, wterm_signal, signame);
+#else
+			pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
+				ret, stressor_name, wterm_signal);
+#endif
+		}
+#else
+		pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
+			ret, stressor_name);
+#endif
+		/*
+		 *  If the stressor got killed by OOM or SIGKILL
+		 *  then somebody outside of our control nuked it
+		 *  so don't necessarily flag that up as a direct
+		 *  failure.
+		 */
+		if (stress_process_oomed(ret)) {
+			pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
+				ret, stressor_name);
+		} else if (WTERMSIG(status) == SIGKILL) {
+			pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
+				ret, stressor_name);
+		} else {
+			*success = false;
+		}
+	}
+	switch (wexit_status) {
+	case EXIT_SUCCESS:
+		break;
+	case EXIT_NO_RESOURCE:
+		pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
+			ret, stressor_name);
+		*resource_success = false;
+		do_abort = true;
+		break;
+	case EXIT_NOT_IMPLEMENTED:
+		do_abort = true;
+		break;
+	case EXIT_BY_SYS_EXIT:
+		pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
+			ret, stressor_name);
+		do_abort = true;
+		break;
+	case EXIT_METRICS_UNTRUSTWORTHY:
+		*metrics_success = false;
+		break;
+	case EXIT_FAILURE:
+		/*
+		 *  Stressors should really return EXIT_NOT_SUCCESS
+		 *  as EXIT_FAILURE should indicate a core stress-ng
+		 *  problem.
+		 */
+		wexit_status = EXIT_NOT_SUCCESS;
+		CASE_FALLTHROUGH;
+	default:
+		pr_err("process %d (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
+			ret, stressor_name, wexit_status,
+			stress_exit_status_to_string(wexit_status));
+		*success = false;
+		do_abort = true;
+		break;
+	}
+	if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort) {
+		keep_stressing_set_flag(false);
+		wait_flag = false;
+		stress_kill_stressors(SIGALRM);
+	}
+
+	stress_stressor_finished(&ss->pids[j]);
+	pr_dbg("process [%d] terminated\n", ret);
+
+	stress_clean_dir(name, ret, (uint32_t)j);
+}
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+/* stressor process being waited for by the event driven reaper */
+typedef struct {
+	stress_stressor_t *ss;		/* stressor */
+	int32_t j;			/* index into ss->pids[] */
+	int pidfd;			/* pidfd, -1 if not used */
+} stress_reap_t;
+
+/*
+ *  stress_wait_reap()
+ *	reap any of the stressor processes in reap[] that have
+ *	exited without blocking, returns number reaped
+ */
+static size_t MLOCKED_TEXT stress_wait_reap(
+	stress_reap_t *reap,
+	const size_t n,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	size_t i, reaped = 0;
+
+	for (i = 0; i < n; i++) {
+		stress_stressor_t *ss = reap[i].ss;
+		const int32_t j = reap[i].j;
+		int status;
+		pid_t ret;
+
+		if (!ss->pids[j])
+			continue;
+		ret = waitpid(ss->pids[j], &status, WNOHANG);
+		if (ret == ss->pids[j]) {
+			stress_wait_status(ss, j, status, success,
+				resource_success, metrics_success);
+		} else if ((ret < 0) && (errno == ECHILD)) {
+			/* This child did not exist, mark it done anyhow */
+			stress_stressor_finished(&ss->pids[j]);
+		} else {
+			continue;
+		}
+		if (reap[i].pidfd >= 0) {
+			(void)close(reap[i].pidfd);
+			reap[i].pidfd = -1;
+		}
+		reaped++;
+	}
+	return reaped;
+}
+
+/*
+ *  stress_wait_events()
+ *	wait for stressor processes to exit with one epoll
+ *	wake up per exit, using a pidfd per process or, if
+ *	pidfds are not available, a SIGCHLD signalfd. Returns
+ *	false if neither could be used so the caller can fall
+ *	back to blocking waits on each process
+ */
+static bool MLOCKED_TEXT stress_wait_events(
+	stress_stressor_t *stressors_list,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_reap_t *reap;
+	struct epoll_event *events;
+	size_t i, n = 0, alive;
+	int epfd, sigfd = -1;
+	bool use_pidfd = true;
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD)
+	sigset_t mask, old_mask;
+#endif
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++)
+			n += (ss->pids[j] != 0);
+	}
+	if (n == 0)
+		return true;
+
+	reap = calloc(n, sizeof(*reap));
+	if (!reap)
+		return false;
+	events = calloc(n, sizeof(*events));
+	if (!events) {
+		free(reap);
+		return false;
+	}
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		free(events);
+		free(reap);
+		return false;
+	}
+
+	for (i = 0, ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			if (!ss->pids[j])
+				continue;
+			reap[i].ss = ss;
+			reap[i].j = j;
+			reap[i].pidfd = -1;
+			if (use_pidfd) {
+				struct epoll_event ev;
+
+				reap[i].pidfd = shim_pidfd_open(ss->pids[j], 0);
+				(void)memset(&ev, 0, sizeof(ev));
+				ev.events = EPOLLIN;
+				ev.data.u32 = (uint32_t)i;
+				if ((reap[i].pidfd < 0) ||
+				    (epoll_ctl(epfd, EPOLL_CTL_ADD, reap[i].pidfd, &ev) < 0)) {
+					size_t k;
+
+					/* No pidfds, use SIGCHLD instead */
+					for (k = 0; k <= i; k++) {
+						if (reap[k].pidfd >= 0) {
+							(void)close(reap[k].pidfd);
+							reap[k].pidfd = -1;
+						}
+					}
+					use_pidfd = false;
+				}
+			}
+			i++;
+		}
+	}
+
+	if (!use_pidfd) {
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD)
+		struct epoll_event ev;
+
+		(void)sigemptyset(&mask);
+		(void)sigaddset(&mask, SIGCHLD);
+		if (sigprocmask(SIG_BLOCK, &mask, &old_mask) == 0) {
+			sigfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+			if (sigfd >= 0) {
+				(void)memset(&ev, 0, sizeof(ev));
+				ev.events = EPOLLIN;
+				ev.data.u32 = (uint32_t)n;
+				if (epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &ev) < 0) {
+					(void)close(sigfd);
+					sigfd = -1;
+				}
+			}
+			if (sigfd < 0)
+				(void)sigprocmask(SIG_SETMASK, &old_mask, NULL);
+		}
+#endif
+		if (sigfd < 0) {
+			(void)close(epfd);
+			free(events);
+			free(reap);
+			return false;
+		}
+	}
+	pr_dbg("waiting for %zu stressor processes using %s\n",
+		n, use_pidfd ? "pidfds" : "signalfd");
+
+	/* Some may have exited before their pidfd was opened */
+	alive = n - stress_wait_reap(reap, n, success, resource_success, metrics_success);
+	while (alive > 0) {
+		int nfds;
+
+		nfds = epoll_wait(epfd, events, (int)n, -1);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_dbg("epoll_wait failed: errno=%d (%s)\n",
+				errno, strerror(errno));
+			break;
+		}
+		if (use_pidfd) {
+			int k;
+
+			for (k = 0; k < nfds; k++) {
+				const size_t idx = (size_t)events[k].data.u32;
+
+				if (idx < n)
+					alive -= stress_wait_reap(&reap[idx], 1,
+						success, resource_success, metrics_success);
+			}
+		} else {
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD)
+			struct signalfd_siginfo fdsi;
+
+			/* Drain, SIGCHLDs coalesce so reap all that exited */
+			while (read(sigfd, &fdsi, sizeof(fdsi)) == (ssize_t)sizeof(fdsi))
+				;
+#endif
+			alive -= stress_wait_reap(reap, n, success, resource_success, metrics_success);
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (reap[i].pidfd >= 0)
+			(void)close(reap[i].pidfd);
+	}
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD)
+	if (sigfd >= 0) {
+		(void)close(sigfd);
+		(void)sigprocmask(SIG_SETMASK, &old_mask, NULL);
+	}
+#endif
+	(void)close(epfd);
+	free(events);
+	free(reap);
+
+	return alive == 0;
+}
+#endif
+
+/*
+ *  stress_wait_pids()
+ *	blocking wait on each stressor process in turn
+ */
+static void MLOCKED_TEXT stress_wait_pids(
+	stress_stressor_t *stressors_list,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			pid_t pid;
+redo:
+			pid = ss->pids[j];
+			if (pid) {
+				int status, ret;
+
+				ret = shim_waitpid(pid, &status, 0);
+				if (ret > 0) {
+					stress_wait_status(ss, j, status, success,
+						resource_success, metrics_success);
+				} else if (ret == -1) {
+					/* Somebody interrupted the wait */
+					if (errno == EINTR)
+						goto redo;
+					/* This child did not exist, mark it done anyhow */
+					if (errno == ECHILD)
+						stress_stressor_finished(&ss->pids[j]);
+				}
+			}
+		}
+	}
+}
+
 /*
  *  stress_wait_stressors()
  * 	wait for stressor child processes
@@ -1822,118 +2310,28 @@ static void MLOCKED_TEXT stress_wait_stressors(
 	}
 do_wait:
 #endif
-	for (ss = stressors_list; ss; ss = ss->next) {
-		int32_t j;
-
-		for (j = 0; j < ss->started_instances; j++) {
-			pid_t pid;
-redo:
-			pid = ss->pids[j];
-			if (pid) {
-				int status, ret;
-				bool do_abort = false;
-				const char *stressor_name = stress_munge_underscore(ss->stressor->name);
-				char name[64];
-
-				(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
-                                        stress_munge_underscore(stressor_name));
-
-				ret = shim_waitpid(pid, &status, 0);
-				if (ret > 0) {
-					int wexit_status = WEXITSTATUS(status);
-
-					if (WIFSIGNALED(status)) {
-#if defined(WTERMSIG)
-						const int wterm_signal = WTERMSIG(status);
-
-						if (wterm_signal != SIGALRM) {
-#if NEED_GLIBC(2,1,0)
-							const char *signame = strsignal(wterm_signal);
-
-							pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
-								ret, stressor_name, wterm_signal, signame);
-#else
-							pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
-								ret, stressor_name, wterm_signal);
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+	if (!stress_wait_events(stressors_list, success, resource_success, metrics_success))
 #endif
-						}
-#else
-						pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
-							ret, stressor_name);
-#endif
-						/*
-						 *  If the stressor got killed by OOM or SIGKILL
-						 *  then somebody outside of our control nuked it
-						 *  so don't necessarily flag that up as a direct
-						 *  failure.
-						 */
-						if (stress_process_oomed(ret)) {
-							pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
-								ret, stressor_name);
-						} else if (WTERMSIG(status) == SIGKILL) {
-							pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
-								ret, stressor_name);
-						} else {
-							*success = false;
-						}
-					}
-					switch (wexit_status) {
-					case EXIT_SUCCESS:
-						break;
-					case EXIT_NO_RESOURCE:
-						pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
-							ret, stressor_name);
-						*resource_success = false;
-						do_abort = true;
-						break;
-					case EXIT_NOT_IMPLEMENTED:
-						do_abort = true;
-						break;
-					case EXIT_BY_SYS_EXIT:
-						pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
-							ret, stressor_name);
-						do_abort = true;
-						break;
-					case EXIT_METRICS_UNTRUSTWORTHY:
-						*metrics_success = false;
-						break;
-					case EXIT_FAILURE:
-						/*
-						 *  Stressors should really return EXIT_NOT_SUCCESS
-						 *  as EXIT_FAILURE should indicate a core stress-ng
-						 *  problem.
-						 */
-						wexit_status = EXIT_NOT_SUCCESS;
-						CASE_FALLTHROUGH;
-					default:
-						pr_err("process %d (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
-							ret, stressor_name, wexit_status,
-							stress_exit_status_to_string(wexit_status));
-						*success = false;
-						do_abort = true;
-						break;
-					}
-					if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort) {
-						keep_stressing_set_flag(false);
-						wait_flag = false;
-						stress_kill_stressors(SIGALRM);
-					}
+		stress_wait_pids(stressors_list, success, resource_success, metrics_success);
 
-					stress_stressor_finished(&ss->pids[j]);
-					pr_dbg("process [%d] terminated\n", ret);
+	if (g_opt_flags & OPT_FLAGS_METRICS) {
+		double reap_max = 0.0;
 
-					stress_clean_dir(name, pid, (uint32_t)j);
+		for (ss = stressors_list; ss; ss = ss->next) {
+			int32_t j;
 
-				} else if (ret == -1) {
-					/* Somebody interrupted the wait */
-					if (errno == EINTR)
-						goto redo;
-					/* This child did not exist, mark it done anyhow */
-					if (errno == ECHILD)
-						stress_stressor_finished(&ss->pids[j]);
-				}
+			for (j = 0; j < ss->started_instances; j++) {
+				const stress_stats_t *stats = ss->stats[j];
+
+				if ((stats->reaped > 0.0) &&
+				    (stats->reaped - stats->finish > reap_max))
+					reap_max = stats->reaped - stats->finish;
 			}
 		}
+		pr_dbg("maximum stressor exit to reap latency: %.3f ms\n",
+			reap_max * 1000.0);
 	}
 	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
 		stress_ignite_cpu_stop();
@@ -2010,6 +2408,8 @@ static void stress_stressors_free(void)
 
 		free(ss->pids);
 		free(ss->stats);
+		free(ss->phase_name);
+		free(ss->sweep);
 		free(ss);
 
 		ss = next;
@@ -2019,6 +2419,37 @@ static void stress_stressors_free(void)
 	stressors_tail = NULL;
 }
 
+/*
+ *  stress_phased()
+ *	return true if the stressors are split into job file phases
+ */
+static bool stress_phased(const stress_stressor_t *stressors_list)
+{
+	const stress_stressor_t *ss;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->phase != stressors_list->phase)
+			return true;
+	}
+	return false;
+}
+
+/*
+ *  stress_phase_label()
+ *	describe the job file phase of a stressor
+ */
+static const char *stress_phase_label(
+	const stress_stressor_t *ss,
+	char *buf,
+	const size_t len)
+{
+	(void)snprintf(buf, len, "phase %" PRIu32 "%s%s%s%s",
+		ss->phase + 1,
+		ss->phase_name ? " " : "", ss->phase_name ? ss->phase_name : "",
+		ss->sweep ? " " : "", ss->sweep ? ss->sweep : "");
+	return buf;
+}
+
 /*
  *  stress_get_total_num_instances()
  *	deterimine number of runnable stressors from list
@@ -2058,43 +2489,300 @@ void stress_misc_stats_set(
 }
 
 /*
- *  stress_run ()
- *	kick off and run stressors
+ *  stress_child_setup()
+ *	per process set up of a stressor child
  */
-static void MLOCKED_TEXT stress_run(
-	stress_stressor_t *stressors_list,
-	double *duration,
-	bool *success,
-	bool *resource_success,
-	bool *metrics_success,
-	stress_checksum_t **checksum)
+static int stress_child_setup(
+	const char *name,
+	const int32_t ionice_class,
+	const int32_t ionice_level)
 {
-	double time_start, time_finish;
-	int32_t started_instances = 0;
-	const size_t page_size = stress_get_page_size();
+	(void)sched_settings_apply(true);
+	(void)atexit(stress_child_atexit);
+	(void)setpgid(0, g_pgrp);
+	if (stress_set_handler(name, true) < 0)
+		return EXIT_FAILURE;
+	stress_parent_died_alarm();
+	stress_process_dumpable(false);
+	stress_set_timer_slack();
 
-	wait_flag = true;
-	time_start = stress_time_now();
-	pr_dbg("starting stressors\n");
+	/* With --sync-start the alarm is set when the barrier is released */
+	if (g_opt_timeout && !(g_opt_flags & OPT_FLAGS_SYNC_START))
+		(void)alarm((unsigned int)g_opt_timeout);
 
-	/*
-	 *  Work through the list of stressors to run
-	 */
-	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
-		int32_t j;
+	stress_set_proc_state(name, STRESS_STATE_INIT);
+	stress_mwc_reseed();
+	stress_set_oom_adjustment(name, false);
+	stress_set_max_limits();
+	stress_set_iopriority(ionice_class, ionice_level);
+	(void)umask(0077);
 
-		/*
-		 *  Each stressor has 1 or more instances to run
-		 */
-		for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++) {
-			int rc = EXIT_SUCCESS;
-			size_t i;
-			pid_t pid;
-			char name[64];
-			int64_t backoff = DEFAULT_BACKOFF;
-			int32_t ionice_class = UNDEFINED;
-			int32_t ionice_level = UNDEFINED;
-			stress_stats_t *stats = g_stressor_current->stats[j];
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_run_instance()
+ *	run one instance of the current stressor, this is either
+ *	the whole of a forked child or one thread of a forked child
+ */
+static int stress_run_instance(
+	const char *name,
+	stress_stats_t *stats,
+	stress_checksum_t *checksum,
+	const int32_t instance,
+	const useconds_t backoff,
+	const bool threaded)
+{
+	int rc = EXIT_SUCCESS;
+	stress_warmup_t *warmup;
+	bool perf_sample = false;
+
+	pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
+		name, (int)getpid(), instance);
+
+	stats->pid = getpid();
+	stress_pin_apply(name, stats->pin_cpu);
+	stats->start = stats->finish = stress_time_now();
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		(void)stress_perf_open(&stats->sp);
+#endif
+	if (g_opt_flags & OPT_FLAGS_SYNC_START) {
+		/*
+		 *  Wait for all instances to be ready and start
+		 *  the measured run window and timeout together
+		 */
+		stress_sync_start_wait();
+		if (g_opt_timeout)
+			(void)alarm((unsigned int)g_opt_timeout);
+		stats->start = stats->finish = stress_time_now();
+	} else {
+		(void)shim_usleep(backoff);
+	}
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		(void)stress_perf_enable(&stats->sp);
+#endif
+	warmup = stress_warmup_start(name, stats, threaded);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	perf_sample = stress_perf_sample_start(threaded);
+#endif
+	if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
+		const stress_args_t args = {
+			.counter = &stats->counter,
+			.counter_seq = &stats->counter_seq,
+			.name = name,
+			.max_ops = g_stressor_current->bogo_ops,
+			.instance = (uint32_t)instance,
+			.num_instances = (uint32_t)g_stressor_current->num_instances,
+			.pid = getpid(),
+			.ppid = getppid(),
+			.page_size = stress_get_page_size(),
+			.mapped = &g_shared->mapped,
+			.misc_stats = stats->misc_stats,
+			.latency = (g_opt_flags & OPT_FLAGS_METRICS) ?
+				&stats->latency : NULL,
+			.numa_pages = stress_mempolicy_enabled() ?
+				&stats->numa_pages : NULL,
+			.rate = g_stressor_current->stats[0]->rate.interval_ns ?
+				&g_stressor_current->stats[0]->rate : NULL,
+			.warmup = warmup,
+			.perf_sample = perf_sample
+		};
+
+		(void)memset(checksum, 0, sizeof(*checksum));
+		stress_psi_start(&stats->psi);
+		rc = g_stressor_current->stressor->info->stressor(&args);
+		stress_psi_stop(&stats->psi);
+		pr_fail_check(&rc);
+		if (rc == EXIT_SUCCESS) {
+			stats->run_ok = true;
+			checksum->data.run_ok = true;
+		}
+		if ((g_opt_flags & OPT_FLAGS_SYNC_STOP) && stress_sync_stop_notify())
+			(void)kill(getppid(), SIGALRM);
+
+		/*
+		 *  We're done, cancel SIGALRM; the alarm is per
+		 *  process so threads leave it to the parent thread
+		 */
+		if (!threaded)
+			(void)alarm(0);
+
+		stress_set_proc_state(name, STRESS_STATE_STOP);
+		/*
+		 *  Bogo ops counter should be OK for reading,
+		 *  if not then flag up that the counter may
+		 *  be untrustyworthy
+		 */
+		if (stats->counter_seq & 1) {
+			pr_inf("%s: NOTE: bogo-ops counter in non-ready state, "
+				"metrics are untrustworthy (process may have been "
+				"terminated prematurely)\n",
+				name);
+			rc = EXIT_METRICS_UNTRUSTWORTHY;
+		}
+		checksum->data.counter = *args.counter;
+		stress_hash_checksum(checksum);
+	}
+	stress_mempolicy_numa_pages_stats(stats);
+	stress_warmup_stop();
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_sample_stop(&stats->perf_sample);
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		(void)stress_perf_disable(&stats->sp);
+		(void)stress_perf_close(&stats->sp);
+	}
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+		(void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
+#endif
+	stats->finish = stress_time_now();
+	if (threaded) {
+		stress_get_thread_times(&stats->tms);
+	} else if (times(&stats->tms) == (clock_t)-1) {
+		pr_dbg("times failed: errno=%d (%s)\n",
+			errno, strerror(errno));
+	}
+	stress_get_rusage(&stats->rusage, threaded);
+	pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
+		name, (int)getpid(), instance);
+
+	return rc;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/* per thread instance context */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	int rc;				/* stressor exit status */
+	int32_t instance;		/* stressor instance number */
+	const char *name;		/* stressor process name */
+	stress_stats_t *stats;		/* instance stats */
+	stress_checksum_t *checksum;	/* instance checksum */
+} stress_instance_thread_t;
+
+/*
+ *  stress_run_instance_thread()
+ *	pthread wrapper around stress_run_instance
+ */
+static void *stress_run_instance_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_instance_thread_t *it = (stress_instance_thread_t *)arg;
+
+	/* Each thread has its own random number generator state */
+	stress_mwc_reseed();
+	it->rc = stress_run_instance(it->name, it->stats, it->checksum,
+		it->instance, 0, true);
+
+	return &nowt;
+}
+
+/*
+ *  stress_run_instance_threads()
+ *	run all the instances of the current stressor as
+ *	threads in this process, return the first failing
+ *	instance exit status
+ */
+static int stress_run_instance_threads(
+	const char *name,
+	stress_checksum_t *checksum)
+{
+	const int32_t num_instances = g_stressor_current->num_instances;
+	stress_instance_thread_t *threads;
+	int32_t i;
+	int rc = EXIT_SUCCESS;
+
+	threads = calloc((size_t)num_instances, sizeof(*threads));
+	if (!threads) {
+		pr_inf("%s: cannot allocate %" PRId32 " thread contexts, skipping stressor\n",
+			name, num_instances);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < num_instances; i++) {
+		stress_instance_thread_t *it = &threads[i];
+
+		it->rc = EXIT_NO_RESOURCE;
+		it->instance = i;
+		it->name = name;
+		it->stats = g_stressor_current->stats[i];
+		it->checksum = &checksum[i];
+		it->ret = pthread_create(&it->pthread, NULL,
+			stress_run_instance_thread, (void *)it);
+		if (it->ret) {
+			pr_inf("%s: pthread_create failed for instance %" PRId32
+				", errno=%d (%s)\n", name, i, it->ret, strerror(it->ret));
+			break;
+		}
+	}
+
+	for (i = 0; i < num_instances; i++) {
+		stress_instance_thread_t *it = &threads[i];
+
+		if (it->ret == 0)
+			(void)pthread_join(it->pthread, NULL);
+		if ((rc == EXIT_SUCCESS) && (it->rc != EXIT_SUCCESS))
+			rc = it->rc;
+	}
+	(void)alarm(0);
+	free(threads);
+
+	return rc;
+}
+#endif
+
+/*
+ *  stress_run ()
+ *	kick off and run stressors
+ */
+static void MLOCKED_TEXT stress_run(
+	stress_stressor_t *stressors_list,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success,
+	stress_checksum_t **checksum)
+{
+	double time_start, time_finish;
+	int32_t started_instances = 0;
+
+	wait_flag = true;
+	time_start = stress_time_now();
+	stress_sync_init();
+	pr_dbg("starting stressors\n");
+
+	/*
+	 *  Work through the list of stressors to run
+	 */
+	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
+		/*
+		 *  With the threads instance model all the instances of
+		 *  a thread safe stressor run as threads of one child
+		 */
+		const bool threaded = stress_instances_threaded(g_stressor_current);
+		const int32_t per_process = threaded ?
+			g_stressor_current->num_instances : 1;
+		int32_t j;
+
+		/*
+		 *  Each stressor has 1 or more instances to run
+		 */
+		for (j = 0; j < g_stressor_current->num_instances; j += per_process, (*checksum) += per_process) {
+			int rc = EXIT_SUCCESS;
+			int32_t k;
+			pid_t pid;
+			char name[64];
+			int64_t backoff = DEFAULT_BACKOFF;
+			int32_t ionice_class = UNDEFINED;
+			int32_t ionice_level = UNDEFINED;
 
 			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
 				goto abort;
@@ -2102,12 +2790,34 @@ static void MLOCKED_TEXT stress_run(
 			(void)stress_get_setting("backoff", &backoff);
 			(void)stress_get_setting("ionice-class", &ionice_class);
 			(void)stress_get_setting("ionice-level", &ionice_level);
-
-			stats->counter_ready = true;
-			stats->counter = 0;
-			stats->checksum = *checksum;
-			for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++) {
-				stress_misc_stats_set(stats->misc_stats, i, "", -1);
+			if (j == 0)
+				stress_rate_init(&g_stressor_current->stats[0]->rate);
+
+			for (k = 0; k < per_process; k++) {
+				stress_stats_t *stats = g_stressor_current->stats[j + k];
+				size_t i;
+
+				stats->counter_seq = 0;
+				stats->counter = 0;
+				stats->reaped = 0.0;
+				stats->pid = 0;
+				stats->steady_state = 0.0;
+				stats->steady_state_cv = 0.0;
+				/*
+				 *  Interference runs pin instance N of the victim
+				 *  and aggressor to the same CPU so they share it
+				 */
+				stats->pin_cpu = stress_pin_cpu((g_opt_flags & OPT_FLAGS_INTERFERENCE) ?
+					j + k : started_instances + k);
+				(void)memset(&stats->numa_pages, 0, sizeof(stats->numa_pages));
+				(void)memset(&stats->rusage, 0, sizeof(stats->rusage));
+				(void)memset(&stats->warmup, 0, sizeof(stats->warmup));
+				(void)memset(&stats->sched, 0, sizeof(stats->sched));
+				stats->checksum = *checksum + k;
+				for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++) {
+					stress_misc_stats_set(stats->misc_stats, i, "", -1);
+				}
+				(void)memset(&stats->latency, 0, sizeof(stats->latency));
 			}
 again:
 			if (!keep_stressing_flag())
@@ -2129,104 +2839,21 @@ again:
 					stress_munge_underscore(g_stressor_current->stressor->name));
 				stress_set_proc_state(name, STRESS_STATE_START);
 
-				(void)sched_settings_apply(true);
-				(void)atexit(stress_child_atexit);
-				(void)setpgid(0, g_pgrp);
-				if (stress_set_handler(name, true) < 0) {
-					rc = EXIT_FAILURE;
+				rc = stress_child_setup(name, ionice_class, ionice_level);
+				if (rc != EXIT_SUCCESS)
+					goto child_exit;
+				rc = stress_mempolicy_apply(name);
+				if (rc != EXIT_SUCCESS)
 					goto child_exit;
-				}
-				stress_parent_died_alarm();
-				stress_process_dumpable(false);
-				stress_set_timer_slack();
-
-				if (g_opt_timeout)
-					(void)alarm((unsigned int)g_opt_timeout);
-
-				stress_set_proc_state(name, STRESS_STATE_INIT);
-				stress_mwc_reseed();
-				stress_set_oom_adjustment(name, false);
-				stress_set_max_limits();
-				stress_set_iopriority(ionice_class, ionice_level);
-				(void)umask(0077);
-
-				pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
-					name, (int)getpid(), j);
-
-				stats->start = stats->finish = stress_time_now();
-#if defined(STRESS_PERF_STATS) &&	\
-    defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-					(void)stress_perf_open(&stats->sp);
-#endif
-				(void)shim_usleep((useconds_t)(backoff * started_instances));
-#if defined(STRESS_PERF_STATS) &&	\
-    defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-					(void)stress_perf_enable(&stats->sp);
-#endif
-				if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
-					const stress_args_t args = {
-						.counter = &stats->counter,
-						.counter_ready = &stats->counter_ready,
-						.name = name,
-						.max_ops = g_stressor_current->bogo_ops,
-						.instance = (uint32_t)j,
-						.num_instances = (uint32_t)g_stressor_current->num_instances,
-						.pid = getpid(),
-						.ppid = getppid(),
-						.page_size = page_size,
-						.mapped = &g_shared->mapped,
-						.misc_stats = stats->misc_stats
-					};
-
-					(void)memset(*checksum, 0, sizeof(**checksum));
-					rc = g_stressor_current->stressor->info->stressor(&args);
-					pr_fail_check(&rc);
-					if (rc == EXIT_SUCCESS) {
-						stats->run_ok = true;
-						(*checksum)->data.run_ok = true;
-					}
 
-					/*
-					 *  We're done, cancel SIGALRM
-					 */
-					(void)alarm(0);
-
-					stress_set_proc_state(name, STRESS_STATE_STOP);
-					/*
-					 *  Bogo ops counter should be OK for reading,
-					 *  if not then flag up that the counter may
-					 *  be untrustyworthy
-					 */
-					if (!stats->counter_ready) {
-						pr_inf("%s: NOTE: bogo-ops counter in non-ready state, "
-							"metrics are untrustworthy (process may have been "
-							"terminated prematurely)\n",
-							name);
-						rc = EXIT_METRICS_UNTRUSTWORTHY;
-					}
-					(*checksum)->data.counter = *args.counter;
-					stress_hash_checksum(*checksum);
-				}
-#if defined(STRESS_PERF_STATS) &&	\
-    defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
-					(void)stress_perf_disable(&stats->sp);
-					(void)stress_perf_close(&stats->sp);
-				}
-#endif
-#if defined(STRESS_THERMAL_ZONES)
-				if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
-					(void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
+#if defined(HAVE_LIB_PTHREAD)
+				if (threaded)
+					rc = stress_run_instance_threads(name, *checksum);
+				else
 #endif
-				stats->finish = stress_time_now();
-				if (times(&stats->tms) == (clock_t)-1) {
-					pr_dbg("times failed: errno=%d (%s)\n",
-						errno, strerror(errno));
-				}
-				pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
-					name, (int)getpid(), j);
+					rc = stress_run_instance(name,
+						g_stressor_current->stats[j], *checksum, j,
+						(useconds_t)(backoff * started_instances), false);
 
 child_exit:
 				stress_stressors_free();
@@ -2248,8 +2875,8 @@ child_exit:
 				if (pid > -1) {
 					(void)setpgid(pid, g_pgrp);
 					g_stressor_current->pids[j] = pid;
-					g_stressor_current->started_instances++;
-					started_instances++;
+					g_stressor_current->started_instances += per_process;
+					started_instances += per_process;
 					stress_ftrace_add_pid(pid);
 				}
 
@@ -2262,6 +2889,10 @@ child_exit:
 				break;
 			}
 		}
+		if (threaded)
+			pr_dbg("%s: %" PRId32 " instances run as threads\n",
+				stress_munge_underscore(g_stressor_current->stressor->name),
+				g_stressor_current->num_instances);
 	}
 	(void)stress_set_handler("stress-ng", false);
 	if (g_opt_timeout)
@@ -2270,6 +2901,8 @@ child_exit:
 abort:
 	pr_dbg("%d stressor%s started\n", started_instances,
 		 started_instances == 1 ? "" : "s");
+	if (g_opt_flags & OPT_FLAGS_SYNC_START)
+		stress_sync_start_release(started_instances);
 
 wait_for_stressors:
 	stress_wait_stressors(stressors_list, success, resource_success, metrics_success);
@@ -2403,6 +3036,121 @@ static char *stess_description_yamlify(const char *description)
 	return yamlified;
 }
 
+/* Per stressor metrics totals of all started instances */
+typedef struct {
+	uint64_t c_total;		/* bogo ops */
+	uint64_t u_total;		/* user time in clock ticks */
+	uint64_t s_total;		/* system time in clock ticks */
+	double r_total;			/* average wall clock time */
+	stress_rusage_stats_t rusage;	/* resource usage */
+	int32_t warmup_missed;		/* instances without a warm-up snapshot */
+	bool run_ok;			/* true if any instance exited OK */
+} stress_metrics_totals_t;
+
+/* Resource usage fields reported per bogo op in the metrics */
+typedef struct {
+	const stress_rusage_index_t index;	/* stress_rusage_stats_t value index */
+	const char *description;		/* metrics description */
+	const char *yaml_name;			/* YAML field name */
+} stress_rusage_info_t;
+
+static const stress_rusage_info_t rusage_info[] = {
+	{ STRESS_RUSAGE_NVCSW,		"voluntary ctxt switches",	"voluntary-context-switches" },
+	{ STRESS_RUSAGE_NIVCSW,		"involuntary ctxt switches",	"involuntary-context-switches" },
+	{ STRESS_RUSAGE_MINFLT,		"minor page faults",		"minor-page-faults" },
+	{ STRESS_RUSAGE_MAJFLT,		"major page faults",		"major-page-faults" },
+	{ STRESS_RUSAGE_INBLOCK,	"block input ops",		"block-input-ops" },
+	{ STRESS_RUSAGE_OUBLOCK,	"block output ops",		"block-output-ops" },
+	{ STRESS_RUSAGE_SYSCR,		"read system calls",		"read-system-calls" },
+	{ STRESS_RUSAGE_SYSCW,		"write system calls",		"write-system-calls" },
+	{ STRESS_RUSAGE_READ_BYTES,	"bytes read from storage",	"storage-read-bytes" },
+	{ STRESS_RUSAGE_WRITE_BYTES,	"bytes written to storage",	"storage-write-bytes" },
+};
+
+/*
+ *  stress_rusage_io_index()
+ *	return true if the resource usage field is from /proc/self/io
+ */
+static inline bool stress_rusage_io_index(const stress_rusage_index_t index)
+{
+	return index >= STRESS_RUSAGE_SYSCR;
+}
+
+/*
+ *  stress_metrics_rusage_add()
+ *	add the resource usage of an instance to the totals, less
+ *	the usage at the end of the warm-up if warmup is non-NULL
+ */
+static void stress_metrics_rusage_add(
+	stress_rusage_stats_t *total,
+	const stress_rusage_stats_t *rusage,
+	const stress_rusage_stats_t *warmup)
+{
+	size_t i;
+
+	if (!rusage->valid)
+		return;
+	if (warmup && !warmup->valid)
+		warmup = NULL;
+
+	for (i = 0; i < STRESS_RUSAGE_MAX; i++) {
+		uint64_t value = rusage->value[i];
+
+		if (stress_rusage_io_index((stress_rusage_index_t)i) && !rusage->io_valid)
+			continue;
+		if (warmup && (value >= warmup->value[i]))
+			value -= warmup->value[i];
+		total->value[i] += value;
+	}
+	total->io_valid |= rusage->io_valid;
+	total->valid = true;
+}
+
+/*
+ *  stress_metrics_totals()
+ *	sum the bogo ops and CPU times and average the wall clock
+ *	time of all the started instances of a stressor, only the
+ *	post warm-up window is accounted for with --warmup
+ */
+static void stress_metrics_totals(
+	const stress_stressor_t *ss,
+	stress_metrics_totals_t *totals)
+{
+	int32_t j;
+
+	(void)memset(totals, 0, sizeof(*totals));
+
+	for (j = 0; j < ss->started_instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+		const stress_warmup_t *const warmup = &stats->warmup;
+
+		totals->run_ok |= stats->run_ok;
+		if (warmup->done && (stats->counter >= warmup->counter)) {
+			/* Only account for the post warm-up window */
+			totals->c_total += stats->counter - warmup->counter;
+			totals->u_total += (uint64_t)((stats->tms.tms_utime + stats->tms.tms_cutime) -
+						      (warmup->tms.tms_utime + warmup->tms.tms_cutime));
+			totals->s_total += (uint64_t)((stats->tms.tms_stime + stats->tms.tms_cstime) -
+						      (warmup->tms.tms_stime + warmup->tms.tms_cstime));
+			totals->r_total += stats->finish - warmup->time;
+			stress_metrics_rusage_add(&totals->rusage, &stats->rusage, &warmup->rusage);
+			continue;
+		}
+		if (stress_get_warmup())
+			totals->warmup_missed++;
+		totals->c_total += stats->counter;
+		totals->u_total += (uint64_t)(stats->tms.tms_utime +
+					      stats->tms.tms_cutime);
+		totals->s_total += (uint64_t)(stats->tms.tms_stime +
+					      stats->tms.tms_cstime);
+		totals->r_total += stats->finish - stats->start;
+		stress_metrics_rusage_add(&totals->rusage, &stats->rusage, NULL);
+	}
+	/* Real time in terms of average wall clock time of all procs */
+	totals->r_total = ss->started_instances ?
+		totals->r_total / (double)ss->started_instances : 0.0;
+}
+
 /*
  *  stress_metrics_dump()
  *	output metrics
@@ -2412,6 +3160,8 @@ static void stress_metrics_dump(
 	const int32_t ticks_per_sec)
 {
 	stress_stressor_t *ss;
+	const stress_stressor_t *prev = NULL;
+	const bool phased = stress_phased(stressors_head);
 
 	if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF) {
 		pr_inf("%-13s %9.9s %9.9s %9.9s %9.9s %12s %14s\n",
@@ -2428,32 +3178,31 @@ static void stress_metrics_dump(
 			"", "", "(secs) ", "(secs) ", "(secs) ", "(real time)",
 			"(usr+sys time)","instance (%)");
 	}
+	if (stress_get_warmup())
+		pr_inf("metrics exclude the first %" PRIu64 " second%s warm-up "
+			"of each instance\n", stress_get_warmup(),
+			stress_get_warmup() == 1 ? "" : "s");
 	pr_yaml(yaml, "metrics:\n");
 
 	for (ss = stressors_head; ss; ss = ss->next) {
-		uint64_t c_total = 0, u_total = 0, s_total = 0;
-		double   r_total = 0.0;
+		uint64_t c_total, u_total, s_total;
+		double   r_total;
 		int32_t  j;
 		size_t i;
 		const char *munged = stress_munge_underscore(ss->stressor->name);
 		double u_time, s_time, t_time, bogo_rate_r_time, bogo_rate, cpu_usage;
-		bool run_ok = false;
+		stress_metrics_totals_t totals;
+		bool run_ok;
 		bool lock = false;
+		bool latency_ok;
+		stress_latency_t latency;
 
-		for (j = 0; j < ss->started_instances; j++) {
-			const stress_stats_t *const stats = ss->stats[j];
-
-			run_ok  |= stats->run_ok;
-			c_total += stats->counter;
-			u_total += (uint64_t)(stats->tms.tms_utime +
-					      stats->tms.tms_cutime);
-			s_total += (uint64_t)(stats->tms.tms_stime +
-					      stats->tms.tms_cstime);
-			r_total += stats->finish - stats->start;
-		}
-		/* Real time in terms of average wall clock time of all procs */
-		r_total = ss->started_instances ?
-			r_total / (double)ss->started_instances : 0.0;
+		stress_metrics_totals(ss, &totals);
+		c_total = totals.c_total;
+		u_total = totals.u_total;
+		s_total = totals.s_total;
+		r_total = totals.r_total;
+		run_ok = totals.run_ok;
 
 		if ((g_opt_flags & OPT_FLAGS_METRICS_BRIEF) &&
 		    (c_total == 0) && (!run_ok))
@@ -2474,6 +3223,12 @@ static void stress_metrics_dump(
 		cpu_usage = ss->started_instances ? cpu_usage / ss->started_instances : 0.0;
 
 		pr_lock(&lock);
+		if (phased && (!prev || (prev->phase != ss->phase))) {
+			char label[128];
+
+			pr_inf("%s:\n", stress_phase_label(ss, label, sizeof(label)));
+		}
+		prev = ss;
 		if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF) {
 			pr_inf("%-13s %9" PRIu64 " %9.2f %9.2f %9.2f %12.2f %14.2f\n",
 				munged,		/* stress test name */
@@ -2511,9 +3266,35 @@ static void stress_metrics_dump(
 					munged, metric, description);
 			};
 		}
+		if (!(g_opt_flags & OPT_FLAGS_METRICS_BRIEF) &&
+		    totals.rusage.valid && (c_total > 0)) {
+			for (i = 0; i < SIZEOF_ARRAY(rusage_info); i++) {
+				const uint64_t value = totals.rusage.value[rusage_info[i].index];
+
+				if (!value)
+					continue;
+				pr_inf("%-13s %9.3e %s per bogo op (%" PRIu64 " in total)\n",
+					munged, (double)value / (double)c_total,
+					rusage_info[i].description, value);
+			}
+		}
+		latency_ok = stress_latency_merge(ss, &latency);
+		if (latency_ok)
+			stress_latency_dump(munged, &latency);
+		if (totals.warmup_missed)
+			pr_inf("%-13s %" PRId32 " of %" PRId32 " instances have no warm-up "
+				"snapshot, their metrics include the warm-up\n",
+				munged, totals.warmup_missed, ss->started_instances);
 		pr_unlock(&lock);
 
 		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		if (phased) {
+			pr_yaml(yaml, "      phase: %" PRIu32 "\n", ss->phase + 1);
+			if (ss->phase_name)
+				pr_yaml(yaml, "      phase-name: %s\n", ss->phase_name);
+			if (ss->sweep)
+				pr_yaml(yaml, "      sweep: %s\n", ss->sweep);
+		}
 		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", c_total);
 		pr_yaml(yaml, "      bogo-ops-per-second-usr-sys-time: %f\n", bogo_rate);
 		pr_yaml(yaml, "      bogo-ops-per-second-real-time: %f\n", bogo_rate_r_time);
@@ -2521,6 +3302,20 @@ static void stress_metrics_dump(
 		pr_yaml(yaml, "      user-time: %f\n", u_time);
 		pr_yaml(yaml, "      system-time: %f\n", s_time);
 		pr_yaml(yaml, "      cpu-usage-per-instance: %f\n", cpu_usage);
+		for (i = 0; totals.rusage.valid && (i < SIZEOF_ARRAY(rusage_info)); i++) {
+			const uint64_t value = totals.rusage.value[rusage_info[i].index];
+
+			if (stress_rusage_io_index(rusage_info[i].index) && !totals.rusage.io_valid)
+				continue;
+			pr_yaml(yaml, "      %s: %" PRIu64 "\n", rusage_info[i].yaml_name, value);
+			pr_yaml(yaml, "      %s-per-bogo-op: %f\n", rusage_info[i].yaml_name,
+				c_total ? (double)value / (double)c_total : 0.0);
+		}
+
+		stress_baseline_record(munged, "bogo-ops-per-second-real-time", bogo_rate_r_time);
+		stress_baseline_record(munged, "bogo-ops-per-second-usr-sys-time", bogo_rate);
+		stress_baseline_record(munged, "user-time", u_time);
+		stress_baseline_record(munged, "system-time", s_time);
 
 		for (i = 0; i < SIZEOF_ARRAY(ss->stats[j]->misc_stats); i++) {
 			const char *description = ss->stats[0]->misc_stats[i].description;
@@ -2537,6 +3332,8 @@ static void stress_metrics_dump(
 				pr_yaml(yaml, "      %s: %f\n", stess_description_yamlify(description), metric);
 			};
 		}
+		if (latency_ok)
+			stress_latency_dump_yaml(yaml, &latency);
 
 		pr_yaml(yaml, "\n");
 	}
@@ -2900,6 +3697,13 @@ static stress_stressor_t *stress_find_proc_info(const stress_t *stressor)
 	}
 
 	ss->stressor = stressor;
+	ss->phase = job_phase;
+	ss->phase_name = job_phase_name ? strdup(job_phase_name) : NULL;
+	ss->sweep = job_sweep ? strdup(job_sweep) : NULL;
+	if ((job_phase_name && !ss->phase_name) || (job_sweep && !ss->sweep)) {
+		(void)fprintf(stderr, "Cannot allocate stressor phase info\n");
+		exit(EXIT_FAILURE);
+	}
 
 	/* Add to end of procs list */
 	if (stressors_tail)
@@ -2912,6 +3716,18 @@ static stress_stressor_t *stress_find_proc_info(const stress_t *stressor)
 	return ss;
 }
 
+/*
+ *  stress_set_job_phase()
+ *	set the job file phase, phase name and sweep point
+ *	of the stressors created from now on
+ */
+void stress_set_job_phase(const uint32_t phase, const char *name, const char *sweep)
+{
+	job_phase = phase;
+	job_phase_name = name;
+	job_sweep = sweep;
+}
+
 /*
  *  stress_stressors_init()
  *	initialize any stressors that will be used
@@ -3104,6 +3920,26 @@ static void stress_enable_classes(const uint32_t class)
 	}
 }
 
+/*
+ *  stress_set_instance_model()
+ *	set the stressor instance model, fork or threads
+ */
+static void stress_set_instance_model(const char *opt)
+{
+	if (!strcmp(opt, "fork")) {
+		g_opt_flags &= ~OPT_FLAGS_THREADS;
+	} else if (!strcmp(opt, "threads")) {
+#if defined(HAVE_LIB_PTHREAD)
+		g_opt_flags |= OPT_FLAGS_THREADS;
+#else
+		pr_inf("instance-model threads not supported, using fork\n");
+#endif
+	} else {
+		(void)fprintf(stderr, "Invalid instance-model option: %s\n", opt);
+		(void)fprintf(stderr, "Available options are: fork threads\n");
+		_exit(EXIT_FAILURE);
+	}
+}
 
 /*
  *  stress_parse_opts
@@ -3188,6 +4024,13 @@ next_opt:
 			i64 = (int64_t)stress_get_uint64(optarg);
 			stress_set_setting_global("backoff", TYPE_ID_INT64, &i64);
 			break;
+		case OPT_baseline:
+			g_opt_flags |= OPT_FLAGS_METRICS;
+			stress_set_setting_global("baseline", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_baseline_threshold:
+			(void)stress_set_baseline_threshold(optarg);
+			break;
 		case OPT_cache_level:
 			/*
 			 * Note: Overly high values will be caught in the
@@ -3219,6 +4062,9 @@ next_opt:
 		case OPT_help:
 			stress_usage();
 			break;
+		case OPT_instance_model:
+			stress_set_instance_model(optarg);
+			break;
 		case OPT_ionice_class:
 			i32 = stress_get_opt_ionice_class(optarg);
 			stress_set_setting("ionice-class", TYPE_ID_INT32, &i32);
@@ -3230,9 +4076,21 @@ next_opt:
 		case OPT_job:
 			stress_set_setting_global("job", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_interleave:
+			(void)stress_set_interleave(optarg);
+			break;
+		case OPT_load_profile:
+			(void)stress_set_load_profile(optarg);
+			break;
+		case OPT_localalloc:
+			(void)stress_set_localalloc();
+			break;
 		case OPT_log_file:
 			stress_set_setting_global("log-file", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_mbind:
+			(void)stress_set_mbind(optarg);
+			break;
 		case OPT_max_fd:
 			max_fds = (uint64_t)stress_get_file_limit();
 			u64 = stress_get_uint64_percent(optarg, 1, max_fds,
@@ -3240,6 +4098,15 @@ next_opt:
 			stress_check_range(optarg, u64, 8, max_fds);
 			stress_set_setting_global("max-fd", TYPE_ID_UINT64, &u64);
 			break;
+		case OPT_metrics_csv:
+			stress_set_setting_global("metrics-csv", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_metrics_export:
+			stress_set_setting_global("metrics-export", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_metrics_interval:
+			(void)stress_set_metrics_interval(optarg);
+			break;
 		case OPT_no_madvise:
 			g_opt_flags &= ~OPT_FLAGS_MMAP_MADVISE;
 			break;
@@ -3258,6 +4125,12 @@ next_opt:
 			stress_check_max_stressors("random", i32);
 			stress_set_setting("random", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_rate:
+			(void)stress_set_rate(optarg);
+			break;
+		case OPT_scaling:
+			(void)stress_set_scaling(optarg);
+			break;
 		case OPT_sched:
 			i32 = stress_get_opt_sched(optarg);
 			stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3293,6 +4166,12 @@ next_opt:
 			stress_check_range("sequential", (uint64_t)g_opt_sequential,
 				MIN_SEQUENTIAL, MAX_SEQUENTIAL);
 			break;
+		case OPT_steady_state:
+			(void)stress_set_steady_state(optarg);
+			break;
+		case OPT_steady_state_window:
+			(void)stress_set_steady_state_window(optarg);
+			break;
 		case OPT_stressors:
 			stress_show_stressor_names();
 			exit(EXIT_SUCCESS);
@@ -3316,10 +4195,26 @@ next_opt:
 		case OPT_verifiable:
 			stress_verifiable();
 			exit(EXIT_SUCCESS);
+		case OPT_pin:
+			(void)stress_set_pin(optarg);
+			break;
+		case OPT_preferred:
+			(void)stress_set_preferred(optarg);
+			break;
+		case OPT_progress:
+			if (stress_set_progress(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_repeat:
+			(void)stress_set_repeat(optarg);
+			break;
 		case OPT_vmstat:
 			if (stress_set_vmstat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_warmup:
+			(void)stress_set_warmup(optarg);
+			break;
 		case OPT_thermalstat:
 			if (stress_set_thermalstat(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3328,6 +4223,10 @@ next_opt:
 			if (stress_set_iostat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_psistat:
+			if (stress_set_psistat(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_yaml:
 			stress_set_setting_global("yaml", TYPE_ID_STR, (void *)optarg);
 			break;
@@ -3421,6 +4320,31 @@ static void stress_setup_sequential(const uint32_t class)
 	}
 }
 
+/*
+ *  stress_setup_scaling()
+ *	setup for --scaling mode stressors, allocate resources
+ *	for the largest instance count of the sweep
+ */
+static void stress_setup_scaling(const uint32_t class)
+{
+	stress_stressor_t *ss;
+	const int32_t *steps;
+	const size_t n = stress_get_scaling(&steps);
+	int32_t max_instances = 0;
+	size_t i;
+
+	stress_set_default_timeout(60);
+
+	for (i = 0; i < n; i++)
+		max_instances = STRESS_MAXIMUM(max_instances, steps[i]);
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->num_instances || (ss->stressor->info->class & class))
+			ss->num_instances = max_instances;
+		stress_alloc_proc_resources(&ss->pids, &ss->stats, ss->num_instances);
+	}
+}
+
 /*
  *  stress_setup_parallel()
  *	setup for parallel mode stressors
@@ -3445,6 +4369,39 @@ static void stress_setup_parallel(const uint32_t class)
 	}
 }
 
+/*
+ *  stress_repeat_record_run()
+ *	record the metrics of each stressor at the end of a run
+ */
+static void stress_repeat_record_run(const int32_t ticks_per_sec)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	for (i = 0, ss = stressors_head; ss; ss = ss->next, i++) {
+		stress_metrics_totals_t totals;
+
+		if (!ss->started_instances)
+			continue;
+		stress_metrics_totals(ss, &totals);
+		stress_repeat_record(i, totals.c_total, totals.r_total,
+			(ticks_per_sec > 0) ?
+			(double)(totals.u_total + totals.s_total) / (double)ticks_per_sec : 0.0);
+	}
+}
+
+/*
+ *  stress_setup_interference()
+ *	setup for --interference mode stressors, there are
+ *	N solo runs and N * (N - 1) / 2 pair runs so the
+ *	default run time of each one is kept short
+ */
+static void stress_setup_interference(const uint32_t class)
+{
+	stress_set_default_timeout(30);
+	stress_setup_parallel(class);
+}
+
 /*
  *  stress_run_sequential()
  *	run stressors sequentially
@@ -3472,6 +4429,93 @@ static inline void stress_run_sequential(
 	}
 }
 
+/*
+ *  stress_run_scaling()
+ *	run stressors one by one, each at all the --scaling
+ *	instance counts
+ */
+static void stress_run_scaling(
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *checksums = g_shared->checksums;
+	const int32_t ticks_per_sec = stress_get_ticks_per_second();
+	const int32_t *steps;
+	const size_t n = stress_get_scaling(&steps);
+	size_t index;
+
+	for (index = 0, ss = stressors_head; ss && keep_stressing_flag(); ss = ss->next, index++) {
+		stress_stressor_t *next = ss->next;
+		const int32_t num_instances = ss->num_instances;
+		size_t i;
+
+		if (!num_instances)
+			continue;
+
+		ss->next = NULL;
+		for (i = 0; (i < n) && keep_stressing_flag(); i++) {
+			stress_checksum_t *checksum = checksums;
+			stress_metrics_totals_t totals;
+
+			pr_inf("%s: scaling step %zu of %zu, %" PRId32 " instance%s\n",
+				stress_munge_underscore(ss->stressor->name),
+				i + 1, n, steps[i], steps[i] == 1 ? "" : "s");
+			ss->num_instances = steps[i];
+			ss->started_instances = 0;
+			stress_run(ss, duration, success, resource_success,
+				metrics_success, &checksum);
+
+			stress_metrics_totals(ss, &totals);
+			stress_scaling_record(index, i, totals.c_total, totals.r_total,
+				(ticks_per_sec > 0) ?
+				(double)(totals.u_total + totals.s_total) / (double)ticks_per_sec : 0.0);
+		}
+		ss->num_instances = num_instances;
+		ss->next = next;
+		checksums += num_instances;
+	}
+}
+
+/*
+ *  stress_run_phases()
+ *	run job file phases one after another, the stressors
+ *	in each phase run in parallel and all must complete
+ *	before the next phase starts
+ */
+static void stress_run_phases(
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss = stressors_head;
+	stress_checksum_t *checksum = g_shared->checksums;
+
+	while (ss && keep_stressing_flag()) {
+		stress_stressor_t *last = ss, *next;
+		char label[128];
+		uint32_t n = 1;
+
+		while (last->next && (last->next->phase == ss->phase)) {
+			last = last->next;
+			n++;
+		}
+		next = last->next;
+
+		pr_inf("%s: running %" PRIu32 " stressor%s\n",
+			stress_phase_label(ss, label, sizeof(label)),
+			n, n == 1 ? "" : "s");
+		last->next = NULL;
+		stress_run(ss, duration, success, resource_success,
+			metrics_success, &checksum);
+		last->next = next;
+		ss = next;
+	}
+}
+
 /*
  *  stress_run_parallel()
  *	run stressors in parallel
@@ -3491,6 +4535,91 @@ static inline void stress_run_parallel(
 			metrics_success, &checksum);
 }
 
+/*
+ *  stress_run_interference()
+ *	run every pair of stressors together and then each
+ *	stressor alone to measure the slowdown of each stressor
+ *	caused by each other stressor. The solo runs are last so
+ *	the metrics of each stressor are from its solo run
+ */
+static void stress_run_interference(
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *victim, *aggressor;
+	stress_checksum_t *checksums = g_shared->checksums;
+	stress_checksum_t *checksum;
+	stress_metrics_totals_t totals;
+	size_t i, j, n = 0, run = 0, runs;
+
+	for (victim = stressors_head; victim; victim = victim->next) {
+		if (victim->num_instances)
+			n++;
+	}
+	runs = n + ((n * (n - 1)) / 2);
+
+	for (i = 0, victim = stressors_head; victim && keep_stressing_flag(); victim = victim->next, i++) {
+		stress_stressor_t *next = victim->next;
+
+		if (!victim->num_instances)
+			continue;
+
+		for (j = i + 1, aggressor = next; aggressor && keep_stressing_flag(); aggressor = aggressor->next, j++) {
+			stress_stressor_t *aggressor_next = aggressor->next;
+			char name[64];
+
+			if (!aggressor->num_instances)
+				continue;
+
+			(void)shim_strlcpy(name, stress_munge_underscore(victim->stressor->name), sizeof(name));
+			pr_inf("interference run %zu of %zu, %s with %s\n",
+				++run, runs, name,
+				stress_munge_underscore(aggressor->stressor->name));
+
+			/*
+			 *  The aggressor's checksums are placed after the
+			 *  victim's, the solo runs put them back in place
+			 */
+			victim->next = aggressor;
+			aggressor->next = NULL;
+			victim->started_instances = 0;
+			aggressor->started_instances = 0;
+			checksum = checksums;
+			stress_run(victim, duration, success, resource_success,
+				metrics_success, &checksum);
+			aggressor->next = aggressor_next;
+
+			stress_metrics_totals(victim, &totals);
+			stress_interference_record(i, j, totals.c_total, totals.r_total);
+			stress_metrics_totals(aggressor, &totals);
+			stress_interference_record(j, i, totals.c_total, totals.r_total);
+		}
+		victim->next = next;
+		checksums += victim->num_instances;
+	}
+
+	checksum = g_shared->checksums;
+	for (i = 0, victim = stressors_head; victim && keep_stressing_flag(); victim = victim->next, i++) {
+		stress_stressor_t *next = victim->next;
+
+		if (!victim->num_instances)
+			continue;
+
+		pr_inf("interference run %zu of %zu, %s alone\n",
+			++run, runs, stress_munge_underscore(victim->stressor->name));
+		victim->next = NULL;
+		victim->started_instances = 0;
+		stress_run(victim, duration, success, resource_success,
+			metrics_success, &checksum);
+		victim->next = next;
+
+		stress_metrics_totals(victim, &totals);
+		stress_interference_record(i, i, totals.c_total, totals.r_total);
+	}
+}
+
 /*
  *  stress_mlock_executable()
  *	try to mlock image into memory so it
@@ -3540,9 +4669,11 @@ static void stress_yaml_close(FILE *yaml)
 int main(int argc, char **argv, char **envp)
 {
 	double duration = 0.0;			/* stressor run time in secs */
+	NOCLOBBER double run_duration = 0.0;	/* run time of the last --repeat run */
 	bool success = true;
 	bool resource_success = true;
 	bool metrics_success = true;
+	bool baseline_success = true;
 	FILE *yaml;				/* YAML output file */
 	char *yaml_filename = NULL;		/* YAML file name */
 	char *log_filename;			/* log filename */
@@ -3554,6 +4685,8 @@ int main(int argc, char **argv, char **envp)
 	uint32_t class = 0;
 	const uint32_t cpus_online = (uint32_t)stress_get_processors_online();
 	const uint32_t cpus_configured = (uint32_t)stress_get_processors_configured();
+	int32_t run;				/* --repeat run number */
+	const int32_t *scaling_steps;		/* --scaling instance counts */
 	int ret;
 	bool unsupported = false;		/* true if stressors are unsupported */
 
@@ -3639,6 +4772,19 @@ int main(int argc, char **argv, char **envp)
 		ret = EXIT_FAILURE;
 		goto exit_stressors_free;
 	}
+
+	/*
+	 *  Sanity check run modes, these each run the stressors
+	 *  in their own way and cannot be combined
+	 */
+	if (((stress_get_scaling(&scaling_steps) > 0) ? 1 : 0) +
+	    ((g_opt_flags & OPT_FLAGS_INTERFERENCE) ? 1 : 0) +
+	    (stress_phased(stressors_head) ? 1 : 0) > 1) {
+		(void)fprintf(stderr, "cannot invoke --scaling, --interference "
+			"and job file phases together, only one can be used\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
 	(void)stress_get_setting("class", &class);
 
 	if (class &&
@@ -3707,11 +4853,13 @@ int main(int argc, char **argv, char **envp)
 	 */
 	stress_set_random_stressors();
 
+	stress_time_init();
 	(void)stress_ftrace_start();
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
 		stress_perf_init();
+	stress_perf_sample_init();
 #endif
 
 	/*
@@ -3733,6 +4881,11 @@ int main(int argc, char **argv, char **envp)
 	stress_set_iopriority(ionice_class, ionice_level);
 	(void)stress_get_setting("yaml", &yaml_filename);
 
+	if (stress_baseline_load() < 0) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
+
 	stress_mlock_executable();
 
 	/*
@@ -3755,7 +4908,11 @@ int main(int argc, char **argv, char **envp)
 	/*
 	 *  Setup stressor proc info
 	 */
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+	if (stress_get_scaling(&scaling_steps)) {
+		stress_setup_scaling(class);
+	} else if (g_opt_flags & OPT_FLAGS_INTERFERENCE) {
+		stress_setup_interference(class);
+	} else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
 		stress_setup_sequential(class);
 	} else {
 		stress_setup_parallel(class);
@@ -3835,26 +4992,69 @@ int main(int argc, char **argv, char **envp)
 	stress_clear_warn_once();
 	stress_stressors_init();
 
+	if ((stress_repeat_init(stressors_head) < 0) ||
+	    (stress_scaling_init(stressors_head) < 0) ||
+	    (stress_interference_init(stressors_head) < 0) ||
+	    (stress_pin_init() < 0)) {
+		ret = EXIT_FAILURE;
+		goto exit_stressors_deinit;
+	}
+
 	/* Start thrasher process if required */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_start();
 
 	stress_vmstat_start();
+	stress_sampler_start(stressors_head, stress_get_total_num_instances(stressors_head));
+	stress_ftrace_sched_start(stressors_head);
+	stress_progress_start(stressors_head, stress_get_total_num_instances(stressors_head));
+	stress_exporter_start(stressors_head);
 	stress_smart_start();
 	stress_klog_start();
 
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
-		stress_run_sequential(&duration,
-			&success, &resource_success, &metrics_success);
-	} else {
-		stress_run_parallel(&duration,
-			&success, &resource_success, &metrics_success);
+	for (run = 0; run < stress_get_repeat(); run++) {
+		if (run > 0) {
+			stress_stressor_t *ss;
+
+			if (!keep_stressing_flag())
+				break;
+			for (ss = stressors_head; ss; ss = ss->next)
+				ss->started_instances = 0;
+		}
+		if (stress_get_repeat() > 1)
+			pr_inf("starting run %" PRId32 " of %" PRId32 "\n",
+				run + 1, stress_get_repeat());
+		run_duration = duration;
+
+		if (stress_get_scaling(&scaling_steps)) {
+			stress_run_scaling(&duration,
+				&success, &resource_success, &metrics_success);
+		} else if (g_opt_flags & OPT_FLAGS_INTERFERENCE) {
+			stress_run_interference(&duration,
+				&success, &resource_success, &metrics_success);
+		} else if (stress_phased(stressors_head)) {
+			stress_run_phases(&duration,
+				&success, &resource_success, &metrics_success);
+		} else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+			stress_run_sequential(&duration,
+				&success, &resource_success, &metrics_success);
+		} else {
+			stress_run_parallel(&duration,
+				&success, &resource_success, &metrics_success);
+		}
+		run_duration = duration - run_duration;
+		stress_repeat_record_run(ticks_per_sec);
 	}
 
 	/* Stop thasher process */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_stop();
 
+	stress_exporter_stop();
+	stress_progress_stop();
+	stress_sampler_stop();
+	stress_ftrace_sched_stop();
+
 	yaml = stress_yaml_open(yaml_filename);
 
 	/*
@@ -3865,13 +5065,52 @@ int main(int argc, char **argv, char **envp)
 
 	stress_metrics_check(&success);
 
+	/*
+	 *  Dump per interval bogo-op samples
+	 */
+	stress_sampler_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump run to run statistics of --repeat runs
+	 */
+	stress_repeat_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump --scaling throughput, speedup and efficiency
+	 */
+	stress_scaling_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump --interference pairwise slowdown matrix
+	 */
+	stress_interference_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump per NUMA node memory of --mbind, --interleave etc
+	 */
+	stress_mempolicy_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump pressure stalls of the stressors
+	 */
+	stress_psistat_dump(yaml, stressors_head);
+
+	/*
+	 *  Dump off-CPU and run queue wait analysis
+	 */
+	stress_ftrace_sched_dump(yaml, stressors_head);
+
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	/*
 	 *  Dump perf statistics
 	 */
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-		stress_perf_stat_dump(yaml, stressors_head, duration);
+		stress_perf_stat_dump(yaml, stressors_head, run_duration);
+	/*
+	 *  Dump perf sampled top functions
+	 */
+	stress_perf_sample_dump(yaml, stressors_head);
 #endif
 
 #if defined(STRESS_THERMAL_ZONES)
@@ -3886,7 +5125,12 @@ int main(int argc, char **argv, char **envp)
 	/*
 	 *  Dump run times
 	 */
-	stress_times_dump(yaml, ticks_per_sec, duration);
+	stress_times_dump(yaml, ticks_per_sec, run_duration);
+
+	/*
+	 *  Compare metrics against --baseline
+	 */
+	baseline_success = stress_baseline_compare(yaml);
 
 	stress_klog_stop(&success);
 	stress_smart_stop();
@@ -3904,6 +5148,17 @@ int main(int argc, char **argv, char **envp)
 	stress_stressors_deinit();
 	stress_stressors_free();
 	stress_cache_free();
+	stress_sampler_free();
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_sample_free();
+#endif
+	stress_repeat_free();
+	stress_scaling_free();
+	stress_interference_free();
+	stress_load_profile_free();
+	stress_pin_free();
+	stress_baseline_free();
 	stress_shared_unmap();
 	stress_settings_free();
 	stress_temp_path_free();
@@ -3924,12 +5179,24 @@ int main(int argc, char **argv, char **envp)
 		exit(EXIT_NO_RESOURCE);
 	if (!metrics_success)
 		exit(EXIT_METRICS_UNTRUSTWORTHY);
+	if (!baseline_success)
+		exit(EXIT_BASELINE_REGRESSION);
 	exit(EXIT_SUCCESS);
 
+exit_stressors_deinit:
+	stress_repeat_free();
+	stress_scaling_free();
+	stress_interference_free();
+	stress_load_profile_free();
+	stress_pin_free();
+	stress_stressors_deinit();
+	stress_cache_free();
+
 exit_shared_unmap:
 	stress_shared_unmap();
 
 exit_logging_close:
+	stress_baseline_free();
 	shim_closelog();
 	pr_closelog();
 
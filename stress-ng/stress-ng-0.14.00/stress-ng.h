@@ -211,6 +211,7 @@ extern int setdomainname(const char *name, size_t len);
 #define EXIT_SIGNALED			(5)
 #define EXIT_BY_SYS_EXIT		(6)
 #define EXIT_METRICS_UNTRUSTWORTHY	(7)
+#define EXIT_BASELINE_REGRESSION	(8)
 
 /*
  *  Stressor run states
@@ -320,6 +321,12 @@ extern int setdomainname(const char *name, size_t len);
 #define OPT_FLAGS_KEEP_FILES	 STRESS_BIT_ULL(42)	/* --keep-files */
 #define OPT_FLAGS_STDOUT	 STRESS_BIT_ULL(43)	/* --stdout */
 #define OPT_FLAGS_KLOG_CHECK	 STRESS_BIT_ULL(44)	/* --klog-check */
+#define OPT_FLAGS_THREADS	 STRESS_BIT_ULL(45)	/* --instance-model threads */
+#define OPT_FLAGS_SYNC_START	 STRESS_BIT_ULL(46)	/* --sync-start */
+#define OPT_FLAGS_SYNC_STOP	 STRESS_BIT_ULL(47)	/* --sync-stop */
+#define OPT_FLAGS_PERF_SAMPLE	 STRESS_BIT_ULL(48)	/* --perf-sample */
+#define OPT_FLAGS_FTRACE_SCHED	 STRESS_BIT_ULL(49)	/* --ftrace-sched */
+#define OPT_FLAGS_INTERFERENCE	 STRESS_BIT_ULL(50)	/* --interference */
 
 #define OPT_FLAGS_MINMAX_MASK		\
 	(OPT_FLAGS_MINIMIZE | OPT_FLAGS_MAXIMIZE)
@@ -458,10 +465,101 @@ typedef struct {
 	double value;
 } stress_misc_stats_t;
 
+/*
+ *  Per NUMA node memory in KB of a stressor process, nodes
+ *  beyond STRESS_NUMA_NODES_MAX - 1 are accounted to the last node
+ */
+#define STRESS_NUMA_NODES_MAX	(16)
+
+typedef struct {
+	uint64_t kb[STRESS_NUMA_NODES_MAX];	/* KB resident per node */
+	uint64_t total;				/* total KB on all nodes */
+} stress_numa_pages_t;
+
+/*
+ *  Log-linear latency histogram, values < 32 ns are recorded
+ *  exactly, larger values in 32 linear sub-buckets per power
+ *  of 2, giving a worst case relative error of ~3%
+ */
+#define STRESS_LATENCY_SUB_BITS	(5)
+#define STRESS_LATENCY_SUB	(1U << STRESS_LATENCY_SUB_BITS)
+#define STRESS_LATENCY_OCTAVES	(40)
+#define STRESS_LATENCY_BUCKETS	(STRESS_LATENCY_SUB * STRESS_LATENCY_OCTAVES)
+
+typedef struct {
+	uint64_t count;			/* number of latencies recorded */
+	uint64_t min;			/* minimum latency, ns */
+	uint64_t max;			/* maximum latency, ns */
+	uint64_t bucket[STRESS_LATENCY_BUCKETS];
+} stress_latency_t;
+
+/* Per instance resource usage from getrusage() and /proc/self/io */
+typedef enum {
+	STRESS_RUSAGE_NVCSW = 0,	/* voluntary context switches */
+	STRESS_RUSAGE_NIVCSW,		/* involuntary context switches */
+	STRESS_RUSAGE_MINFLT,		/* minor page faults */
+	STRESS_RUSAGE_MAJFLT,		/* major page faults */
+	STRESS_RUSAGE_INBLOCK,		/* block input operations */
+	STRESS_RUSAGE_OUBLOCK,		/* block output operations */
+	STRESS_RUSAGE_SYSCR,		/* read system calls */
+	STRESS_RUSAGE_SYSCW,		/* write system calls */
+	STRESS_RUSAGE_READ_BYTES,	/* bytes read from storage */
+	STRESS_RUSAGE_WRITE_BYTES,	/* bytes written to storage */
+	STRESS_RUSAGE_MAX,
+} stress_rusage_index_t;
+
+typedef struct {
+	uint64_t value[STRESS_RUSAGE_MAX]; /* usage, see stress_rusage_index_t */
+	bool valid;			/* true if getrusage() succeeded */
+	bool io_valid;			/* true if /proc/self/io was read */
+} stress_rusage_stats_t;
+
+/* Per instance snapshot taken at the end of the --warmup period */
+typedef struct {
+	uint64_t counter;		/* bogo ops at end of warm-up */
+	double time;			/* wall clock time at end of warm-up */
+	struct tms tms;			/* run time stats at end of warm-up */
+	stress_rusage_stats_t rusage;	/* resource usage at end of warm-up */
+	bool done;			/* true if snapshot was taken */
+} stress_warmup_t;
+
+/*
+ *  --rate shared token bucket of a stressor, paced with the
+ *  generic cell rate algorithm, all instances share the one
+ *  theoretical arrival time of the next op
+ */
+typedef struct {
+	uint64_t interval_ns;		/* ns between ops, 0 = not rate limited */
+	uint64_t tat;			/* theoretical arrival time of next op, ns */
+} stress_rate_t;
+
+/*
+ *  Scheduler activity of a stressor instance from the
+ *  sched_switch and sched_wakeup trace events, --ftrace-sched
+ */
+#define STRESS_SCHED_REASONS	(8)
+
+typedef struct {
+	char func[48];			/* kernel function blocked in */
+	uint64_t count;			/* number of times blocked */
+	uint64_t time_ns;		/* total time blocked */
+} stress_sched_reason_t;
+
+typedef struct {
+	uint64_t on_cpu_ns;		/* time running */
+	uint64_t off_cpu_ns;		/* time switched out */
+	uint64_t sleep_ns;		/* time in interruptible sleeps */
+	uint64_t block_ns;		/* time in uninterruptible waits */
+	uint64_t voluntary;		/* blocking context switches */
+	uint64_t involuntary;		/* preemptions */
+	stress_latency_t runq_wait;	/* runnable to running latency */
+	stress_sched_reason_t reason[STRESS_SCHED_REASONS]; /* top blocking reasons */
+} stress_sched_stats_t;
+
 /* stressor args */
 typedef struct {
 	uint64_t *counter;		/* stressor counter */
-	bool *counter_ready;		/* counter can be read */
+	uint32_t *counter_seq;		/* counter seqlock, odd when updating */
 	const char *name;		/* stressor name */
 	uint64_t max_ops;		/* max number of bogo ops */
 	const uint32_t instance;	/* stressor instance # */
@@ -471,6 +569,11 @@ typedef struct {
 	size_t page_size;		/* page size */
 	stress_mapped_t *mapped;	/* mmap'd pages, addr of g_shared mapped */
 	stress_misc_stats_t *misc_stats;/* misc per stressor stats */
+	stress_latency_t *latency;	/* per op latency histogram */
+	stress_numa_pages_t *numa_pages;/* per node memory, --mbind etc */
+	stress_rate_t *rate;		/* --rate token bucket, NULL if none */
+	stress_warmup_t *warmup;	/* --warmup snapshot, NULL if none */
+	bool perf_sample;		/* --perf-sample ring needs draining */
 } stress_args_t;
 
 typedef struct {
@@ -496,6 +599,7 @@ typedef struct {
 	const stress_opt_set_func_t *opt_set_funcs;	/* option functions */
 	const stress_help_t *help;	/* stressor help options */
 	const stress_verify_t verify;	/* true = has verification mode */
+	const bool thread_safe;		/* true = can run instances as threads */
 } stressor_info_t;
 
 /* pthread wrapped stress_args_t */
@@ -558,6 +662,23 @@ typedef struct {
 	uint64_t	discard_ticks;	/* total wait time for discard requests */
 } stress_iostat_t;
 
+/* Pressure stall and cgroup v2 throttling totals, --psistat */
+typedef enum {
+	STRESS_PSI_CPU_SOME = 0,	/* /proc/pressure/cpu some */
+	STRESS_PSI_MEM_SOME,		/* /proc/pressure/memory some */
+	STRESS_PSI_MEM_FULL,		/* /proc/pressure/memory full */
+	STRESS_PSI_IO_SOME,		/* /proc/pressure/io some */
+	STRESS_PSI_IO_FULL,		/* /proc/pressure/io full */
+	STRESS_PSI_CG_THROTTLED,	/* cgroup cpu.stat throttled_usec */
+	STRESS_PSI_MAX,
+} stress_psi_index_t;
+
+typedef struct {
+	uint64_t total_us[STRESS_PSI_MAX]; /* stall times in microseconds */
+	double time;			/* time of snapshot or duration */
+	bool valid;			/* pressure information was read */
+} stress_psi_t;
+
 /* gcc 4.7 and later support vector ops */
 #if defined(__GNUC__) &&	\
     NEED_GNUC(4, 7, 0)
@@ -597,6 +718,15 @@ typedef struct {
 #define ALWAYS_INLINE
 #endif
 
+/* thread local storage class */
+#if ((defined(__GNUC__) && NEED_GNUC(3, 3, 0)) ||	\
+     (defined(__clang__) && NEED_CLANG(3, 0, 0))) &&	\
+    !defined(__PCC__)
+#define THREAD_LOCAL	__thread
+#else
+#define THREAD_LOCAL
+#endif
+
 /* force no inlining hint */
 #if (defined(__GNUC__) && NEED_GNUC(3, 4, 0)) ||	\
     (defined(__clang__) && NEED_CLANG(3, 0, 0))
@@ -853,15 +983,49 @@ static inline void ALWAYS_INLINE shim_mb(void)
 	asm volatile ("" ::: "memory");
 }
 
+/*
+ *  The bogo ops counter is updated inside a seqlock, the
+ *  sequence number is odd while the counter is being updated.
+ *  The fences order the sequence number and counter accesses
+ *  on weakly ordered CPUs, on x86 they are compiler barriers
+ */
+static inline void ALWAYS_INLINE stress_seq_write_fence(void)
+{
+#if defined(HAVE_ATOMIC)
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+	__sync_synchronize();
+#endif
+}
+
+static inline void ALWAYS_INLINE stress_seq_read_fence(void)
+{
+#if defined(HAVE_ATOMIC)
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#else
+	__sync_synchronize();
+#endif
+}
+
+extern void stress_rate_wait(stress_rate_t *rate, const uint64_t ops);
+extern void stress_warmup_check(void);
+extern void stress_perf_sample_poll(void);
+
 /* increment the stessor bogo ops counter */
 static inline void ALWAYS_INLINE inc_counter(const stress_args_t *args)
 {
-	*args->counter_ready = false;
-	shim_mb();
+	(*args->counter_seq)++;
+	stress_seq_write_fence();
 	(*(args->counter))++;
+	stress_seq_write_fence();
+	(*args->counter_seq)++;
 	shim_mb();
-	*args->counter_ready = true;
-	shim_mb();
+	if (UNLIKELY(args->warmup != NULL) && UNLIKELY(!args->warmup->done))
+		stress_warmup_check();
+	if (UNLIKELY(args->perf_sample))
+		stress_perf_sample_poll();
+	if (UNLIKELY(args->rate != NULL))
+		stress_rate_wait(args->rate, 1);
 }
 
 static inline uint64_t ALWAYS_INLINE get_counter(const stress_args_t *args)
@@ -871,22 +1035,28 @@ static inline uint64_t ALWAYS_INLINE get_counter(const stress_args_t *args)
 
 static inline void ALWAYS_INLINE set_counter(const stress_args_t *args, const uint64_t val)
 {
-	*args->counter_ready = false;
-	shim_mb();
+	(*args->counter_seq)++;
+	stress_seq_write_fence();
 	*args->counter = val;
-	shim_mb();
-	*args->counter_ready = true;
+	stress_seq_write_fence();
+	(*args->counter_seq)++;
 	shim_mb();
 }
 
 static inline void ALWAYS_INLINE add_counter(const stress_args_t *args, const uint64_t inc)
 {
-	*args->counter_ready = false;
-	shim_mb();
+	(*args->counter_seq)++;
+	stress_seq_write_fence();
 	*args->counter += inc;
+	stress_seq_write_fence();
+	(*args->counter_seq)++;
 	shim_mb();
-	*args->counter_ready = true;
-	shim_mb();
+	if (UNLIKELY(args->warmup != NULL) && UNLIKELY(!args->warmup->done))
+		stress_warmup_check();
+	if (UNLIKELY(args->perf_sample))
+		stress_perf_sample_poll();
+	if (UNLIKELY(args->rate != NULL))
+		stress_rate_wait(args->rate, inc);
 }
 
 /* pthread porting shims, spinlock or fallback to mutex */
@@ -938,6 +1108,21 @@ typedef struct {
 	stress_perf_stat_t	perf_stat[STRESS_PERF_MAX]; /* perf counters */
 	int			perf_opened;	/* count of opened counters */
 } stress_perf_t;
+
+/* --perf-sample symbols with the most samples of an instance */
+#define STRESS_PERF_SAMPLE_TOP	(32)
+
+typedef struct {
+	uint32_t sym;			/* symbol index */
+	uint32_t count;			/* number of samples */
+} stress_perf_sample_hit_t;
+
+typedef struct {
+	uint64_t samples;		/* total number of samples */
+	uint64_t kernel;		/* samples in the kernel */
+	uint64_t lost;			/* samples lost, ring buffer full */
+	stress_perf_sample_hit_t top[STRESS_PERF_SAMPLE_TOP];
+} stress_perf_sample_t;
 #endif
 
 /* linux thermal zones */
@@ -963,15 +1148,29 @@ typedef struct {
 } stress_tz_t;
 #endif
 
-/* Per stressor statistics and accounting info */
+/*
+ *  Per stressor statistics and accounting info, the bogo ops
+ *  counter is frequently written by the stressor and read by
+ *  the sampler so it is kept on its own cache line
+ */
 typedef struct {
 	uint64_t counter;		/* number of bogo ops */
-	bool counter_ready;		/* counter can be read */
-	struct tms tms;			/* run time stats of process */
+	uint32_t counter_seq;		/* counter seqlock, odd when updating */
+	struct tms tms ALIGN_CACHELINE;	/* run time stats of process */
 	double start;			/* wall clock start time */
 	double finish;			/* wall clock stop time */
+	double reaped;			/* wall clock time parent reaped it */
+	pid_t pid;			/* stressor process pid */
+	double steady_state;		/* run time to steady state, 0 = none */
+	double steady_state_cv;		/* rate CV % at steady state */
+	int32_t pin_cpu;		/* --pin CPU, -1 = not pinned */
+	stress_numa_pages_t numa_pages;	/* peak per node memory */
+	stress_rusage_stats_t rusage;	/* resource usage at exit */
+	stress_psi_t psi;		/* pressure stalls over the run */
+	stress_warmup_t warmup;		/* end of warm-up snapshot */
 #if defined(STRESS_PERF_STATS)
 	stress_perf_t sp;		/* perf counters */
+	stress_perf_sample_t perf_sample; /* perf IP samples */
 #endif
 #if defined(STRESS_THERMAL_ZONES)
 	stress_tz_t tz;			/* thermal zones */
@@ -979,8 +1178,49 @@ typedef struct {
 	bool run_ok;			/* true if stressor exited OK */
 	stress_checksum_t *checksum;	/* pointer to checksum data */
 	stress_misc_stats_t misc_stats[STRESS_MISC_STATS_MAX];
+	stress_latency_t latency;	/* per op latency histogram */
+	stress_rate_t rate;		/* --rate bucket, instance 0's is shared */
+	stress_sched_stats_t sched;	/* --ftrace-sched activity */
 } stress_stats_t;
 
+/*
+ *  stress_stats_counter_read()
+ *	seqlock read of a stressor bogo ops counter, returns
+ *	false if a consistent value could not be read
+ */
+static inline bool stress_stats_counter_read(
+	const stress_stats_t *stats,
+	uint64_t *counter)
+{
+	const volatile stress_stats_t *vstats = stats;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		const uint32_t seq = vstats->counter_seq;
+
+		if (seq & 1)
+			continue;
+		stress_seq_read_fence();
+		*counter = vstats->counter;
+		stress_seq_read_fence();
+		if (vstats->counter_seq == seq)
+			return true;
+	}
+	return false;
+}
+
+/* Per interval bogo-op counter samples, see core-sampler.c */
+typedef struct {
+	size_t length;			/* size of mapping in bytes */
+	size_t slots;			/* number of samples in the ring */
+	size_t instances;		/* number of counters per sample */
+	double start;			/* wall clock time sampling started */
+	double interval;		/* sampling interval in seconds */
+	uint64_t ticks;			/* total number of samples taken */
+	double *time;			/* ring of sample wall clock times */
+	uint64_t *counter;		/* ring of slots * instances counters */
+} stress_sampler_t;
+
 #define	STRESS_WARN_HASH_MAX		(128)
 
 /* The stress-ng global shared memory segment */
@@ -1043,6 +1283,12 @@ typedef struct {
 	uint8_t  str_shared[STR_SHARED_SIZE];		/* str copying buffer */
 	stress_checksum_t *checksums;			/* per stressor counter checksum */
 	size_t	checksums_length;			/* size of checksums mapping */
+	stress_sampler_t *sampler;			/* Per interval bogo-op samples */
+	struct {
+		uint32_t start ALIGN64;			/* Start barrier futex */
+		uint32_t waiting;			/* Instances at start barrier */
+		uint32_t stop;				/* Stop state */
+	} sync;
 	stress_stats_t stats[0];			/* Shared statistics */
 } stress_shared_t;
 
@@ -1438,6 +1684,9 @@ typedef enum {
 	OPT_bad_ioctl,
 	OPT_bad_ioctl_ops,
 
+	OPT_baseline,
+	OPT_baseline_threshold,
+
 	OPT_branch,
 	OPT_branch_ops,
 
@@ -1644,6 +1893,7 @@ typedef enum {
 	OPT_fstat_dir,
 
 	OPT_ftrace,
+	OPT_ftrace_sched,
 
 	OPT_full,
 	OPT_full_ops,
@@ -1713,6 +1963,12 @@ typedef enum {
 	OPT_inotify,
 	OPT_inotify_ops,
 
+	OPT_instance_model,
+
+	OPT_interference,
+
+	OPT_interleave,
+
 	OPT_iomix,
 	OPT_iomix_bytes,
 	OPT_iomix_ops,
@@ -1795,9 +2051,13 @@ typedef enum {
 	OPT_list_method,
 	OPT_list_size,
 
+	OPT_load_profile,
+
 	OPT_loadavg,
 	OPT_loadavg_ops,
 
+	OPT_localalloc,
+
 	OPT_lockbus,
 	OPT_lockbus_ops,
 
@@ -1850,6 +2110,8 @@ typedef enum {
 	OPT_maximize,
 	OPT_max_fd,
 
+	OPT_mbind,
+
 	OPT_mcontend,
 	OPT_mcontend_ops,
 
@@ -1883,6 +2145,9 @@ typedef enum {
 	OPT_mergesort_integers,
 
 	OPT_metrics_brief,
+	OPT_metrics_csv,
+	OPT_metrics_export,
+	OPT_metrics_interval,
 
 	OPT_mincore,
 	OPT_mincore_ops,
@@ -2001,6 +2266,7 @@ typedef enum {
 	OPT_pci_ops,
 
 	OPT_perf_stats,
+	OPT_perf_sample,
 
 	OPT_personality,
 	OPT_personality_ops,
@@ -2017,6 +2283,8 @@ typedef enum {
 	OPT_ping_sock,
 	OPT_ping_sock_ops,
 
+	OPT_pin,
+
 	OPT_pipe_ops,
 	OPT_pipe_size,
 	OPT_pipe_data_size,
@@ -2031,6 +2299,8 @@ typedef enum {
 	OPT_poll_ops,
 	OPT_poll_fds,
 
+	OPT_preferred,
+
 	OPT_prefetch,
 	OPT_prefetch_ops,
 	OPT_prefetch_l3_size,
@@ -2041,6 +2311,10 @@ typedef enum {
 	OPT_procfs,
 	OPT_procfs_ops,
 
+	OPT_progress,
+
+	OPT_psistat,
+
 	OPT_pthread,
 	OPT_pthread_ops,
 	OPT_pthread_max,
@@ -2073,6 +2347,8 @@ typedef enum {
 	OPT_ramfs_ops,
 	OPT_ramfs_size,
 
+	OPT_rate,
+
 	OPT_rawdev,
 	OPT_rawdev_method,
 	OPT_rawdev_ops,
@@ -2104,6 +2380,8 @@ typedef enum {
 
 	OPT_rename_ops,
 
+	OPT_repeat,
+
 	OPT_resched,
 	OPT_resched_ops,
 
@@ -2127,6 +2405,8 @@ typedef enum {
 	OPT_rtc,
 	OPT_rtc_ops,
 
+	OPT_scaling,
+
 	OPT_sched,
 	OPT_sched_prio,
 
@@ -2308,6 +2588,9 @@ typedef enum {
 
 	OPT_stdout,
 
+	OPT_steady_state,
+	OPT_steady_state_window,
+
 	OPT_str,
 	OPT_str_ops,
 	OPT_str_method,
@@ -2327,6 +2610,9 @@ typedef enum {
 	OPT_sync_file_ops,
 	OPT_sync_file_bytes,
 
+	OPT_sync_start,
+	OPT_sync_stop,
+
 	OPT_syncload,
 	OPT_syncload_ops,
 	OPT_syncload_msbusy,
@@ -2482,6 +2768,8 @@ typedef enum {
 	OPT_wait,
 	OPT_wait_ops,
 
+	OPT_warmup,
+
 	OPT_watchdog,
 	OPT_watchdog_ops,
 
@@ -2534,6 +2822,9 @@ typedef struct stress_stressor_info {
 	int32_t started_instances;	/* count of started instances */
 	int32_t num_instances;		/* number of instances per stressor */
 	uint64_t bogo_ops;		/* number of bogo ops */
+	uint32_t phase;			/* job file phase */
+	char *phase_name;		/* job file phase name, NULL if none */
+	char *sweep;			/* job file sweep option=value, NULL if none */
 } stress_stressor_t;
 
 /* Pointer to current running stressor proc info */
@@ -2566,6 +2857,10 @@ typedef struct stress_cpu {
 	stress_cpu_cache_t *caches;	/* CPU cache data */
 	uint32_t       num;		/* CPU # number */
 	uint32_t       cache_count;	/* CPU cache #  */
+	int32_t        package;		/* physical package id, -1 = unknown */
+	int32_t        core;		/* core id in package, -1 = unknown */
+	int32_t        llc;		/* first CPU sharing the LLC, -1 = unknown */
+	int32_t        node;		/* NUMA node, -1 = unknown */
 	bool           online;		/* CPU online when true */
 } stress_cpu_t;
 
@@ -2606,6 +2901,57 @@ static inline bool ALWAYS_INLINE OPTIMIZE3 keep_stressing(const stress_args_t *a
 		LIKELY(!args->max_ops || (get_counter(args) < args->max_ops)));
 }
 
+/*
+ *  Batched bogo ops counter, stressors with very short ops can
+ *  accumulate ops locally and publish them to the shared counter
+ *  in batches. The batch size is adapted so that the counter is
+ *  published about every STRESS_COUNTER_BATCH_USEC microseconds.
+ */
+#define STRESS_COUNTER_BATCH_USEC	(1000)
+#define STRESS_COUNTER_BATCH_MAX	(1U << 20)
+
+typedef struct {
+	uint64_t pending;		/* ops not yet published */
+	uint64_t batch;			/* ops to publish per batch */
+	double t_publish;		/* time of last publish */
+} stress_counter_batch_t;
+
+extern void stress_counter_batch_init(stress_counter_batch_t *cb);
+extern void stress_counter_batch_publish(const stress_args_t *args,
+	stress_counter_batch_t *cb);
+
+/* increment the stressor bogo ops counter batch */
+static inline void ALWAYS_INLINE inc_counter_batch(
+	const stress_args_t *args,
+	stress_counter_batch_t *cb)
+{
+	if (UNLIKELY(++cb->pending >= cb->batch))
+		stress_counter_batch_publish(args, cb);
+}
+
+/* publish any outstanding batched bogo ops */
+static inline void ALWAYS_INLINE flush_counter_batch(
+	const stress_args_t *args,
+	stress_counter_batch_t *cb)
+{
+	if (cb->pending) {
+		add_counter(args, cb->pending);
+		cb->pending = 0;
+	}
+}
+
+/*
+ *  keep_stressing_batch()
+ *      keep_stressing() that also accounts for unpublished batched ops
+ */
+static inline bool ALWAYS_INLINE OPTIMIZE3 keep_stressing_batch(
+	const stress_args_t *args,
+	const stress_counter_batch_t *cb)
+{
+	return (LIKELY(g_keep_stressing_flag) &&
+		LIKELY(!args->max_ops || ((get_counter(args) + cb->pending) < args->max_ops)));
+}
+
 /*
  *  stressor option value handling
  */
@@ -2709,6 +3055,11 @@ extern void stress_check_range(const char *const opt, const uint64_t val,
 extern void stress_check_range_bytes(const char *const opt,
 	const uint64_t val, const uint64_t lo, const uint64_t hi);
 extern WARN_UNUSED int stress_set_cpu_affinity(const char *arg);
+extern int stress_set_pin(const char *arg);
+extern int stress_pin_init(void);
+extern int32_t stress_pin_cpu(const int32_t instance);
+extern void stress_pin_apply(const char *name, const int32_t cpu);
+extern void stress_pin_free(void);
 extern WARN_UNUSED uint32_t stress_get_uint32(const char *const str);
 extern WARN_UNUSED int32_t  stress_get_int32(const char *const str);
 extern WARN_UNUSED int32_t  stress_get_opt_sched(const char *const str);
@@ -2729,6 +3080,8 @@ extern size_t stress_get_page_size(void);
 extern WARN_UNUSED int32_t stress_get_processors_online(void);
 extern WARN_UNUSED int32_t stress_get_processors_configured(void);
 extern WARN_UNUSED int32_t stress_get_ticks_per_second(void);
+extern void stress_get_thread_times(struct tms *tms);
+extern void stress_get_rusage(stress_rusage_stats_t *rusage, const bool threaded);
 extern WARN_UNUSED ssize_t stress_get_stack_direction(void);
 extern WARN_UNUSED void *stress_get_stack_top(void *start, size_t size);
 extern void stress_get_memlimits(size_t *shmall, size_t *freemem,
@@ -2767,6 +3120,9 @@ extern WARN_UNUSED size_t stress_get_max_file_limit(void);
 extern WARN_UNUSED int stress_get_bad_fd(void);
 extern void stress_vmstat_start(void);
 extern void stress_vmstat_stop(void);
+extern void stress_psi_start(stress_psi_t *psi);
+extern void stress_psi_stop(stress_psi_t *psi);
+extern void stress_psistat_dump(FILE *yaml, stress_stressor_t *stressors_list);
 extern WARN_UNUSED char *stress_find_mount_dev(const char *name);
 extern WARN_UNUSED int stress_sigaltstack_no_check(void *stack, const size_t size);
 extern WARN_UNUSED int stress_sigaltstack(void *stack, const size_t size);
@@ -2816,6 +3172,7 @@ extern WARN_UNUSED size_t stress_hostname_length(void);
 extern WARN_UNUSED int32_t stress_set_vmstat(const char *const str);
 extern WARN_UNUSED int32_t stress_set_thermalstat(const char *const str);
 extern WARN_UNUSED int32_t stress_set_iostat(const char *const str);
+extern WARN_UNUSED int32_t stress_set_psistat(const char *const str);
 extern void stress_misc_stats_set(stress_misc_stats_t *misc_stats,
 	const int idx, const char *description, const double value);
 extern WARN_UNUSED int stress_tty_width(void);
@@ -2868,6 +3225,8 @@ extern WARN_UNUSED bool stress_warn_once_hash(const char *filename, const int li
 /* Jobfile parsing */
 extern WARN_UNUSED int stress_parse_jobfile(int argc, char **argv,
 	const char *jobfile);
+extern void stress_set_job_phase(const uint32_t phase, const char *name,
+	const char *sweep);
 extern WARN_UNUSED int stress_parse_opts(int argc, char **argv,
 	const bool jobmode);
 
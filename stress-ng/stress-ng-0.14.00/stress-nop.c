@@ -38,6 +38,7 @@ typedef struct {
 } stress_nop_instr_t;
 
 static stress_nop_instr_t *current_instr = NULL;
+static stress_counter_batch_t nop_counter;
 
 #define OPx1(op)	op();
 #define OPx4(op)	OPx1(op) OPx1(op) OPx1(op) OPx1(op)
@@ -55,8 +56,11 @@ static void stress_nop_spin_ ## name(		\
 		while (i--)			\
 			OPx64(op); 		\
 						\
-		inc_counter(args);		\
-	} while (flag && keep_stressing(args));	\
+		inc_counter_batch(args,		\
+			&nop_counter);		\
+	} while (flag &&			\
+		 keep_stressing_batch(args,	\
+			&nop_counter));		\
 }
 
 static inline void stress_op_nop(void)
@@ -265,7 +269,7 @@ void stress_nop_random(const stress_args_t *args, const bool flag)
 		current_instr = &nop_instr[n];
 		if (!current_instr->ignore)
 			stress_nop_callfunc(current_instr, args, false);
-	} while (keep_stressing(args));
+	} while (keep_stressing_batch(args, &nop_counter));
 }
 
 static int stress_set_nop_instr(const char *opt)
@@ -313,6 +317,7 @@ static int stress_nop(const stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 
 	do_random = (instr->func == stress_nop_random);
+	stress_counter_batch_init(&nop_counter);
 
 	if (sigsetjmp(jmpbuf, 1) != 0) {
 		/* We reach here on an SIGILL trap */
@@ -333,6 +338,7 @@ static int stress_nop(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 	current_instr = instr;
 	stress_nop_callfunc(instr, args, true);
+	flush_counter_batch(args, &nop_counter);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return EXIT_SUCCESS;
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #define PIPE_STOP	"PS!"
 
@@ -258,8 +259,10 @@ again:
 
 		do {
 			ssize_t ret;
+			uint64_t t;
 
 			pipe_memset(buf, (char)val++, pipe_data_size);
+			t = stress_latency_start(args);
 			ret = write(pipefds[1], buf, pipe_data_size);
 			if (ret <= 0) {
 				if ((errno == EAGAIN) || (errno == EINTR))
@@ -271,6 +274,7 @@ again:
 				}
 				continue;
 			}
+			stress_latency_end(args, t);
 			inc_counter(args);
 		} while (keep_stressing(args));
 
@@ -267,5 +267,6 @@ stressor_info_t stress_skiplist_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
 	.help = help
 };
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #if defined(HAVE_LINUX_SOCKIOS_H)
@@ -990,6 +991,7 @@ static int stress_sock_server(
 			struct sockaddr saddr;
 			socklen_t len;
 			int sndbuf, opt;
+			uint64_t t;
 			struct msghdr msg;
 			struct iovec vec[MMAP_IO_SIZE / 16];
 #if defined(HAVE_SENDMMSG)
@@ -1058,6 +1060,7 @@ static int stress_sock_server(
 			else
 				opt = socket_opts;
 
+			t = stress_latency_start(args);
 			switch (opt) {
 			case SOCKET_OPT_SEND:
 				for (i = 16; i < MMAP_IO_SIZE; i += 16) {
@@ -1111,6 +1114,7 @@ static int stress_sock_server(
 				(void)close(sfd);
 				goto die_close;
 			}
+			stress_latency_end(args, t);
 			if (getpeername(sfd, &saddr, &len) < 0) {
 				if (errno != ENOTCONN)
 					pr_fail("%s: getpeername failed, errno=%d (%s)\n",
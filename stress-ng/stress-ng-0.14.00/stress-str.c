@@ -607,7 +607,7 @@ static void stress_str_all(
 	const size_t len2,
 	bool *failed)
 {
-	static int i = 1;	/* Skip over stress_str_all */
+	static THREAD_LOCAL int i = 1;	/* Skip over stress_str_all */
 
 	(void)libc_func;
 
@@ -745,5 +745,6 @@ stressor_info_t stress_str_info = {
 	.class = CLASS_CPU | CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
+	.thread_safe = true,
 	.help = help
 };
@@ -31,6 +31,7 @@
 #include "stress-ng.h"
 #include "core-cpu.h"
 #include "core-nt-store.h"
+#include "core-mempolicy.h"
 
 #define MIN_STREAM_L3_SIZE	(4 * KB)
 #define MAX_STREAM_L3_SIZE	(MAX_MEM_LIMIT)
@@ -655,6 +656,7 @@ static int stress_stream(const stress_args_t *args)
 	}
 
 	rc = EXIT_SUCCESS;
+	stress_mempolicy_numa_pages(args);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
@@ -228,9 +229,11 @@ again:
 		t_start = stress_time_now();
 		do {
 			ssize_t ret;
+			uint64_t t;
 
 			inc_counter(args);
 
+			t = stress_latency_start(args);
 			ret = write(pipefds[1], buf, sizeof(buf));
 			if (ret <= 0) {
 				if ((errno == EAGAIN) || (errno == EINTR))
@@ -244,6 +247,7 @@ again:
 				}
 				continue;
 			}
+			stress_latency_end(args, t);
 
 			if (switch_freq)
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
@@ -336,14 +340,18 @@ again:
 
 		t_start = stress_time_now();
 		do {
+			uint64_t t;
+
 			inc_counter(args);
 
 			sem.sem_num = 0;
 			sem.sem_op = 1;
 			sem.sem_flg = SEM_UNDO;
 
+			t = stress_latency_start(args);
 			if (semop(sem_id, &sem, 1) < 0)
 				break;
+			stress_latency_end(args, t);
 
 			if (switch_freq)
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
@@ -441,11 +449,14 @@ again:
 
 		t_start = stress_time_now();
 		do {
-			inc_counter(args);
 			unsigned int prio;
+			uint64_t t;
 
+			inc_counter(args);
+			t = stress_latency_start(args);
 			if (mq_receive(mq, (char *)&msg, sizeof(msg), &prio) < 0)
 				break;
+			stress_latency_end(args, t);
 
 			if (switch_freq)
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
@@ -458,6 +458,7 @@ static int stress_vdso(const stress_args_t *args)
 	char *str;
 	double t1, t2, t3, dt, overhead_ns;
 	uint64_t counter;
+	stress_counter_batch_t cb;
 
 	if (!vdso_sym_list) {
 		/* Should not fail, but worth checking to avoid breakage */
@@ -480,16 +481,18 @@ static int stress_vdso(const stress_args_t *args)
 		}
 	}
 
+	stress_counter_batch_init(&cb);
 	t1 = stress_time_now();
 	do {
 		stress_vdso_sym_t *vdso_sym;
 
 		for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
 			vdso_sym->func(vdso_sym->addr);
-			inc_counter(args);
+			inc_counter_batch(args, &cb);
 		}
-	} while (keep_stressing(args));
+	} while (keep_stressing_batch(args, &cb));
 	t2 = stress_time_now();
+	flush_counter_batch(args, &cb);
 
 	counter = get_counter(args);
 
@@ -503,11 +506,12 @@ static int stress_vdso(const stress_args_t *args)
 
 			for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
 				vdso_sym->dummy_func(vdso_sym->addr);
-				inc_counter(args);
+				inc_counter_batch(args, &cb);
 			}
 		}
 		t3 = stress_time_now();
 	} while (t3 - t2 < 0.1);
+	flush_counter_batch(args, &cb);
 
 	overhead_ns = (double)STRESS_NANOSECOND * ((t3 - t2) / (double)(get_counter(args) - counter));
 	set_counter(args, counter);
@@ -270,6 +270,7 @@ static int HOT TARGET_CLONES stress_vecmath(const stress_args_t *args)
 stressor_info_t stress_vecmath_info = {
 	.stressor = stress_vecmath,
 	.class = CLASS_CPU | CLASS_CPU_CACHE,
+	.thread_safe = true,
 	.help = help
 };
 #else
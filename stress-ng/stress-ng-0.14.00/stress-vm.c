@@ -21,6 +21,8 @@
 #include "core-cache.h"
 #include "core-target-clones.h"
 #include "core-nt-store.h"
+#include "core-warmup.h"
+#include "core-mempolicy.h"
 #include "core-vecmath.h"
 
 #define MIN_VM_BYTES		(4 * KB)
@@ -2605,6 +2607,7 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 			(void)sleep((unsigned int)vm_hang);
 		}
 
+		stress_mempolicy_numa_pages(args);
 		if (!vm_keep) {
 			(void)stress_madvise_random(buf, buf_sz);
 			(void)munmap(buf, buf_sz);
@@ -2673,6 +2676,7 @@ static int stress_vm(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)munmap((void *)context.bit_error_count, page_size);
 
+	stress_warmup_counter_shift(VM_BOGO_SHIFT);
 	tmp_counter = get_counter(args) >> VM_BOGO_SHIFT;
 	set_counter(args, tmp_counter);
 